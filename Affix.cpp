@@ -0,0 +1,163 @@
+#include "Affix.h"
+#include <string>
+#include <vector>
+#include <fstream> // for file streams
+#include <sstream> // for string streams
+#include <map> // for std::map
+using namespace std;
+
+bool AffixRules::loadFile(const std::string& affFile)
+{
+	ifstream infile(affFile);
+	if (!infile) // if file doesn't exist/couldn't be loaded
+	{
+		return false;
+	}
+	return parse(infile);
+}
+
+bool AffixRules::parse(std::istream& in)
+{
+	// O(R) where R is the number of lines in the rules
+
+	m_rules.clear();
+	map<pair<char, char>, bool> crossProduct; // the Y/N of every class header, keyed by (PFX/SFX, flag)
+
+	string line;
+	while (getline(in, line))
+	{
+		if (!line.empty() && line[line.size() - 1] == '\r') // strip out carriage returns
+			line.pop_back();
+		istringstream fields(line);
+		string kind, flag;
+		if (!(fields >> kind >> flag) || (kind != "PFX" && kind != "SFX")) // not an affix line, ignore it
+			continue;
+		if (flag.size() != 1) // only single character flags are supported
+			return false;
+
+		string strip, add, condition;
+		if (!(fields >> strip >> add))
+			return false;
+		if (!(fields >> condition)) // a class header has exactly three fields: Y/N and a count
+		{
+			if (strip != "Y" && strip != "N")
+				return false;
+			crossProduct[make_pair(kind[0], flag[0])] = (strip == "Y");
+			continue;
+		}
+
+		Rule rule;
+		rule.isPrefix = (kind == "PFX");
+		rule.flag = flag[0];
+		auto header = crossProduct.find(make_pair(kind[0], flag[0]));
+		if (header == crossProduct.end()) // a rule without a header isn't valid
+			return false;
+		rule.crossProduct = header->second;
+		rule.strip = (strip == "0") ? "" : strip;
+		size_t slash = add.find('/'); // continuation classes aren't supported, drop them
+		if (slash != string::npos)
+			add.erase(slash);
+		rule.add = (add == "0") ? "" : add;
+		if (!parseCondition(condition, rule.condition))
+			return false;
+		m_rules.push_back(rule);
+	}
+	index();
+	return true;
+}
+
+bool AffixRules::parseCondition(const std::string& text, std::vector<std::string>& condition)
+{
+	condition.clear();
+	if (text == ".")
+	{
+		return true; // matches everything
+	}
+	for (size_t i = 0; i < text.size(); i++)
+	{
+		if (text[i] == '.')
+		{
+			condition.push_back("");
+		}
+		else if (text[i] == '[')
+		{
+			size_t close = text.find(']', i);
+			if (close == string::npos) // unterminated character set
+				return false;
+			condition.push_back(text.substr(i + 1, close - i - 1));
+			i = close;
+		}
+		else
+		{
+			condition.push_back(string(1, text[i]));
+		}
+	}
+	return true;
+}
+
+void AffixRules::index()
+{
+	m_prefixByAdd.clear();
+	m_suffixByAdd.clear();
+	m_maxPrefixAdd = 0;
+	m_maxSuffixAdd = 0;
+	for (const Rule& rule : m_rules)
+	{
+		if (rule.isPrefix)
+		{
+			m_prefixByAdd[rule.add].push_back(&rule);
+			if (rule.add.size() > m_maxPrefixAdd)
+				m_maxPrefixAdd = rule.add.size();
+		}
+		else
+		{
+			m_suffixByAdd[rule.add].push_back(&rule);
+			if (rule.add.size() > m_maxSuffixAdd)
+				m_maxSuffixAdd = rule.add.size();
+		}
+	}
+}
+
+bool AffixRules::applies(const Rule& rule, const std::string& stem)
+{
+	// O(C) where C is the length of the condition
+	// Suffix conditions are matched against the end of the stem, prefix conditions against the start
+
+	if (stem.size() < rule.condition.size() || stem.size() < rule.strip.size())
+		return false;
+	if (rule.isPrefix ? stem.compare(0, rule.strip.size(), rule.strip) != 0
+		: stem.compare(stem.size() - rule.strip.size(), rule.strip.size(), rule.strip) != 0)
+		return false;
+
+	size_t offset = rule.isPrefix ? 0 : stem.size() - rule.condition.size();
+	for (size_t i = 0; i < rule.condition.size(); i++)
+	{
+		const string& set = rule.condition[i];
+		if (set.empty()) // '.' matches any character
+			continue;
+		char c = stem[offset + i];
+		if (set[0] == '^')
+		{
+			if (set.find(c, 1) != string::npos)
+				return false;
+		}
+		else if (set.find(c) == string::npos)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void AffixRules::generate(const std::string& stem, char flag, std::vector<std::string>& forms) const
+{
+	for (const Rule& rule : m_rules)
+	{
+		if (rule.flag != flag || !applies(rule, stem))
+			continue;
+		if (rule.isPrefix)
+			forms.push_back(rule.add + stem.substr(rule.strip.size()));
+		else
+			forms.push_back(stem.substr(0, stem.size() - rule.strip.size()) + rule.add);
+	}
+}
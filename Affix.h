@@ -0,0 +1,81 @@
+#ifndef AFFIX_H_
+#define AFFIX_H_
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <istream>
+
+// Affix rules for stem+affix compressed dictionaries
+// Understands the subset of the Hunspell .aff format that matters for checking words:
+//     PFX <flag> <Y|N> <count>                 header of a prefix class
+//     PFX <flag> <strip> <add> <condition>     one prefix rule
+//     SFX ...                                  same thing for suffixes
+// Flags are single characters, "0" means an empty strip/add string and conditions are
+// sequences of characters, '.' or [...] / [^...] character sets
+// Everything else in the file (TRY, SET, REP, comments...) is ignored
+class AffixRules {
+public:
+	struct Rule
+	{
+		bool isPrefix;
+		char flag;
+		bool crossProduct; // whether the rule can be combined with an affix of the other kind
+		std::string strip; // what's taken off of the stem
+		std::string add; // what's put onto the stem instead
+		std::vector<std::string> condition; // one character set per character, "" matches anything, a leading '^' negates
+	};
+
+	AffixRules()
+	{
+		m_maxPrefixAdd = 0;
+		m_maxSuffixAdd = 0;
+	}
+	AffixRules(const AffixRules&) = delete; // the lookup tables point into m_rules
+	AffixRules& operator=(const AffixRules&) = delete;
+
+	// Reads rules, returns false if the rules are malformed
+	bool parse(std::istream& in);
+	// Reads rules from a .aff file, returns false if the file can't be opened or is malformed
+	bool loadFile(const std::string& affFile);
+
+	bool empty() const { return m_rules.empty(); }
+	size_t size() const { return m_rules.size(); }
+
+	// Whether a rule applies to the stem, i.e. whether its strip and condition match the stem
+	static bool applies(const Rule& rule, const std::string& stem);
+
+	// Puts every word that stem expands to with the rules of flag onto forms
+	void generate(const std::string& stem, char flag, std::vector<std::string>& forms) const;
+
+	// The rules whose add string is exactly add, nullptr if there aren't any
+	const std::vector<const Rule*>* prefixesAdding(const std::string& add) const { return find(m_prefixByAdd, add); }
+	const std::vector<const Rule*>* suffixesAdding(const std::string& add) const { return find(m_suffixByAdd, add); }
+
+	// The longest add strings, bounds how much of a word has to be looked at
+	int maxPrefixAdd() const { return m_maxPrefixAdd; }
+	int maxSuffixAdd() const { return m_maxSuffixAdd; }
+
+private:
+	std::vector<Rule> m_rules;
+	std::unordered_map<std::string, std::vector<const Rule*>> m_prefixByAdd;
+	std::unordered_map<std::string, std::vector<const Rule*>> m_suffixByAdd;
+	int m_maxPrefixAdd;
+	int m_maxSuffixAdd;
+
+	static const std::vector<const Rule*>* find(const std::unordered_map<std::string, std::vector<const Rule*>>& byAdd, const std::string& add)
+	{
+		auto it = byAdd.find(add);
+		if (it == byAdd.end())
+			return nullptr;
+		return &it->second;
+	}
+
+	// Splits a condition like "[^aeiou]y" into one character set per character
+	static bool parseCondition(const std::string& text, std::vector<std::string>& condition);
+
+	// Rebuilds the add string lookup tables, has to happen whenever m_rules moves
+	void index();
+};
+
+#endif // AFFIX_H_
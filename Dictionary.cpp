@@ -0,0 +1,417 @@
+#include "Dictionary.h"
+#include "Phonetic.h"
+#include <string>
+#include <vector>
+#include <fstream> // for file streams
+#include <unordered_map> // for std::unordered_map
+#include <sstream> // for string streams
+#include <queue> // for std::priority_queue
+#include <algorithm> // for std::sort
+#include <cctype> // for tolower
+using namespace std;
+
+bool Dictionary::build(const std::string& dictionaryFile, const std::atomic<bool>* cancel)
+{
+	ifstream infile(dictionaryFile);
+	if (!infile) // if file doesn't exist/couldn't be loaded
+	{
+		return false;
+	}
+
+	const string dicExtension = ".dic";
+	if (dictionaryFile.size() > dicExtension.size()
+		&& dictionaryFile.compare(dictionaryFile.size() - dicExtension.size(), dicExtension.size(), dicExtension) == 0)
+	{
+		// the rules of a stem+affix dictionary live next to it in a .aff file
+		string affFile = dictionaryFile.substr(0, dictionaryFile.size() - dicExtension.size()) + ".aff";
+		if (!m_affixes.loadFile(affFile))
+			return false;
+		return buildAffixed(infile, cancel);
+	}
+	return buildFlat(infile, cancel);
+}
+
+bool Dictionary::buildFlat(std::istream& infile, const std::atomic<bool>* cancel)
+{
+	// O(N) time where N is the number of lines in the dictionary
+
+	// for every line in the dictionaryFile, insert the line into the dictionary
+	// a line can optionally give the word's frequency after whitespace, which ranks completions
+	string s;
+	int count = 0;
+	while (getline(infile, s))
+	{
+		unsigned frequency = 0;
+		size_t end = s.find_first_of(" \t");
+		if (end != string::npos)
+		{
+			istringstream(s.substr(end)) >> frequency;
+			s.erase(end);
+		}
+		addListedWord(insertWordNode(s), s, frequency);
+		// every so often check if whoever asked for this dictionary doesn't want it anymore
+		if (cancel != nullptr && (++count & 0xFFF) == 0 && cancel->load())
+		{
+			return false;
+		}
+	}
+	computeHints();
+	return true;
+}
+
+bool Dictionary::buildAffixed(std::istream& infile, const std::atomic<bool>* cancel)
+{
+	// O(N) time where N is the number of lines in the dictionary
+	// Every line is a stem, optionally followed by a slash and the flags of the affix rules it takes:
+	//     walk/DGS
+	// The first line of a .dic file is the number of stems, it's only a hint so it's skipped
+
+	unordered_map<string, unsigned short> flagSetIndex; // so every distinct flag set is only stored once
+	string s;
+	int count = 0;
+	bool first = true;
+	while (getline(infile, s))
+	{
+		if (!s.empty() && s[s.size() - 1] == '\r') // strip out carriage returns
+			s.pop_back();
+		if (first)
+		{
+			first = false;
+			if (!s.empty() && isdigit(static_cast<unsigned char>(s[0])))
+				continue;
+		}
+		unsigned frequency = 0;
+		size_t end = s.find_first_of(" \t"); // anything after whitespace is morphological data, except for a frequency
+		if (end != string::npos)
+		{
+			istringstream(s.substr(end)) >> frequency;
+			s.erase(end);
+		}
+		string flags;
+		size_t slash = s.find('/');
+		if (slash != string::npos)
+		{
+			flags = s.substr(slash + 1);
+			s.erase(slash);
+		}
+		if (s.empty())
+			continue;
+
+		TrieNode* node = insertWordNode(s);
+		addListedWord(node, s, frequency);
+		if (!flags.empty())
+		{
+			auto it = flagSetIndex.find(flags);
+			if (it == flagSetIndex.end())
+			{
+				if (m_flagSets.size() == MAX_FLAG_SETS) // numbering more would wrap around onto the wrong rules
+					return false;
+				it = flagSetIndex.insert(make_pair(flags, static_cast<unsigned short>(m_flagSets.size()))).first;
+				m_flagSets.push_back(flags);
+			}
+			node->flags = it->second;
+		}
+		if (cancel != nullptr && (++count & 0xFFF) == 0 && cancel->load())
+		{
+			return false;
+		}
+	}
+	computeHints();
+	return true;
+}
+
+void Dictionary::addListedWord(TrieNode* node, const std::string& word, unsigned frequency)
+{
+	if (node == root) // nothing but characters that aren't letters
+		return;
+	int index = m_wordEnds.size();
+	if (node->word != -1) // listed twice, keep the first one
+	{
+		if (frequency > m_frequency[node->word])
+			m_frequency[node->word] = frequency;
+		return;
+	}
+	node->word = index;
+	m_wordText += word;
+	m_wordEnds.push_back(m_wordText.size());
+	m_frequency.push_back(frequency);
+
+	string key = metaphone(word);
+	if (!key.empty())
+		m_phonetic[key].push_back(index);
+}
+
+void Dictionary::computeHints()
+{
+	// O(N log N + T*H) where N is the number of words, T the number of trie nodes and H the number of hints
+
+	m_wordText.shrink_to_fit();
+	vector<int> order(m_wordEnds.size());
+	for (int i = 0; i < order.size(); i++)
+		order[i] = i;
+	sort(order.begin(), order.end(), [this](int a, int b)
+	{
+		if (m_frequency[a] != m_frequency[b])
+			return m_frequency[a] > m_frequency[b];
+		if (wordAt(a).size() != wordAt(b).size())
+			return wordAt(a).size() < wordAt(b).size();
+		return wordAt(a) < wordAt(b);
+	});
+	m_rank.assign(m_wordEnds.size(), 0);
+	for (int i = 0; i < order.size(); i++)
+		m_rank[order[i]] = i;
+
+	// shortest first, then best first, so the words of a length are a run the most common of which lead
+	for (auto& bucket : m_phonetic)
+	{
+		sort(bucket.second.begin(), bucket.second.end(), [this](int a, int b)
+		{
+			if (wordAt(a).size() != wordAt(b).size())
+				return wordAt(a).size() < wordAt(b).size();
+			return m_rank[a] < m_rank[b];
+		});
+	}
+
+	computeHints(root);
+}
+
+void Dictionary::computeHints(TrieNode* seed)
+{
+	// The best completions of a subtree are the best of the word at its root and its children's best completions
+	vector<int> candidates;
+	if (seed->word != -1)
+		candidates.push_back(seed->word);
+	for (int i = 0; i < NUM_CHARS; i++)
+	{
+		TrieNode* child = seed->children[i];
+		if (child == nullptr)
+			continue;
+		computeHints(child);
+		for (int h = 0; h < NUM_HINTS && child->hints[h] != -1; h++)
+			candidates.push_back(child->hints[h]);
+	}
+	int count = candidates.size() < NUM_HINTS ? candidates.size() : NUM_HINTS;
+	partial_sort(candidates.begin(), candidates.begin() + count, candidates.end(), [this](int a, int b)
+	{
+		return m_rank[a] < m_rank[b];
+	});
+	for (int h = 0; h < NUM_HINTS; h++)
+		seed->hints[h] = (h < count) ? candidates[h] : -1;
+}
+
+void Dictionary::complete(const std::string& prefix, int k, std::vector<std::string>& completions) const
+{
+	// O(P + k) when k <= NUM_HINTS, O(P + k*C*log(k*C)) otherwise, where P is the length of the prefix
+	// and C is the number of children a node has; never depends on the size of the subtree
+
+	completions.clear();
+	if (k <= 0)
+		return;
+	const TrieNode* trav = root;
+	for (char c : prefix)
+	{
+		int index = getIndex(c);
+		if (index == -1) // words can't have anything but letters and apostrophes in them
+			return;
+		trav = trav->children[index];
+		if (trav == nullptr)
+			return;
+	}
+
+	// the precomputed hints answer small requests on their own
+	if (k <= NUM_HINTS)
+	{
+		for (int h = 0; h < k && trav->hints[h] != -1; h++)
+			completions.push_back(string(wordAt(trav->hints[h])));
+		return;
+	}
+
+	// larger requests do a best first walk: a subtree's priority is its best hint, so subtrees are only
+	// opened up when their best word is the next best thing left
+	struct Entry
+	{
+		int rank;
+		int word; // the word to output, or -1 if this is a subtree to open up
+		const TrieNode* node;
+		bool operator<(const Entry& other) const { return rank > other.rank; } // lowest rank on top
+	};
+	priority_queue<Entry> queue;
+	if (trav->hints[0] != -1)
+		queue.push({ m_rank[trav->hints[0]], -1, trav });
+	while (!queue.empty() && completions.size() < k)
+	{
+		Entry top = queue.top();
+		queue.pop();
+		if (top.word != -1)
+		{
+			completions.push_back(string(wordAt(top.word)));
+			continue;
+		}
+		if (top.node->word != -1)
+			queue.push({ m_rank[top.node->word], top.node->word, nullptr });
+		for (int i = 0; i < NUM_CHARS; i++)
+		{
+			const TrieNode* child = top.node->children[i];
+			if (child != nullptr && child->hints[0] != -1)
+				queue.push({ m_rank[child->hints[0]], -1, child });
+		}
+	}
+}
+
+void Dictionary::soundsLike(const std::string& word, int maxResults, std::vector<std::string>& results) const
+{
+	// O(log B + C*L^2 + C log C) where B is the size of the word's bucket and C the number of candidates
+	// ranked, which is capped
+
+	const int kMaxCandidates = 256; // bounds the re-ranking work on very common keys
+	const int kMaxLengthDifference = 3; // words this much longer or shorter aren't worth ranking
+	results.clear();
+	auto bucket = m_phonetic.find(metaphone(word));
+	if (bucket == m_phonetic.end())
+		return;
+
+	// rank by spelling distance, then by how close the length is, then alphabetically
+	struct Candidate
+	{
+		int distance;
+		int lengthDifference;
+		string_view word;
+	};
+	vector<Candidate> candidates;
+
+	// the bucket is sorted by length, then by rank, so taking the lengths closest to word's first and the
+	// most common words of each length first leaves the cap with the likeliest candidates
+	const vector<int>& words = bucket->second;
+	for (int difference = 0; difference <= kMaxLengthDifference && candidates.size() < kMaxCandidates; difference++)
+	{
+		for (int sign = -1; sign <= 1 && candidates.size() < kMaxCandidates; sign += 2)
+		{
+			if (difference == 0 && sign > 0) // the same length only once
+				break;
+			const size_t length = word.size() + sign * difference;
+			if (sign < 0 && static_cast<size_t>(difference) > word.size())
+				continue;
+			auto it = lower_bound(words.begin(), words.end(), length, [this](int index, size_t length)
+			{
+				return wordAt(index).size() < length;
+			});
+			for (; it != words.end() && wordAt(*it).size() == length && candidates.size() < kMaxCandidates; ++it)
+				candidates.push_back({ editDistance(word, wordAt(*it)), difference, wordAt(*it) });
+		}
+	}
+	sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+	{
+		if (a.distance != b.distance)
+			return a.distance < b.distance;
+		if (a.lengthDifference != b.lengthDifference)
+			return a.lengthDifference < b.lengthDifference;
+		return a.word < b.word;
+	});
+	for (const Candidate& candidate : candidates)
+	{
+		if (results.size() == maxResults)
+			break;
+		results.push_back(string(candidate.word));
+	}
+}
+
+bool Dictionary::searchAffixed(const std::string& word) const
+{
+	// O(A*L) where A is the number of affix rules and L is the length of the word
+	// Tries taking off every suffix and prefix the word could end or start with and looks for a stem with the right flag
+
+	string lower = word;
+	for (char& c : lower)
+		c = tolower(static_cast<unsigned char>(c));
+
+	if (searchSuffixed(lower, 0))
+		return true;
+
+	for (int len = 0; len <= m_affixes.maxPrefixAdd() && len < lower.size(); len++)
+	{
+		const vector<const AffixRules::Rule*>* rules = m_affixes.prefixesAdding(lower.substr(0, len));
+		if (rules == nullptr)
+			continue;
+		for (const AffixRules::Rule* rule : *rules)
+		{
+			string stem = rule->strip + lower.substr(len);
+			if (!AffixRules::applies(*rule, stem))
+				continue;
+			if (hasFlag(stem, rule->flag))
+				return true;
+			// the word might also have a suffix that can be combined with this prefix
+			if (rule->crossProduct && searchSuffixed(stem, rule->flag))
+				return true;
+		}
+	}
+	return false;
+}
+
+bool Dictionary::searchSuffixed(const std::string& word, char prefixFlag) const
+{
+	for (int len = 0; len <= m_affixes.maxSuffixAdd() && len < word.size(); len++)
+	{
+		const vector<const AffixRules::Rule*>* rules = m_affixes.suffixesAdding(word.substr(word.size() - len));
+		if (rules == nullptr)
+			continue;
+		for (const AffixRules::Rule* rule : *rules)
+		{
+			if (prefixFlag != 0 && !rule->crossProduct)
+				continue;
+			string stem = word.substr(0, word.size() - len) + rule->strip;
+			if (!AffixRules::applies(*rule, stem) || !hasFlag(stem, rule->flag))
+				continue;
+			if (prefixFlag == 0 || hasFlag(stem, prefixFlag))
+				return true;
+		}
+	}
+	return false;
+}
+
+void Dictionary::reportMemory(MemoryReport& report) const
+{
+	// O(T + N) where T is the number of trie nodes and N the number of words
+
+	vector<size_t> depths;
+	vector<size_t> fanOut(NUM_CHARS + 1, 0);
+	vector<pair<const TrieNode*, int>> stack; // nodes left to visit and their depth
+	stack.push_back(make_pair(root, 0));
+	while (!stack.empty())
+	{
+		const TrieNode* node = stack.back().first;
+		int depth = stack.back().second;
+		stack.pop_back();
+		if (depths.size() <= depth)
+			depths.resize(depth + 1, 0);
+		depths[depth]++;
+		int children = 0;
+		for (int i = 0; i < NUM_CHARS; i++)
+		{
+			if (node->children[i] != nullptr)
+			{
+				children++;
+				stack.push_back(make_pair(node->children[i], depth + 1));
+			}
+		}
+		fanOut[children]++;
+	}
+
+	const size_t words = MemoryReport::heapBytes(m_wordText) + MemoryReport::heapBytes(m_wordEnds);
+	size_t phonetic = MemoryReport::hashMapBytes(m_phonetic);
+	for (const auto& bucket : m_phonetic)
+		phonetic += MemoryReport::heapBytes(bucket.first) + MemoryReport::heapBytes(bucket.second);
+	size_t flagSets = MemoryReport::heapBytes(m_flagSets);
+	for (const string& flags : m_flagSets)
+		flagSets += MemoryReport::heapBytes(flags);
+
+	report.addCount("dictionary", "trie nodes", m_nodeCount);
+	report.addCount("dictionary", "words", m_wordEnds.size());
+	report.addCount("dictionary", "affix rules", m_affixes.size());
+	report.addBytes("dictionary", "trie", m_nodeCount * sizeof(TrieNode));
+	report.addBytes("dictionary", "word list", words);
+	report.addBytes("dictionary", "word ranks", MemoryReport::heapBytes(m_frequency) + MemoryReport::heapBytes(m_rank));
+	report.addBytes("dictionary", "phonetic index", phonetic);
+	report.addBytes("dictionary", "affix flag sets", flagSets);
+	report.addHistogram("dictionary", "trie nodes by depth", depths);
+	report.addHistogram("dictionary", "trie nodes by children", fanOut);
+}
@@ -0,0 +1,233 @@
+#ifndef DICTIONARY_H_
+#define DICTIONARY_H_
+
+#include "Affix.h"
+#include "MemoryReport.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <atomic>
+
+// File constants
+constexpr int NUM_CHARS = 27; // number of children a trie node should have, 27 for all letters plus an apostrophe
+constexpr int NUM_HINTS = 4; // number of best completions every trie node remembers
+constexpr size_t MAX_FLAG_SETS = 65536; // distinct flag sets a .dic can use, numbered in a trie node's unsigned short
+
+// An immutable-once-built dictionary
+// A Dictionary is built completely (possibly on a worker thread) and only then published to readers,
+// so once a reader can see it, nothing in it changes anymore
+class Dictionary {
+public:
+	Dictionary()
+	{
+		m_nodeCount = 0;
+		root = newNode();
+		m_flagSets.push_back(""); // flag set 0 is "no flags"
+	}
+	~Dictionary()
+	{
+		release(root);
+		root = nullptr;
+	}
+	Dictionary(const Dictionary&) = delete;
+	Dictionary& operator=(const Dictionary&) = delete;
+
+	// Builds the dictionary from the words in dictionaryFile
+	// A file ending in .dic is read as a Hunspell style stem+affix dictionary with its rules in the .aff file
+	// next to it, anything else is read as a flat list with one word per line
+	// Returns false if the file couldn't be opened, if a .dic uses more than MAX_FLAG_SETS distinct sets of flags
+	// (counting no flags), or if cancel was set while building
+	bool build(const std::string& dictionaryFile, const std::atomic<bool>* cancel = nullptr);
+
+	// Searches through dictionary if word is in the dictionary, either as it is or as a stem with affixes
+	bool search(const std::string& word) const
+	{
+		const TrieNode* node = findNode(word);
+		if (node != nullptr && node->isDefined)
+			return true;
+		if (m_affixes.empty()) // a flat dictionary has nothing left to try
+			return false;
+		return searchAffixed(word);
+	}
+
+	// Puts up to k words that start with prefix onto completions, best first
+	// Words are ranked by the frequency given in the file if any, then shorter words first, then alphabetically
+	// Up to NUM_HINTS completions come straight from the hints in the prefix's node, more cost O(k log k) work
+	void complete(const std::string& prefix, int k, std::vector<std::string>& completions) const;
+
+	// Puts up to maxResults dictionary words that sound like word onto results, closest spelling first
+	// Costs one lookup of word's phonetic key plus re-ranking the words in that bucket
+	void soundsLike(const std::string& word, int maxResults, std::vector<std::string>& results) const;
+
+	// Whether the dictionary is stem+affix compressed
+	bool isAffixed() const { return !m_affixes.empty(); }
+
+	// Number of nodes in the trie, the bulk of the dictionary's memory
+	size_t nodeCount() const { return m_nodeCount; }
+	static size_t nodeSize() { return sizeof(TrieNode); }
+
+	// Adds the trie (with histograms of node depth and of children per node), the word list and the
+	// phonetic index to report, under "dictionary"
+	void reportMemory(MemoryReport& report) const;
+
+	// getIndex of a character
+	// 0 to 25 for letters A to Z, 26 for apostrophe
+	// Case insensitive
+	// returns -1 if a character is not a valid letter
+	static int getIndex(char c)
+	{
+		if (c >= 'a' && c <= 'z')
+			return c - 'a';
+		if (c >= 'A' && c <= 'Z')
+			return c - 'A';
+		if (c == '\'')
+		{
+			return 26;
+		}
+		return -1; // if character is not a letter or an apostrophe
+	}
+
+	// returns a lowercase letter given an index
+	// 0 to 25 returns 'a' to 'z'
+	static char getLetter(int index)
+	{
+		if (index == 26)
+			return '\'';
+		return index + 'a';
+	}
+
+private:
+	// Trie Implementation
+	struct TrieNode
+	{
+		bool isDefined;
+		unsigned short flags; // index into m_flagSets, the affix flags of a stem
+		int word; // index of the listed word that ends here, -1 if none
+		int hints[NUM_HINTS]; // indexes of the best completions in this subtree, best first, -1 if fewer
+		TrieNode* children[NUM_CHARS];
+	};
+	TrieNode* root;
+	size_t m_nodeCount;
+
+	// The words listed in the file, back to back in one string rather than a string apiece, with their
+	// frequencies and their rank (0 is the best completion)
+	std::string m_wordText;
+	std::vector<unsigned> m_wordEnds; // where each word ends in m_wordText, and the next one starts
+	std::vector<unsigned> m_frequency;
+	std::vector<int> m_rank;
+
+	// Phonetic index, the words listed in the file grouped by their Metaphone key
+	// Each bucket is sorted by length, then by rank, so soundsLike() can go straight to the likeliest words
+	std::unordered_map<std::string, std::vector<int>> m_phonetic; // key -> indexes of listed words
+
+	AffixRules m_affixes; // empty for a flat dictionary
+	std::vector<std::string> m_flagSets; // every distinct set of flags a stem has
+
+	// The listed word with index i
+	std::string_view wordAt(int i) const
+	{
+		const unsigned start = i == 0 ? 0 : m_wordEnds[i - 1];
+		return std::string_view(m_wordText.data() + start, m_wordEnds[i] - start);
+	}
+
+	// Remembers a word listed in the file that ends at node, and adds it to the phonetic index
+	void addListedWord(TrieNode* node, const std::string& word, unsigned frequency);
+
+	// Ranks the listed words and fills in every node's completion hints, has to be done once all words are in
+	void computeHints();
+	void computeHints(TrieNode* seed);
+
+	bool buildFlat(std::istream& infile, const std::atomic<bool>* cancel);
+	bool buildAffixed(std::istream& infile, const std::atomic<bool>* cancel);
+
+	// Checks if word is a stem in the dictionary with one or two affixes on it
+	bool searchAffixed(const std::string& word) const;
+	// Checks if word is stem + a suffix whose rule can be combined with prefixFlag (0 means no prefix)
+	bool searchSuffixed(const std::string& word, char prefixFlag) const;
+
+	// Whether word is a stem in the dictionary with flag
+	bool hasFlag(const std::string& stem, char flag) const
+	{
+		const TrieNode* node = findNode(stem);
+		return node != nullptr && node->isDefined && m_flagSets[node->flags].find(flag) != std::string::npos;
+	}
+
+	// Inserts a word into the trie, returns the node where it ends
+	TrieNode* insertWordNode(const std::string& word)
+	{
+		TrieNode* trav = root;
+		for (char c : word)
+		{
+			int index = getIndex(c);
+			if (index == -1) // if char c is not a letter or an apostrophe
+			{
+				continue;
+			}
+			if (!trav->children[index]) // if the children[index] doesn't exist, make one
+			{
+				trav->children[index] = newNode();
+			}
+			trav = trav->children[index];
+		}
+		trav->isDefined = true; // after reaching destination node, note that the word is defined
+		return trav;
+	}
+
+	// Finds the node where word ends, nullptr if no word in the dictionary starts with word
+	const TrieNode* findNode(const std::string& word) const
+	{
+		if (word.empty()) // if the word is empty, then the word is not in the dictionary
+		{
+			return nullptr;
+		}
+		const TrieNode* trav = root;
+
+		// loop through the word, going to the appropriate node
+		for (char c : word)
+		{
+			int index = getIndex(c);
+			if (index == -1) // if a character is not a letter or an apostrophe, skip
+				continue;
+			if (!trav->children[index]) // if the children[index] doesn't exist then the word is not defined
+			{
+				return nullptr;
+			}
+			trav = trav->children[index]; // go down corresponding branch
+		}
+		return trav;
+	}
+
+	TrieNode* newNode() // returns a TrieNode ptr with initiliazed variables
+	{
+		TrieNode* tmp = new TrieNode;
+		m_nodeCount++;
+		tmp->isDefined = false;
+		tmp->flags = 0;
+		tmp->word = -1;
+		for (int i = 0; i < NUM_HINTS; i++)
+		{
+			tmp->hints[i] = -1;
+		}
+		for (int i = 0; i < NUM_CHARS; i++)
+		{
+			tmp->children[i] = nullptr;
+		}
+		return tmp;
+	}
+
+	// Frees a trie seed and it's children
+	void release(TrieNode* seed)
+	{
+		if (seed == nullptr)
+			return;
+		for (int i = 0; i < NUM_CHARS; i++)
+		{
+			release(seed->children[i]);
+		}
+		delete seed;
+	}
+};
+
+#endif // DICTIONARY_H_
@@ -0,0 +1,50 @@
+#include "DocStats.h"
+#include "LineStore.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+void DocStats::reset(const std::vector<std::string>& lines)
+{
+	m_lines.clear();
+	replace(0, 0, lines);
+}
+
+void DocStats::replace(int first, int oldCount, const std::vector<std::string>& lines)
+{
+	m_lines.replaceFrom(first, oldCount, lines.begin(), lines.size(), countLine);
+}
+
+void DocStats::replace(int first, int oldCount, LineStore::const_iterator line, int count)
+{
+	m_lines.replaceFrom(first, oldCount, line, count, countLine);
+}
+
+void DocStats::uncheckAll()
+{
+	m_lines.changeAll([](Line& line) { line.misspellings = -1; });
+}
+
+void DocStats::setMisspellings(int first, const int* counts, int count)
+{
+	m_lines.changeRange(first, count, [counts](int i, Line& line) { line.misspellings = counts[i]; });
+}
+
+DocStats::Line DocStats::countLine(const std::string& line)
+{
+	return Line{ static_cast<int>(line.size()), wordsIn(line), -1 };
+}
+
+int DocStats::wordsIn(const std::string& line)
+{
+	int words = 0;
+	bool inWord = false;
+	for (char c : line)
+	{
+		const bool space = c == ' ' || (c >= '\t' && c <= '\r'); // isspace() without the locale
+		if (!space && !inWord)
+			words++;
+		inWord = !space;
+	}
+	return words;
+}
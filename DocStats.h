@@ -0,0 +1,129 @@
+#ifndef DOCSTATS_H_
+#define DOCSTATS_H_
+
+#include "ImplicitTreap.h"
+#include "LineStore.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+
+// How many lines, words, characters and misspelled words a document has, kept up to date line by line
+// Lines are kept in document order in an ImplicitTreap that knows the sums of its subtrees: replacing,
+// adding or removing lines costs O(log n) plus counting the new lines' words, and the totals are the
+// root's sums. Spell checking is the slow part, so a line's misspellings start out unknown and are
+// filled in by whoever spell checks it, the first unknown line found in O(log n)
+class DocStats
+{
+public:
+	struct Totals
+	{
+		int lines;
+		long words; // runs of characters between spaces
+		long characters; // not counting line ends
+		long misspellings; // in the lines checked so far
+		int unchecked; // lines whose misspellings aren't known yet
+	};
+
+	DocStats() : m_lines(0x57a7) {}
+
+	// Count a whole document, O(n); none of it is checked
+	void reset(const std::vector<std::string>& lines);
+
+	// Lines [first, first+oldCount) were replaced by lines; only the new lines are counted, and they
+	// aren't checked
+	void replace(int first, int oldCount, const std::vector<std::string>& lines);
+	// The same for the count lines starting at line, which are read where they are rather than copied
+	void replace(int first, int oldCount, LineStore::const_iterator line, int count);
+
+	// The lines from first on were put in a new order, the ith being the one that was order[i]th, so
+	// their counts, misspellings too, move with them rather than being counted again, O(log n + count)
+	void reorder(int first, const std::vector<size_t>& order) { m_lines.reorder(first, order); }
+
+	// Forget every line's misspellings (e.g., for a new dictionary), O(n)
+	void uncheckAll();
+
+	// The first line whose misspellings aren't known, or -1 if they all are, O(log n)
+	int firstUnchecked() const
+	{
+		int line = 0;
+		for (const Node* node = m_lines.root(); node != nullptr && node->sum.unchecked > 0; )
+		{
+			if (Lines::sumOf(node->left).unchecked > 0)
+				node = node->left;
+			else if (node->item.misspellings < 0)
+				return line + Lines::sizeOf(node->left);
+			else
+			{
+				line += Lines::sizeOf(node->left) + 1;
+				node = node->right;
+			}
+		}
+		return -1;
+	}
+
+	// Record how many misspelled words a line has, O(log n)
+	void setMisspellings(int line, int count)
+	{
+		m_lines.change(line, [count](Line& found) { found.misspellings = count; });
+	}
+
+	// Record how many misspelled words each of a run of lines has, counts[i] for line first + i,
+	// O(log n + count)
+	void setMisspellings(int first, const int* counts, int count);
+
+	Totals totals() const
+	{
+		const Sum sum = m_lines.total();
+		return Totals{ m_lines.size(), sum.words, sum.characters, sum.misspellings, sum.unchecked };
+	}
+
+	// Trade counts with other, O(1)
+	void swap(DocStats& other) { m_lines.swap(other.m_lines); }
+
+	size_t bytes() const { return m_lines.bytes(); }
+
+	// Runs of characters between spaces
+	static int wordsIn(const std::string& line);
+
+private:
+	struct Line
+	{
+		int characters;
+		int words;
+		int misspellings; // -1 until it's checked
+	};
+
+	struct Sum
+	{
+		long characters;
+		long words;
+		long misspellings;
+		int unchecked; // lines
+	};
+
+	struct LineSummary
+	{
+		typedef DocStats::Line Item;
+		typedef DocStats::Sum Sum;
+		static Sum sumOf(const Line& line)
+		{
+			return Sum{ line.characters, line.words, line.misspellings < 0 ? 0 : line.misspellings, line.misspellings < 0 ? 1 : 0 };
+		}
+		static void add(Sum& sum, const Sum& more)
+		{
+			sum.characters += more.characters;
+			sum.words += more.words;
+			sum.misspellings += more.misspellings;
+			sum.unchecked += more.unchecked;
+		}
+	};
+	typedef ImplicitTreap<LineSummary> Lines;
+	typedef Lines::Node Node;
+
+	// A new line's counts, not checked yet
+	static Line countLine(const std::string& line);
+
+	Lines m_lines;
+};
+
+#endif // DOCSTATS_H_
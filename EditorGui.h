@@ -11,6 +11,31 @@
 #include "TextEditor.h"
 #include "SpellCheck.h"
 #include "TextIO.h"
+#include "InputReader.h"
+#include "FileLoader.h"
+#include "FileWatcher.h"
+#include "FileSaver.h"
+#include "MisspellingCounter.h"
+#include "LineDiff.h"
+#include "FrameRenderer.h"
+#include "Trace.h"
+#include "MemoryReport.h"
+#include "WrapLayout.h"
+#include "DocStats.h"
+#include "TextSearch.h"
+#include "Regex.h"
+#include "LineTransform.h"
+#include <climits>
+#include <cstdlib>
+#include <cctype>
+#include <algorithm>
+#include <cstring>
+#include <strings.h>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
 
 class EditorGui {
 public:
@@ -22,35 +47,74 @@ public:
 		undo_ = createUndo();
 		te_ = createTextEditor(undo_);
 		spell_check_ = createSpellCheck();
+		loader_.reset(new FileLoader);
+		watcher_.reset(new FileWatcher);
+		saver_.reset(new FileSaver);
+		buffers_.emplace_back(new Buffer);	// the slot of the buffer on screen
+		buffer_ = 0;
 		rows_ = rows - 1; // leave the last row for status/loading files.
 		cols_ = cols;
+		renderer_.reset(new FrameRenderer(rows_, cols_));
 		top_ = 0;
 		left_ = 0;
+		mark_ = -1;
 		loaded_dictionary_ = false;
+		loading_dictionary_ = false;
+		dictionary_generation_ = 0;
+		completing_ = false;
+		completion_index_ = 0;
+		completion_prefix_length_ = 0;
+		needs_redisplay_ = false;
+		disk_synced_ = false;
+		wrap_ = false;
+		damaged_ = false;
+		compress_lines_ = false;
+		find_options_ = 0;
+		frame_version_ = 0;
+		stop_rendering_ = false;
+		stage_times_ = nullptr;
+		stats_.reset(std::vector<std::string>(1));	// the text always has a line
 	}
 
 	// EditorGui destructor.
 	~EditorGui() {
+		stopThreads();
 		delete te_;
 		delete undo_;
 		delete spell_check_;
+		for (const auto& buffer : buffers_) {
+			delete buffer->te;
+			delete buffer->undo;
+			delete buffer->spell_check;
+		}
 	}
 
 	// Used to load the specified dictionary.
 	// dictionary: The fill path and filename of the dictionary.txt file, e.g., c:\cs32\proj4\dictionary.txt
 	// Returns true if the dictionary was successfully loaded.
 	bool loadDictionary(const std::string& dictionary) {
-		if (spell_check_->load(dictionary))
+		if (spell_check_->load(dictionary)) {
 			loaded_dictionary_ = true;
+			dictionary_generation_ = spell_check_->generation();
+			uncheckAllBuffers();
+		}
 
 		return loaded_dictionary_;
 	}
 
+	// Starts loading the specified dictionary in the background. Editing continues with the
+	// old dictionary (if any) and highlighting switches over once the new one is ready.
+	// Returns true if the dictionary file could be opened.
+	bool loadDictionaryInBackground(const std::string& dictionary) {
+		loading_dictionary_ = spell_check_->loadAsync(dictionary);
+		return loading_dictionary_;
+	}
+
 	void promptAndLoadDictionary() {
 		std::string dictionary;
 		if (getInput("Enter dictionary path/filename: ", dictionary)) {
-			if (loadDictionary(dictionary)) {
-				writeStatus("Loaded dictionary successfully!");
+			if (loadDictionaryInBackground(dictionary)) {
+				writeStatus("Loading dictionary...");
 			}
 			else
 				writeStatus("Unable to load dictionary.");
@@ -62,7 +126,9 @@ public:
 
 	// Used to load a text file into your text editor.
 	// file_to_load: The name of the file to load.
-	void loadFileToEdit(const std::string& file_to_load = "") {
+	// in_background: True to show the top of the file as soon as it's read and read the rest on a loader
+	//   thread while the user edits, false to read the whole file before returning.
+	void loadFileToEdit(const std::string& file_to_load = "", bool in_background = false) {
 		int cur_row, cur_col;
 		te_->getPos(cur_row, cur_col);
 		std::string filename = file_to_load;
@@ -76,48 +142,485 @@ public:
 				return;
 			}
 		}
+		finishSaving();	// the text being saved is about to go
+
+		if (in_background) {
+			if (!loader_->start(filename, rows_)) {
+				writeStatus("Unable to load file.");
+				publishFrame(false);
+				return;
+			}
+			watcher_->stop();	// until it's all loaded
+			te_->beginLoad();
+			takeDamage(true);
+			disk_synced_ = true;
+			filename_ = filename;
+			resetCursorToTopOfFile();
+			load_status_.clear();
+			writeStatus("");
+			// The first piece is only a window's worth of lines, so it shows up right away.
+			while (!loader_->ready())
+				std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			checkFileLoaded();
+			return;
+		}
 
 		// Load the file and display the appropriate status (success/fail) on the screen's status line.
+		loader_->stop();
 		const bool loaded = te_->load(filename);
 		if (loaded) {
 			filename_ = filename;
+			disk_synced_ = true;
+			watchFile();
 			resetCursorToTopOfFile();
 			writeStatus("Loaded file successfully!");
 			redisplayTheEditorWindowAndPositionCursor(false);
 		}
-		else
+		else {
 			writeStatus("Unable to load file.");
+			publishFrame(false);
+		}
 	}
 
 	// Run our main text editor. When this function returns, it means the user decided to quit/exit
 	// from the editor.
+	// Keys are read on an input thread and the window is drawn on a render thread, while this thread
+	// does the editing; the three only meet at the key queue and the latest frame.
 	void run() {
-		bool cont;
+		Trace::nameThread("editor");
+		input_.start();
+		stop_rendering_ = false;
+		render_thread_ = std::thread(&EditorGui::renderFrames, this);
+		publishFrame(false);
+
+		bool cont = true;
 		do {
-			const int ch = TextIO::getChar();
-			cont = processKey(ch);
+			// While a file or a dictionary is loading in the background, wake up every so often to see
+			// how it's going instead of waiting for the next key, and to see if the file changed on disk.
+			const bool counting = loaded_dictionary_ && stats_.totals().unchecked > 0;
+			const int ch = nextKey(loader_->loading() || saver_->saving() || counting ? kLoadPollMillis : loading_dictionary_ ? kDictionaryPollMillis :
+				watcher_->watching() ? kWatchPollMillis : -1);
+			if (ch != ERR) {
+				// Everything else the user typed (or pasted) while we were busy is handled along with
+				// this key, and the window is redrawn once for all of them.
+				std::vector<int> keys(1, ch);
+				readPendingKeys(keys);
+				cont = processKeys(keys);
+			}
+			checkDictionaryLoaded();
+			checkFileLoaded();
+			checkFileSaved();
+			checkFileChanged();
+			compressColdLines();
+			countMisspellings();
 		} while (cont);
+		stopThreads();
+		if (Trace::enabled() && !Trace::outputFile().empty()) Trace::dump(Trace::outputFile());
+	}
+
+	// How long the stages of handling a key took, in microseconds.
+	struct StageTimes {
+		double edit;	// changing the document and working out what the window shows
+		double frame;	// taking snapshots of the window
+		double render;	// spell checking and drawing them
+	};
+
+	// Handle one key the way run() does, but without the input and render threads, so a tool can drive
+	// the editor a key at a time (e.g., from a FrameBuffer) and see where the time goes. Keys that
+	// start a paste or a prompt read the keys after them as usual.
+	// ch: The key.
+	// times: Filled in with how long each stage took, unless it's null.
+	// Returns true if the user wants to keep editing, and false if they want to quit editing (Ctrl-X).
+	bool step(int ch, StageTimes* times = nullptr) {
+		StageTimes spent = { 0, 0, 0 };
+		stage_times_ = &spent;
+		const auto start = std::chrono::steady_clock::now();
+		std::vector<int> keys(1, ch);
+		const bool cont = processKeys(keys);
+		checkDictionaryLoaded();
+		checkFileLoaded();
+		checkFileSaved();
+		checkFileChanged();
+		compressColdLines();
+		countMisspellings();
+		stage_times_ = nullptr;
+		spent.edit = microsecondsSince(start) - spent.frame - spent.render;
+		if (times != nullptr) *times = spent;
+		return cont;
 	}
 
-	// Print the status line on the bottom of the screen, overwriting other text that might have been there before.
+	// Keep the lines far from the cursor compressed from now on (e.g., for a file too big to edit
+	// otherwise), or stop packing more of them.
+	void compressLines(bool on) {
+		compress_lines_ = on;
+		compressColdLines();
+	}
+
+	// Add up what the document, the undo history, the dictionary, the caches and the snapshot of the
+	// window take up.
+	void reportMemory(MemoryReport& report) const {
+		te_->reportMemory(report);
+		undo_->reportMemory(report);
+		spell_check_->reportMemory(report);
+		for (const auto& buffer : buffers_) {
+			if (buffer->te == nullptr) continue;	// the slot of the buffer on screen
+			buffer->te->reportMemory(report);
+			buffer->undo->reportMemory(report);
+		}
+		if (last_frame_) {
+			size_t bytes = sizeof(Frame) + MemoryReport::heapBytes(last_frame_->lines);
+			for (const auto& line : last_frame_->lines) {
+				if (line) bytes += sizeof(std::string) + MemoryReport::heapBytes(*line);
+			}
+			report.addBytes("screen", "window snapshot", bytes);
+		}
+		if (wrap_) report.addBytes("screen", "wrap layout", layout_.bytes());
+		size_t stats = stats_.bytes();
+		for (const auto& buffer : buffers_)
+			stats += buffer->stats.bytes();
+		report.addBytes("text", "statistics", stats);
+	}
+
+	// Set the status line on the bottom of the screen, replacing what was there before. It shows up
+	// with the next frame.
 	// line: The status line to display.
 	void writeStatus(const std::string& line) {
-		TextIO::move(rows_, 0);
-		if (line.length() <= cols_) {
-			TextIO::print(line);
-			TextIO::print(std::string(cols_ - line.length(), ' '));
-		}
-		else
-			TextIO::print(line.substr(0, cols_));
+		status_ = line.substr(0, cols_);
 	}
 
 private:
+	// What the editor keeps about each open file. The buffer on screen lives in the editor's own members,
+	// leaving its slot in buffers_ empty; the others wait there until switchBuffer() trades them back.
+	struct Buffer {
+		std::string filename;
+		TextEditor* te = nullptr;
+		Undo* undo = nullptr;
+		SpellCheck* spell_check = nullptr;	// shares the dictionary, with caches of its own
+		std::unique_ptr<FileLoader> loader;
+		std::unique_ptr<FileWatcher> watcher;
+		std::unique_ptr<FileSaver> saver;
+		bool disk_synced = false;
+		int top = 0, left = 0;
+		int mark = -1;
+		bool wrap = false;
+		WrapLayout layout;
+		DocStats stats;
+	};
+
+	// Rows [first, first + old_count) of the text became rows [first, first + new_count).
+	struct Change {
+		int first, old_count, new_count;
+	};
+
+	// Get the next key the user pressed, from the input thread if it's running.
+	// timeout_millis: How long to wait for a key, forever if negative.
+	// Returns ERR if no key came in time.
+	int nextKey(int timeout_millis) {
+		if (input_.running()) return input_.getKey(timeout_millis);
+		TextIO::setInputTimeout(timeout_millis);
+		return TextIO::getChar();
+	}
+
+	// Stop the input and render threads (if they're running), after the last frame is drawn.
+	void stopThreads() {
+		input_.stop();
+		loader_->stop();
+		saver_->finish();	// the file has to be all written before the editor exits
+		watcher_->stop();
+		counter_.stop();
+		for (const auto& buffer : buffers_) {
+			if (buffer->te == nullptr) continue;
+			buffer->loader->stop();
+			buffer->saver->finish();
+			buffer->watcher->stop();
+		}
+		if (!render_thread_.joinable()) return;
+		{
+			std::lock_guard<std::mutex> lock(frame_mutex_);
+			stop_rendering_ = true;
+		}
+		frame_ready_.notify_one();
+		render_thread_.join();
+	}
+
+	// The render thread: draw the latest frame whenever there's a new one. Frames that get replaced
+	// before the thread gets to them are never drawn.
+	void renderFrames() {
+		Trace::nameThread("render");
+		int drawn = 0;
+		for (;;) {
+			std::shared_ptr<const Frame> frame;
+			{
+				std::unique_lock<std::mutex> lock(frame_mutex_);
+				frame_ready_.wait(lock, [&] { return stop_rendering_ || frame_version_ != drawn; });
+				if (frame_version_ == drawn) return;
+				frame = latest_frame_;
+				drawn = frame_version_;
+			}
+			renderer_->draw(*frame);
+		}
+	}
+
+	// Take a snapshot of the editor window and hand it to the render thread, or draw it right away if
+	// there's no render thread.
+	// show_suggestions: True to show spelling suggestions for the word under the cursor on the status line.
+	// cursor_row, cursor_col: Where to put the cursor on the screen; by default where the user is editing.
+	void publishFrame(bool show_suggestions, int cursor_row = -1, int cursor_col = -1) {
+		const auto start = std::chrono::steady_clock::now();
+		std::shared_ptr<const Frame> frame = buildFrame(show_suggestions, cursor_row, cursor_col);
+		if (stage_times_ != nullptr) stage_times_->frame += microsecondsSince(start);
+		if (!render_thread_.joinable()) {
+			const auto drawn = std::chrono::steady_clock::now();
+			renderer_->draw(*frame);
+			if (stage_times_ != nullptr) stage_times_->render += microsecondsSince(drawn);
+			return;
+		}
+		{
+			std::lock_guard<std::mutex> lock(frame_mutex_);
+			latest_frame_ = frame;
+			++frame_version_;
+		}
+		frame_ready_.notify_one();
+	}
+
+	static double microsecondsSince(std::chrono::steady_clock::time_point start) {
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+	}
+
+	// Build a snapshot of the editor window. Lines the text editor says didn't change since the last
+	// frame are shared with it instead of being fetched again.
+	std::shared_ptr<const Frame> buildFrame(bool show_suggestions, int cursor_row, int cursor_col) {
+		TRACE_SCOPE("buildFrame");
+		std::shared_ptr<Frame> frame = std::make_shared<Frame>();
+		frame->top = top_;
+		frame->left = left_;
+		frame->wrap = wrap_;
+		frame->show_suggestions = show_suggestions;
+		frame->spell_check = loaded_dictionary_;
+		frame->checker = spell_check_;
+		frame->generation = dictionary_generation_;
+		if (cursor_row < 0) {
+			int cur_row, cur_col;
+			te_->getPos(cur_row, cur_col);
+			cursor_row = std::max(0, std::min(getCurDistFromTopRow(), rows_ - 1));
+			cursor_col = std::max(0, std::min(wrap_ ? cur_col % cols_ : cur_col - left_, cols_ - 1));
+		}
+		frame->cursor_row = cursor_row;
+		frame->cursor_col = cursor_col;
+
+		// Work out which line, and which column of it, each row of the window starts at.
+		takeDamage();
+		frame->status = statusWithStats();
+		std::vector<int> rows(rows_);
+		frame->starts.assign(rows_, left_);
+		for (int i = 0; i < rows_; ++i) {
+			if (!wrap_)
+				rows[i] = top_ + i;
+			else if (top_ + i >= layout_.rows())
+				rows[i] = INT_MAX;	// past the end of the file
+			else {
+				int within;
+				rows[i] = layout_.lineAt(top_ + i, within);
+				frame->starts[i] = within * cols_;
+			}
+		}
+
+		// Take the lines that didn't change from the last frame, allowing for the rows that were added
+		// or removed above them.
+		frame->lines.resize(rows_);
+		std::vector<bool> fetch(rows_, true);
+		for (int i = 0; i < rows_; ++i) {
+			int row = rows[i];
+			if (row == INT_MAX) {
+				fetch[i] = false;
+				continue;
+			}
+			if (damaged_ && row >= damage_first_) {
+				if (row < damage_new_end_) continue;
+				row += damage_old_end_ - damage_new_end_;
+			}
+			const auto shown = std::lower_bound(last_rows_.begin(), last_rows_.end(), row);
+			if (shown != last_rows_.end() && *shown == row) {
+				frame->lines[i] = last_frame_->lines[shown - last_rows_.begin()];
+				fetch[i] = false;
+			}
+		}
+		damaged_ = false;
+
+		// Fetch the rest, a run of consecutive lines at a time.
+		for (int i = 0; i < rows_; ) {
+			if (!fetch[i]) {
+				++i;
+				continue;
+			}
+			int end = i + 1;
+			while (end < rows_ && fetch[end] && rows[end] - rows[end - 1] <= 1)
+				++end;
+			std::vector<std::string> lines;
+			{
+				TRACE_SCOPE("getLines");
+				te_->getLines(rows[i], rows[end - 1] - rows[i] + 1, lines);
+			}
+			for (int row = i; row < end && rows[row] - rows[i] < lines.size(); ++row) {
+				if (row > i && rows[row] == rows[row - 1])
+					frame->lines[row] = frame->lines[row - 1];
+				else
+					frame->lines[row] = std::make_shared<const std::string>(std::move(lines[rows[row] - rows[i]]));
+			}
+			i = end;
+		}
+		last_frame_ = frame;
+		last_rows_ = rows;
+		return frame;
+	}
+
+	// Collect the lines the text editor changed since it was last asked, to be fetched again for the
+	// next frame, and count them and lay them out again if long lines wrap. Only the changed lines are
+	// counted and laid out, read from a snapshot of the text where they are rather than copied out.
+	// A few lines, like a key's worth, are spell checked right away so the count on the status line
+	// stays exact; countMisspellings() gets to the rest, and is told of the change so the counts it's
+	// working on skip the changed lines.
+	// from_disk: True if the changes are lines read from the file being edited, so the text still
+	//   matches what's on disk.
+	// order: If the change only put the lines from first on in a new order, the line each of them was,
+	//   so their counts and layout are moved rather than worked out again.
+	void takeDamage(bool from_disk = false, const std::vector<size_t>* order = nullptr) {
+		int first, old_count, new_count;
+		if (!te_->takeDamage(first, old_count, new_count)) return;
+		if (!from_disk) disk_synced_ = false;
+		if (counter_.counting()) count_changes_.push_back(Change{ first, old_count, new_count });
+		if (mark_ >= first + old_count)
+			mark_ += new_count - old_count;
+		else if (mark_ >= first + new_count)
+			mark_ = std::max(first, first + new_count - 1);	// its line went, so it stays on the last of the new ones
+		if (order != nullptr) {
+			stats_.reorder(first, *order);
+			if (wrap_) layout_.reorder(first, *order);
+		}
+		else {
+			const LineStore::Snapshot text = te_->snapshot();	// let go of before the next edit, so it copies nothing
+			stats_.replace(first, old_count, text.at(first), new_count);
+			if (wrap_) layout_.replace(first, old_count, text.at(first), new_count);
+			if (loaded_dictionary_ && new_count <= kCheckLinesRightAway) {
+				auto line = text.at(first);
+				for (int i = 0; i < new_count; ++i, ++line)
+					checkLine(first + i, *line);
+			}
+		}
+		if (!damaged_) {
+			damaged_ = true;
+			damage_first_ = first;
+			damage_old_end_ = first + old_count;
+			damage_new_end_ = first + new_count;
+			return;
+		}
+		// Merge it with the change the next frame already has to fetch, which is in terms of the text
+		// before this change.
+		const int end = std::max(first + old_count, damage_new_end_);
+		damage_old_end_ += end - damage_new_end_;
+		damage_new_end_ = end + new_count - old_count;
+		damage_first_ = std::min(first, damage_first_);
+	}
+
+	// Read the keys that are already waiting, without waiting for more, until the frame deadline passes.
+	// Stops after a key that prompts the user, since the prompt reads the keys that come after it.
+	// keys: The batch of keys to add the waiting keys to.
+	void readPendingKeys(std::vector<int>& keys) {
+		const auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(kFrameMillis);
+		while (!promptsUser(keys.back()) && std::chrono::steady_clock::now() < deadline) {
+			const int ch = nextKey(0);
+			if (ch == ERR) break;
+			keys.push_back(ch);
+		}
+	}
+
+	// Process a batch of keys, turning pasted text into a single insert, and redisplay the editor
+	// window once afterwards if any of them changed it.
+	// keys: The keys to process. Keys are read and added to it if a paste goes on past its end.
+	// Returns true if the user wants to keep editing, and false if they want to quit editing (Ctrl-X).
+	bool processKeys(std::vector<int>& keys) {
+		for (size_t i = 0; i < keys.size(); ++i) {
+			if (keys[i] == kEscape && matchesAt(keys, i, TextIO::kPasteStart)) {
+				i = insertPaste(keys, i + strlen(TextIO::kPasteStart));
+				continue;
+			}
+			// Bring the screen up to date before the user gets asked or told anything.
+			if (writesStatus(keys[i]) && needs_redisplay_) {
+				needs_redisplay_ = false;
+				redisplayTheEditorWindowAndPositionCursor();
+			}
+			if (!processKey(keys[i])) return false;
+		}
+		if (needs_redisplay_) {
+			needs_redisplay_ = false;
+			redisplayTheEditorWindowAndPositionCursor();
+		}
+		return true;
+	}
+
+	// Insert pasted text into the document as one edit.
+	// keys: The batch of keys the paste is in. Keys are read and added to it until the end of the paste.
+	// start: Where the pasted text starts in keys.
+	// Returns the position of the last key of the paste in keys.
+	size_t insertPaste(std::vector<int>& keys, size_t start) {
+		std::string text;
+		size_t i = start;
+		for (;; ++i) {
+			const int ch = keyAt(keys, i, kPasteMillis);
+			if (ch == ERR) break;	// The end of the paste never came, insert what did.
+			if (ch == kEscape && matchesAt(keys, i, TextIO::kPasteEnd)) {
+				i += strlen(TextIO::kPasteEnd) - 1;
+				break;
+			}
+			if (ch == KEY_ENTER)
+				text += '\n';
+			else if (ch < 256)
+				text += static_cast<char>(ch);
+		}
+		if (!text.empty()) {
+			te_->insertText(text);
+			needs_redisplay_ = true;
+		}
+		completing_ = false;
+		return i;
+	}
+
+	// Get the key at position i of a batch, reading more keys if the batch isn't that long yet.
+	// Returns ERR if no key showed up within timeout_millis.
+	int keyAt(std::vector<int>& keys, size_t i, int timeout_millis) {
+		while (i >= keys.size()) {
+			const int ch = nextKey(timeout_millis);
+			if (ch == ERR) return ERR;
+			keys.push_back(ch);
+		}
+		return keys[i];
+	}
+
+	// Check if a batch of keys has the characters of an escape sequence at position i.
+	bool matchesAt(std::vector<int>& keys, size_t i, const char* sequence) {
+		for (int k = 0; sequence[k] != '\0'; ++k) {
+			if (keyAt(keys, i + k, kSequenceMillis) != sequence[k]) return false;
+		}
+		return true;
+	}
+
+	// Check if a key asks the user something on the status line.
+	static bool promptsUser(const int ch) {
+		return ch == CTRL_S || ch == CTRL_L || ch == CTRL_D || ch == CTRL_X || ch == CTRL_F || ch == CTRL_R || ch == CTRL_E || ch == CTRL_U;
+	}
+
+	// Check if a key leaves a message on the status line, which a later redisplay would clear.
+	static bool writesStatus(const int ch) {
+		return promptsUser(ch) || ch == CTRL_N || ch == CTRL_G || ch == CTRL_T || ch == CTRL_O || ch == CTRL_B || ch == CTRL_K || ch == CTRL_Y;
+	}
 
 	// Process each key that the user presses and call the appropriate function in the student's
-	// editor class.
+	// editor class. The editor window is redisplayed by whoever processes the batch the key is in.
 	// ch: The character that was pressed (e.g., a letter, backspace, tab, enter, delete, ctrl-L, ctrl-S, ctrl-X).
 	// Returns true if the user wants to keep editing, and false if they want to quit editing (Ctrl-X).
 	bool processKey(const int ch) {
+		TRACE_SCOPE("processKey");
+		if (ch != CTRL_N) completing_ = false; // any other key accepts the current completion
 		switch (ch) {
 		case KEY_UP:
 			te_->move(TextEditor::Dir::UP);
@@ -156,7 +659,7 @@ private:
 			save();
 			return true;
 		case CTRL_L:	// Throw away existing file and load up a new file
-			loadFileToEdit();
+			loadFileToEdit("", true);
 			return true;
 		case CTRL_Z:	// Undo last change
 			te_->undo();
@@ -164,6 +667,42 @@ private:
 		case CTRL_D:
 			promptAndLoadDictionary();
 			break;
+		case CTRL_N:	// Complete the word in front of the cursor
+			completeWordBeforeCursor();
+			return true;
+		case CTRL_G:	// Start tracing, or write out what was traced so far
+			traceOrDumpTrace();
+			return true;
+		case CTRL_T:	// Show how much memory each part of the editor takes up
+			showMemoryUsage();
+			return true;
+		case CTRL_W:	// Wrap long lines, or go back to scrolling sideways
+			toggleWrap();
+			break;
+		case CTRL_F:	// Find text as it's typed
+			incrementalFind();
+			break;
+		case CTRL_R:	// Replace every match of a regular expression
+			findAndReplace();
+			return true;
+		case CTRL_O:	// Go to the next line the word under the cursor is on
+			nextOccurrence();
+			return true;
+		case CTRL_E:	// Open a file in a buffer of its own
+			openBuffer();
+			return true;
+		case CTRL_B:	// Show the next open buffer
+			nextBuffer();
+			return true;
+		case CTRL_K:	// Mark the line the cursor is on, or take the mark away
+			toggleMark();
+			return true;
+		case CTRL_U:	// Sort, deduplicate, filter or reindent the marked lines or the whole document
+			transformLines();
+			return true;
+		case CTRL_Y:	// Reload the file from disk, after another program changed it
+			reloadFile();
+			return true;
 		case CTRL_X:
 			if (quit()) return false;
 			break;
@@ -172,7 +711,7 @@ private:
 			if (ch < 256) te_->insert(static_cast<char>(ch));
 			break;
 		}
-		redisplayTheEditorWindowAndPositionCursor();
+		needs_redisplay_ = true;
 		return true;
 	}
 
@@ -185,9 +724,7 @@ private:
 			te_->move(TextEditor::Dir::UP);
 
 		// Make sure the GUI positions the cursor on the proper row of the screen.
-		int cur_row, cur_col;
-		te_->getPos(cur_row, cur_col);
-		top_ = cur_row - cursor_dist_from_top;
+		top_ = getCursorScreenRow() - cursor_dist_from_top;
 		if (top_ < 0) top_ = 0;
 	}
 
@@ -200,82 +737,112 @@ private:
 			te_->move(TextEditor::Dir::DOWN);
 
 		// Make sure the GUI positions the cursor on the proper row of the screen.
-		int cur_row, cur_col;
-		te_->getPos(cur_row, cur_col);
-		top_ = cur_row - cursor_dist_from_top;
+		top_ = getCursorScreenRow() - cursor_dist_from_top;
 		if (top_ < 0) top_ = 0;
 	}
 
 	// Get the distance from the top of the screen to the current row where the cursor
 	// is being displayed. 
 	// Returns the vertical distance of the user's cursor in the editor from the top of the screen.
-	int getCurDistFromTopRow() const {
+	int getCurDistFromTopRow() {
+		return getCursorScreenRow() - top_;
+	}
+
+	// Get the row the cursor is on, counting from the top of the document: its line, or with wrap on,
+	// the screen row it's on if the whole document were shown.
+	int getCursorScreenRow() {
 		int cur_row, cur_col;
 		te_->getPos(cur_row, cur_col);
-		return cur_row - top_;
+		if (!wrap_) return cur_row;
+		takeDamage();
+		return static_cast<int>(layout_.rowOf(cur_row)) + cur_col / cols_;
+	}
+
+	// Switch between wrapping long lines onto the rows below them and scrolling sideways to see them,
+	// keeping the same line at the top of the window.
+	void toggleWrap() {
+		takeDamage();
+		if (!wrap_) {
+			std::vector<std::string> lines;
+			te_->getLines(0, INT_MAX, lines);
+			layout_.reset(cols_, lines);
+			top_ = static_cast<int>(layout_.rowOf(top_));
+		}
+		else {
+			int within;
+			top_ = layout_.lineAt(top_, within);
+			layout_.reset(cols_, std::vector<std::string>());
+		}
+		wrap_ = !wrap_;
+		left_ = 0;
 	}
 
-	// Get a list of spelling suggestions for the word in the editor that the cursor is currently
-	// positioned on top of. If the word is spelled correctly, this returns the empty string.
-	// Otherwise it returns a string like: "Spelling suggestions: apple, ample" if there are
-	// suggestions or "No spelling suggestions." if there are no suggestions.
-	// Returns the suggestion string.
-	std::string getSuggestionString() {
+	// Get the part of the word in front of the cursor, e.g. "wal" if the cursor is right after "wal" in "walrus".
+	// Returns the empty string if the cursor isn't right after a word character.
+	std::string getWordBeforeCursor() {
 		int cur_row, cur_col;
 		te_->getPos(cur_row, cur_col);
 		std::vector<std::string> lines;
 		te_->getLines(cur_row, 1, lines);
-		if (lines.empty()) return "";  // empty line
-		if (cur_col >= lines[0].length()) return ""; // at end of line
-		if (!isWordChar(lines[0][cur_col])) return "";  // not on a word
+		if (lines.empty()) return "";
+		int start = cur_col;
+		while (start > 0 && SpellCheck::isWordChar(lines[0][start - 1]))
+			--start;
+		return lines[0].substr(start, cur_col - start);
+	}
 
-		// Extract the full word that the cursor is sitting on.
-		while (cur_col >= 0 && isWordChar(lines[0][cur_col]))
-			--cur_col;
-		++cur_col;
-		std::string cur_word;
-		while (cur_col != lines[0].length() && isWordChar(lines[0][cur_col])) {
-			cur_word += lines[0][cur_col];
-			++cur_col;
+	// Complete the word in front of the cursor with the best word from the dictionary that starts with it,
+	// listing the other completions on the status line. Pressing the key again right away replaces the
+	// completion with the next one in the list.
+	void completeWordBeforeCursor() {
+		if (completing_) {
+			// Take back the completion that was inserted last time, which was one undo step of its own,
+			// and move on to the next one, so only the completion the user keeps is left to undo.
+			te_->undo();
+			completion_index_ = (completion_index_ + 1) % completions_.size();
 		}
-
-		// Ask the student's spell checker if the word is spelled correctly, and if not
-		// for up to kNumSuggestions suggestions.
-		const int kNumSuggestions = 20;
-		std::vector<std::string> suggestions;
-		suggestions.clear();
-		if (spell_check_->spellCheck(cur_word, kNumSuggestions, suggestions)) return "";
-
-		// Create a string with the suggestions (if any).
-		std::string sugg_line;
-		std::string sugg_base = "Spelling suggestions: ";
-		const int kCommaLength = 2;
-		for (const auto& s : suggestions) {
-			if (sugg_line.length() + s.length() + sugg_base.length() + kCommaLength <= cols_) {
-				if (!sugg_line.empty()) sugg_line += ", ";
-				sugg_line += s;
+		else {
+			const std::string prefix = getWordBeforeCursor();
+			completions_.clear();
+			if (!prefix.empty()) {
+				std::vector<std::string> found;
+				spell_check_->complete(prefix, kNumCompletions + 1, found);
+				for (const auto& word : found) {
+					// The word itself isn't a completion.
+					if (word.length() > prefix.length() && completions_.size() < kNumCompletions)
+						completions_.push_back(word);
+				}
+			}
+			if (completions_.empty()) {
+				writeStatus(prefix.empty() ? "No word to complete." : "No completions.");
+				redisplayTheEditorWindowAndPositionCursor(false);
+				return;
 			}
+			completion_prefix_length_ = static_cast<int>(prefix.length());
+			completion_index_ = 0;
 		}
 
-		if (sugg_line.empty()) return "No spelling suggestions.";
+		// Insert the rest of the chosen completion after what the user already typed, as one edit.
+		const std::string& word = completions_[completion_index_];
+		te_->insertText(word.substr(completion_prefix_length_));
+		completing_ = true;
 
-		return sugg_base + sugg_line;
-	}
-
-	// Check to see if a character is part of a word. This includes all letters as well as the apostrophe
-	// character ' right now. You may wish to expand this to include hyphens in the future.
-	// ch: The character to check.
-	// Returns true if the character is one that's considered part of a word.
-	bool isWordChar(const char ch) {
-		if (ch < 0) return false;
-		return isalpha(ch) || ch == '\'';
+		// List the completions with the chosen one in brackets.
+		std::string status = "Completions:";
+		for (int i = 0; i < completions_.size(); ++i)
+			status += (i == completion_index_) ? " [" + completions_[i] + "]" : " " + completions_[i];
+		writeStatus(status);
+		redisplayTheEditorWindowAndPositionCursor(false);
 	}
 
 	// Redisplay the entire editor window (all text being edited, in white and red) and then
-	// reposition the cursor in the right place after displaying all of the text.
+	// reposition the cursor in the right place after displaying all of the text. Only what changed
+	// is actually sent to the terminal.
 	// clear_status_line: If true, this causes the function to clear the status line at
 	// the bottom of the screen.
-	void redisplayTheEditorWindowAndPositionCursor(bool clear_status_line = true) {
+	// show_suggestions: If true, spelling suggestions for the word under the cursor take the place of
+	// the status line.
+	void redisplayTheEditorWindowAndPositionCursor(bool clear_status_line = true, bool show_suggestions = true) {
 
 		// Compute how the screen should have shifted based on the keypress (e.g., pg-up, down-arrow)
 		// This is not as trivial as it seems. For example, a left key-press doesn't always just take
@@ -294,7 +861,11 @@ private:
 		int cur_row, cur_col;
 		te_->getPos(cur_row, cur_col);
 		int dist_from_left = cur_col - left_;
-		if (dist_from_left < 0) {
+		if (wrap_) {
+			// The line wraps before the cursor can go off the right side of the window.
+			dist_from_left = cur_col % cols_;
+		}
+		else if (dist_from_left < 0) {
 			if (cur_col < cols_)
 				left_ = 0;
 			else
@@ -306,85 +877,11 @@ private:
 			dist_from_left = cur_col - left_;
 		}
 
-		// Obtain the relevant lines from the student's Text Editor class and display them
-		// on the screen, displaying blank lines as filler at the end of the current file.
-		std::vector<std::string> lines;
-		te_->getLines(top_, rows_, lines);
-		for (int i = 0; i < rows_; ++i) {
-			if (i < lines.size()) {
-				writeLine(i, lines[i]);
-			}
-			else {
-				clearLine(i);
-			}
-		}
 		// If instructed to do so, clear the status line at the bottom of the screen.
-		if (clear_status_line) clearLine(rows_);
-		// If the cursor is on a misspelled word, then display spelling suggestions (if there
-		// are any) at the bottom of the screen.
-		displaySpellingSuggestionsIfNecessary();
-
-		// Reposition the cursor on the line where the user was editing.
-		TextIO::move(dist_from_top, dist_from_left);
-	}
-
-	// Display correct spellings for the current word (that the cursor is on) if there are any
-	// spelling suggestions (and only if it's misspelled).
-	void displaySpellingSuggestionsIfNecessary() {
-		const std::string suggestions = getSuggestionString();
-		TextIO::move(rows_, 0);
-		TextIO::print(suggestions, TextIO::COLOR::RED);
-	}
-
-	// Compute a pattern of spaces and asterisks for the current line indicating where spelling
-	// mistakes were found. A space indicates a spot where a word is spelled properly, and an
-	// asterisk indicates that the letter is part of a word that's spelled improperly. e.g.:
-	// For this line:    "Thys is spelt wrong."
-	// Would yield this: "****    *****       " 
-	// This is used by the GUI to hilight misspellings in red.
-	// line: The input line from the text editor
-	// prob_str: The spaces and asterisks that show the locations of the spelling mistakes.
-	void produceBadPattern(const std::string& line, std::string& prob_str) {
-		if (line.empty()) return;
-		// Create a string of all spaces that is the same length of the input line. We start by
-		// assuming all words are spelled correctly.
-		prob_str = std::string(line.length(), kGoodChar);
-		if (loaded_dictionary_) {
-			std::vector<SpellCheck::Position> problems;
-			// Get a list of all problems on the specified line.
-			spell_check_->spellCheckLine(line, problems);
-			// Add asterisks to problem spots in the string.
-			for (const auto& p : problems) {
-				for (int i = p.start; i <= p.end; ++i)
-					prob_str[i] = kBadChar;
-			}
-		}
-	}
-
-	// Write a line to the console at the specified location, optionally hilighting
-	// misspelled words in red.
-	// row: What row of the screen to print the line on.
-	// line: The line to output
-	void writeLine(int row, const std::string& line) {
-		std::string prob_str;
-		produceBadPattern(line, prob_str);
-
-		TextIO::move(row, 0);
-		// Determine what to actually print out. Since lines can be very long, we need to compute
-		// what columns of the line is currently being displayed within the GUI.
-		std::string print_me;
-		if (line.length() >= left_) {
-			print_me = line.substr(left_, cols_);
-			prob_str = prob_str.substr(left_, cols_);
-		}
-		// Pad with spaces as necessary to overwrite other text from before.
-		if (cols_ > print_me.length()) {
-			print_me.insert(print_me.length(), cols_ - print_me.length(), ' ');
-			prob_str.insert(prob_str.length(), cols_ - prob_str.length(), ' ');
-		}
-		// Print the text in white/red to hilight errors.
-		for (int i = 0; i < print_me.length(); ++i)
-			TextIO::print(print_me[i], prob_str[i] == kBadChar ? TextIO::COLOR::RED : TextIO::COLOR::WHITE);
+		if (clear_status_line) status_.clear();
+		// Hand the window over to be drawn, with spelling suggestions on the status line if the cursor
+		// is on a misspelled word, and the cursor on the line where the user was editing.
+		publishFrame(show_suggestions, dist_from_top, dist_from_left);
 	}
 
 	// Display a prompt and get some input from the user (like a filename) on the status line.
@@ -392,33 +889,293 @@ private:
 	// input: The result that the user typed
 	// Returns true if the user typed something other than a blank line.
 	bool getInput(const std::string& prompt, std::string& input) {
-		writeStatus(prompt);
-		TextIO::move(rows_, static_cast<int>(prompt.length()));
-		TextIO::getString(input);
-		clearLine(rows_);
+		input.clear();
+		for (;;) {
+			// Echo what the user typed so far after the prompt.
+			writeStatus(prompt + input);
+			publishFrame(false, rows_, std::min(static_cast<int>(status_.length()), cols_ - 1));
+			const int ch = nextKey(-1);
+			if (ch == KEY_ENTER || ch == '\r') break;
+			if (ch == KEY_BACKSPACE || ch == '\b') {
+				if (!input.empty()) input.pop_back();
+			}
+			else if (ch >= ' ' && ch <= '~' && input.length() < kMaxInputLength)
+				input += static_cast<char>(ch);
+		}
+		status_.clear();
 
 		return !input.empty();
 	}
 
-	// Clears the specified row on the screen.
-	void clearLine(const int row) const {
-		TextIO::move(row, 0);
-		const std::string empty(cols_, ' ');
-		TextIO::print(empty);
+	// Find text as the user types it on the status line, moving the cursor to the nearest match at or
+	// after where it was and showing how many matches there are. Typing more of the query only checks
+	// the matches there already were, instead of searching the whole document again, unless it's
+	// finding whole words.
+	// While finding, Down (or Ctrl-F) and Up go to the next and previous match, Ctrl-A switches between
+	// matching case and ignoring it, and Ctrl-W between finding whole words and finding any text. Enter
+	// stays on the match and Escape goes back to where the cursor was. Ctrl-F right away finds the last
+	// query again.
+	void incrementalFind() {
+		int start_row, start_col;
+		te_->getPos(start_row, start_col);
+		TextEditor::Match from = { start_row, start_col };	// the nearest match is the first one at or after this
+		std::string query;
+		int options = find_options_;
+		std::vector<TextEditor::Match> matches;
+		TextSearch found("", options);	// what matches were found with
+		size_t current = 0;
+		for (;;) {
+			if (query != found.query() || options != found.options()) {
+				const TextSearch search(query, options);
+				if (search.refines(found))
+					te_->refineMatches(search, matches);
+				else if (!query.empty())
+					te_->findAll(search, matches);
+				else
+					matches.clear();
+				found = search;
+				const auto before = [](const TextEditor::Match& a, const TextEditor::Match& b) {
+					return a.row < b.row || (a.row == b.row && a.col < b.col);
+				};
+				current = std::lower_bound(matches.begin(), matches.end(), from, before) - matches.begin();
+				if (current == matches.size()) current = 0;	// wrap around to the top
+			}
+
+			std::string status = "Find: " + query;
+			if (!matches.empty()) {
+				te_->setPos(matches[current].row, matches[current].col);
+				from = matches[current];
+				status += "  [" + std::to_string(current + 1) + " of " + std::to_string(matches.size()) + "]";
+			}
+			else {
+				te_->setPos(start_row, start_col);
+				if (!query.empty()) status += "  [no matches]";
+			}
+			if (options & TextSearch::IGNORE_CASE) status += "  (any case)";
+			if (options & TextSearch::WHOLE_WORD) status += "  (whole words)";
+			writeStatus(status);
+			redisplayTheEditorWindowAndPositionCursor(false, false);
+
+			const int ch = nextKey(-1);
+			if (ch == KEY_ENTER || ch == '\r') break;
+			if (ch == kEscape) {
+				te_->setPos(start_row, start_col);
+				break;
+			}
+			if (ch == KEY_DOWN || ch == CTRL_F) {
+				if (query.empty())
+					query = last_find_query_;
+				else if (!matches.empty())
+					current = (current + 1) % matches.size();
+			}
+			else if (ch == KEY_UP) {
+				if (!matches.empty()) current = (current + matches.size() - 1) % matches.size();
+			}
+			else if (ch == CTRL_A)
+				options ^= TextSearch::IGNORE_CASE;
+			else if (ch == CTRL_W)
+				options ^= TextSearch::WHOLE_WORD;
+			else if (ch == KEY_BACKSPACE || ch == '\b') {
+				if (!query.empty()) query.pop_back();
+			}
+			else if (ch >= ' ' && ch <= '~' && query.length() < kMaxInputLength)
+				query += static_cast<char>(ch);
+		}
+		if (!query.empty()) last_find_query_ = query;
+		find_options_ = options;
+		status_.clear();
+	}
+
+	// Go to the next line the word under (or just before) the cursor is on, wrapping around to the top,
+	// and show how many times and on how many lines it appears. The first time builds the editor's word
+	// index, which it keeps up to date from then on, so after that this only costs as much as the lines
+	// the word is on.
+	void nextOccurrence() {
+		int cur_row, cur_col;
+		te_->getPos(cur_row, cur_col);
+		std::vector<std::string> lines;
+		te_->getLines(cur_row, 1, lines);
+		const std::string line = lines.empty() ? "" : lines[0];
+		int start = cur_col, end = cur_col;
+		while (start > 0 && SpellCheck::isWordChar(line[start - 1])) --start;
+		while (end < line.length() && SpellCheck::isWordChar(line[end])) ++end;
+		if (start == end) {
+			writeStatus("No word under the cursor.");
+			redisplayTheEditorWindowAndPositionCursor(false);
+			return;
+		}
+		const std::string word = line.substr(start, end - start);
+		te_->indexWords();
+		std::vector<int> rows;
+		const long count = te_->findWord(word, rows);
+		auto next = std::upper_bound(rows.begin(), rows.end(), cur_row);
+		if (next == rows.end()) next = rows.begin();	// wrap around to the top
+
+		// Put the cursor on the first whole-word copy of the word on that line, in any case.
+		const int row = *next;
+		te_->getLines(row, 1, lines);
+		const std::string& text = lines[0];
+		int col = 0;
+		for (int i = 0; i < text.length(); ) {
+			if (!SpellCheck::isWordChar(text[i])) { ++i; continue; }
+			int j = i;
+			while (j < text.length() && SpellCheck::isWordChar(text[j])) ++j;
+			if (j - i == word.length() && strncasecmp(text.c_str() + i, word.c_str(), word.length()) == 0) {
+				col = i;
+				break;
+			}
+			i = j;
+		}
+		te_->setPos(row, col);
+		writeStatus("\"" + word + "\" appears " + std::to_string(count) + (count == 1 ? " time" : " times") + " on " +
+			std::to_string(rows.size()) + (rows.size() == 1 ? " line" : " lines") +
+			" (line " + std::to_string(next - rows.begin() + 1) + " of " + std::to_string(rows.size()) + ")");
+		redisplayTheEditorWindowAndPositionCursor(false);
 	}
 
-	// Lets the user save the current edited text into the edited file or a new file if one has not yet been specified.
-	void save() {
-		// Get the current position of the user's cursor so we can restore it after saving the file.
+	// Ask for a regular expression and what to replace it with, then replace every match in the document
+	// at once; one undo puts them all back.
+	void findAndReplace() {
+		std::string pattern;
+		if (!getInput("Replace regex: ", pattern)) {
+			writeStatus("No regex entered.");
+			publishFrame(false);
+			return;
+		}
+		Regex regex;
+		std::string error;
+		if (!regex.compile(pattern, error)) {
+			writeStatus("Bad regex: " + error);
+			publishFrame(false);
+			return;
+		}
+		std::string replacement;
+		getInput("Replace " + pattern + " with ($0 is the match): ", replacement);	// replacing with nothing deletes the matches
+		finishLoading();	// every match in the file, not just the part loaded so far
+		const int replaced = te_->replaceAll(regex, replacement);
+		if (replaced > 0)
+			writeStatus("Replaced " + std::to_string(replaced) + (replaced == 1 ? " match." : " matches."));
+		else
+			writeStatus("No matches.");
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Mark the line the cursor is on, so Ctrl-U works on the lines from it to the cursor; pressing it on
+	// the marked line takes the mark away.
+	void toggleMark() {
+		takeDamage();	// so the mark is where the text put it
 		int cur_row, cur_col;
 		te_->getPos(cur_row, cur_col);
+		if (mark_ == cur_row) {
+			mark_ = -1;
+			writeStatus("Mark cleared.");
+		}
+		else {
+			mark_ = cur_row;
+			writeStatus("Marked line " + std::to_string(cur_row + 1) + ".");
+		}
+		publishFrame(false);
+	}
 
+	// Ask how to transform the lines from the mark to the cursor, or the whole document if nothing is
+	// marked, then transform them on as many threads as there are and put the result in place of them as
+	// one edit; one undo puts them all back.
+	void transformLines() {
+		std::string how;
+		getInput("Sort, unique, filter or reindent lines [s/u/f/r]: ", how);
+		const char kind = how.empty() ? '\0' : static_cast<char>(tolower(static_cast<unsigned char>(how[0])));
+		Regex regex;
+		bool keep_matches = true;
+		int width = 0;
+		if (kind == 'f') {
+			std::string pattern;
+			std::string error;
+			if (!getInput("Keep lines matching regex (! first to drop them): ", pattern) || pattern == "!") {
+				writeStatus("No regex entered.");
+				publishFrame(false);
+				return;
+			}
+			keep_matches = pattern[0] != '!';
+			if (!regex.compile(keep_matches ? pattern : pattern.substr(1), error)) {
+				writeStatus("Bad regex: " + error);
+				publishFrame(false);
+				return;
+			}
+		}
+		else if (kind == 'r') {
+			std::string input;
+			getInput("Indent width: ", input);
+			const bool number = !input.empty() && input.size() <= 2 && input.find_first_not_of("0123456789") == std::string::npos;
+			width = number ? std::stoi(input) : -1;
+			if (width < 0 || width > kMaxIndentWidth) {
+				writeStatus("Indent width must be 0 to " + std::to_string(kMaxIndentWidth) + ".");
+				publishFrame(false);
+				return;
+			}
+		}
+		else if (kind != 's' && kind != 'u') {
+			writeStatus("No transform chosen.");
+			publishFrame(false);
+			return;
+		}
+
+		int first = 0, count = INT_MAX;
+		takeDamage();	// so the mark is where the text put it
+		if (mark_ >= 0) {
+			int cur_row, cur_col;
+			te_->getPos(cur_row, cur_col);
+			first = std::min(mark_, cur_row);
+			count = std::abs(mark_ - cur_row) + 1;
+		}
+		else
+			finishLoading();	// the whole document, not just the part loaded so far
+		std::vector<std::string> lines;
+		te_->getLines(first, count, lines);
+		count = static_cast<int>(lines.size());
+		std::vector<size_t> order;
+		std::string done;
+		switch (kind) {
+		case 's':
+			sortLines(lines, &order);
+			done = "Sorted " + std::to_string(count) + (count == 1 ? " line." : " lines.");
+			break;
+		case 'u':
+			uniqueLines(lines);
+			done = "Removed " + std::to_string(count - lines.size()) + (count - lines.size() == 1 ? " duplicate line." : " duplicate lines.");
+			break;
+		case 'f':
+			filterLines(lines, regex, keep_matches);
+			done = "Kept " + std::to_string(lines.size()) + " of " + std::to_string(count) + (count == 1 ? " line." : " lines.");
+			break;
+		case 'r': {
+			const int level = reindentLines(lines, width);
+			if (level == 0) {
+				writeStatus("No indented lines.");
+				redisplayTheEditorWindowAndPositionCursor(false);
+				return;
+			}
+			done = "Reindented " + std::to_string(level) + "-column indents as " + std::to_string(width) + ".";
+			break;
+		}
+		}
+		te_->replaceLines(first, count, std::move(lines));
+		if (!order.empty())
+			takeDamage(false, &order);	// sorted lines only moved, so nothing about them needs counting
+		mark_ = -1;
+		writeStatus(done);
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Lets the user save the current edited text into the edited file or a new file if one has not yet been specified.
+	void save() {
+		finishLoading();	// save all of the file, not just the part loaded so far
+		finishSaving();
 		// The user has not yet specified a filename.
 		if (filename_.empty()) {
 			std::string filename;
 			const bool got_file = getInput("Enter path/file to save to: ", filename);
 			if (!got_file) {
-				TextIO::move(cur_row, cur_col);
+				publishFrame(false);
 				return;
 			}
 			filename_ = filename;
@@ -430,48 +1187,446 @@ private:
 			getInput(prompt, input);
 			if (!input.empty() && (input[0] != 'y' && input[0] != 'Y')) {
 				writeStatus("Not saving file.");
-				TextIO::move(cur_row, cur_col);
+				publishFrame(false);
 				return;
 			}
 		}
 
-		// Save the current text to the specified file.
-		const bool saved = te_->save(filename_);
+		// Save a snapshot of the text to the specified file on the saver thread, so editing can go on
+		// while it's written. Other programs' changes to the file aren't looked for until it's done.
+		saver_->start(te_->snapshot(), filename_);
+		takeDamage(true);
+		disk_synced_ = true;
+		watcher_->stop();
+		writeStatus("");
+		showLoadStatus("Saving " + filename_ + "...");
+
+		// Place the cursor back on the proper row where the user was editing.
+		publishFrame(false);
+	}
+
+	// If the file being saved in the background has been written, say how it went and start watching it
+	// again. Edits made while it was written mean the text no longer matches it.
+	void checkFileSaved() {
+		if (!saver_->saving() || !saver_->done()) return;
+		const bool saved = saver_->finish();
+		takeDamage();
+		if (!saved) disk_synced_ = false;
+		if (!watcher_->start(filename_)) disk_synced_ = false;
 		if (saved)
-			writeStatus("Saved file successfully!");
+			showLoadStatus("Saved file successfully!");
 		else
 			writeStatus("Unable to save file.");
-
-		// Place the cursor back on the proper row where the user was editing.
-		TextIO::move(cur_row, cur_col);
+		redisplayTheEditorWindowAndPositionCursor(false);
 	}
 
 	// Check to see if the user really wants to exit the editor.
 	// Returns true if the user wants to exit, false otherwise.
 	bool quit() {
-		int cur_row, cur_col;
-		te_->getPos(cur_row, cur_col);
 		std::string input;
 		const bool got_input = getInput("Quit [y/N]: ", input);
 		if (got_input && (input[0] == 'y' || input[0] == 'Y')) return true;
-		TextIO::move(cur_row, cur_col);
+		publishFrame(false);
 		return false;
 	}
 
+	// If a dictionary that was loading in the background has finished, redisplay the window so the
+	// highlighting uses it, and tell the user how the load went.
+	void checkDictionaryLoaded() {
+		if (!loading_dictionary_ || spell_check_->isLoading())
+			return;
+		loading_dictionary_ = false;
+		const int generation = spell_check_->generation();
+		if (generation != dictionary_generation_) {
+			dictionary_generation_ = generation;
+			loaded_dictionary_ = true;
+			uncheckAllBuffers();
+			writeStatus("Loaded dictionary successfully!");
+		}
+		else
+			writeStatus("Unable to load dictionary.");
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Add the lines the loader thread has read since the last check to the document, a few pieces at a
+	// time so keys still get handled quickly, and show how far along it is on the status line.
+	void checkFileLoaded() {
+		if (!loader_->loading()) return;
+		FileLoader::Piece piece;
+		int percent = -1;
+		takeDamage();	// edits made while it loads
+		for (int i = 0; i < kLoadPiecesPerCheck && loader_->take(piece); ++i) {
+			te_->appendLines(piece.lines);
+			percent = loader_->percent(piece);
+		}
+		takeDamage(true);
+		if (loader_->finished()) {
+			loader_->stop();
+			watchFile();
+			showLoadStatus("Loaded file successfully!");
+		}
+		else if (percent >= 0)
+			showLoadStatus("Loading " + filename_ + "... " + std::to_string(percent) + "%");
+		else
+			return;
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Show how loading is going, unless the status line has been taken over by something else since.
+	void showLoadStatus(const std::string& status) {
+		if (status_.empty() || status_ == load_status_) writeStatus(status);
+		load_status_ = status.substr(0, cols_);
+	}
+
+	// Start watching the file being edited for changes other programs make to it, now that it has been
+	// read or written. Changes to the text made since then go first.
+	void watchFile() {
+		takeDamage(true);
+		if (!watcher_->start(filename_)) disk_synced_ = false;
+	}
+
+	// If another program changed the file being edited, bring the change in, unless the text has edits
+	// that haven't been saved: then the status line says so and Ctrl-Y reloads it when the user wants.
+	// If the file only grew (like a log), just the new lines are read and added to the end. Otherwise
+	// reloadFromDisk() brings in the runs of lines that differ.
+	void checkFileChanged() {
+		if (loader_->loading() || saver_->saving() || !watcher_->changed()) return;
+		takeDamage();	// edits made since the last check
+		if (!disk_synced_) {
+			writeStatus(filename_ + " changed on disk. Ctrl-Y reloads it, Ctrl-S keeps your version.");
+			publishFrame(false);
+			return;
+		}
+		std::vector<std::string> lines;
+		if (watcher_->readAppended(lines)) {
+			te_->appendLines(lines);
+			takeDamage(true);
+			showLoadStatus(filename_ + " grew by " + std::to_string(lines.size()) + (lines.size() == 1 ? " line." : " lines."));
+			redisplayTheEditorWindowAndPositionCursor(false);
+			return;
+		}
+		const int changes = reloadFromDisk();
+		if (changes <= 0) return;
+		showLoadStatus(reloadedStatus(changes));
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Reload the file being edited after the user saw it changed on disk, replacing the edits made to
+	// the text since it was last saved; Ctrl-Z brings them back.
+	void reloadFile() {
+		finishLoading();
+		finishSaving();
+		takeDamage();
+		const int changes = watcher_->watching() ? reloadFromDisk() : -1;
+		if (changes < 0)
+			writeStatus("Unable to reload file.");
+		else
+			writeStatus(reloadedStatus(changes));
+		redisplayTheEditorWindowAndPositionCursor(false);
+	}
+
+	// Read the whole file and diff it against the text, then replace only the runs of lines that differ,
+	// all as one undo step, so the cursor stays on the text it was on and one Ctrl-Z takes it all back.
+	// Returns how many runs of lines were replaced, or -1 if the file can't be read.
+	int reloadFromDisk() {
+		std::vector<std::string> lines;
+		if (!watcher_->readFile(lines)) return -1;
+		if (lines.empty()) lines.push_back("");	// the text always has a line
+		std::vector<std::string> text;
+		te_->getLines(0, INT_MAX, text);
+		std::vector<DiffHunk> hunks;
+		diffLines(text, lines, hunks);
+		// Bottom up, so the rows of the hunks still to go stay where the diff found them.
+		te_->beginGroup();
+		for (size_t i = hunks.size(); i-- > 0; ) {
+			const DiffHunk& hunk = hunks[i];
+			te_->replaceLines(hunk.oldStart, hunk.oldCount,
+				std::vector<std::string>(lines.begin() + hunk.newStart, lines.begin() + hunk.newStart + hunk.newCount));
+			if (wrap_) continue;	// top_ is a screen row, the redisplay keeps the cursor in the window
+			if (hunk.oldStart + hunk.oldCount <= top_) top_ += hunk.newCount - hunk.oldCount;
+			else if (hunk.oldStart < top_) top_ = hunk.oldStart;
+		}
+		te_->endGroup();
+		takeDamage(true);
+		disk_synced_ = true;
+		return static_cast<int>(hunks.size());
+	}
+
+	std::string reloadedStatus(int changes) const {
+		return "Reloaded " + filename_ + ": " + std::to_string(changes) + (changes == 1 ? " change." : " changes.");
+	}
+
+	// With compression on, pack the lines that aren't within a couple of windows of the cursor, which
+	// includes everything the window shows.
+	void compressColdLines() {
+		if (!compress_lines_) return;
+		int cur_row, cur_col;
+		te_->getPos(cur_row, cur_col);
+		te_->compressLines(cur_row - kHotWindows * rows_, cur_row + kHotWindows * rows_);
+	}
+
+	// Have the lines whose misspellings the statistics don't know yet, e.g., lines read from a file or
+	// every line after a new dictionary, counted on the counter thread, and add the counts it has got to
+	// since the last check, a few pieces at a time so keys still get handled quickly. When it's done,
+	// the lines changed while it counted are counted by the next one.
+	void countMisspellings() {
+		if (!loaded_dictionary_) return;
+		takeDamage();
+		if (!counter_.counting()) {
+			const int first = stats_.firstUnchecked();
+			if (first < 0) return;
+			count_changes_.clear();
+			counter_.start(te_->snapshot(), first, spell_check_);
+			return;
+		}
+		MisspellingCounter::Piece piece;
+		int taken = 0;
+		for (; taken < kCountPiecesPerCheck && counter_.take(piece); ++taken)
+			addCounts(piece);
+		if (counter_.finished()) counter_.stop();
+		if (taken > 0) publishFrame(false);
+	}
+
+	// Record the counts of a piece in the statistics. The piece's rows are rows of the text as it was when
+	// the counter started, so each change since then moves the rows after it, and drops the rows it
+	// replaced, whose counts are out of date.
+	void addCounts(const MisspellingCounter::Piece& piece) {
+		struct Run {
+			int row;	// where it is in the text now
+			int from, count;	// which of the piece's counts it has
+		};
+		std::vector<Run> runs(1, Run{ piece.first, 0, static_cast<int>(piece.counts.size()) });
+		for (const Change& change : count_changes_) {
+			std::vector<Run> moved;
+			for (const Run& run : runs) {
+				const int end = run.row + run.count;
+				if (change.first >= end) {
+					moved.push_back(run);
+					continue;
+				}
+				if (run.row < change.first)	// the part before the change
+					moved.push_back(Run{ run.row, run.from, change.first - run.row });
+				const int after = std::max(run.row, change.first + change.old_count);
+				if (after < end)	// the part after it
+					moved.push_back(Run{ after + change.new_count - change.old_count, run.from + after - run.row, end - after });
+			}
+			runs.swap(moved);
+		}
+		for (const Run& run : runs)
+			stats_.setMisspellings(run.row, piece.counts.data() + run.from, run.count);
+	}
+
+	// Forget the counts the counter thread is working on, e.g., because they're for another dictionary
+	// or another buffer.
+	void stopCounting() {
+		counter_.stop();
+		count_changes_.clear();
+	}
+
+	// Count the misspelled words of line row, which has text line.
+	void checkLine(int row, const std::string& line) {
+		std::vector<SpellCheck::Position> problems;
+		spell_check_->spellCheckLine(line, problems);
+		stats_.setMisspellings(row, static_cast<int>(problems.size()));
+	}
+
+	// Every open file's misspellings need counting again with a new dictionary.
+	void uncheckAllBuffers() {
+		stopCounting();
+		stats_.uncheckAll();
+		for (const auto& buffer : buffers_)
+			buffer->stats.uncheckAll();
+	}
+
+	// The status line with the document's statistics on the right of it, if there's room for them. The
+	// misspelled count has a + while there are lines it hasn't got to yet.
+	std::string statusWithStats() const {
+		const DocStats::Totals totals = stats_.totals();
+		std::string stats = std::to_string(totals.lines) + (totals.lines == 1 ? " line " : " lines ") +
+			std::to_string(totals.words) + (totals.words == 1 ? " word " : " words ") +
+			std::to_string(totals.characters) + (totals.characters == 1 ? " char" : " chars");
+		if (loaded_dictionary_)
+			stats += " " + std::to_string(totals.misspellings) + (totals.unchecked > 0 ? "+" : "") + " misspelled";
+		const int room = cols_ - static_cast<int>(status_.length() + stats.length());
+		if (room < 2) return status_;
+		return status_ + std::string(room, ' ') + stats;
+	}
+
+	// Open a file in a new buffer and show it, keeping the buffers already open as they are. All of them
+	// share the dictionary, and each has its own text, undo history and spelling caches.
+	void openBuffer() {
+		std::string filename;
+		if (!getInput("Enter path/file to open: ", filename)) {
+			redisplayTheEditorWindowAndPositionCursor(false);
+			return;
+		}
+		std::unique_ptr<Buffer> buffer(new Buffer);
+		buffer->undo = createUndo();
+		buffer->te = createTextEditor(buffer->undo);
+		buffer->spell_check = spell_check_->shareDictionary();
+		buffer->loader.reset(new FileLoader);
+		buffer->watcher.reset(new FileWatcher);
+		buffer->saver.reset(new FileSaver);
+		buffer->stats.reset(std::vector<std::string>(1));
+		buffers_.push_back(std::move(buffer));
+		switchBuffer(static_cast<int>(buffers_.size()) - 1);
+		loadFileToEdit(filename, true);
+	}
+
+	// Show the buffer after the one on screen, listing them all on the status line.
+	void nextBuffer() {
+		switchBuffer((buffer_ + 1) % static_cast<int>(buffers_.size()));
+		std::string list;
+		for (int i = 0; i < static_cast<int>(buffers_.size()); ++i) {
+			const std::string& name = i == buffer_ ? filename_ : buffers_[i]->filename;
+			list += (i == buffer_ ? " [" : "  ") + std::to_string(i + 1) + " " + (name.empty() ? "(new)" : name) + (i == buffer_ ? "]" : "");
+		}
+		writeStatus("Buffers:" + list);
+		redisplayTheEditorWindowAndPositionCursor(false, false);
+	}
+
+	// Park the buffer on screen and bring up buffer index in its place, in O(1): the two trade places
+	// with the editor's members, and the next frame fetches every row. A parked buffer's loading and
+	// watching wait until it's back on screen.
+	void switchBuffer(int index) {
+		if (index == buffer_) return;
+		takeDamage();	// so the parked layout and disk_synced_ are up to date
+		stopCounting();	// the buffer coming up counts its own lines
+		swapBuffer(*buffers_[buffer_]);
+		buffer_ = index;
+		swapBuffer(*buffers_[buffer_]);
+		last_frame_.reset();
+		last_rows_.clear();
+		damaged_ = false;
+		completing_ = false;
+		load_status_.clear();
+	}
+
+	// Trade everything about the buffer on screen for what buffer holds.
+	void swapBuffer(Buffer& buffer) {
+		std::swap(filename_, buffer.filename);
+		std::swap(te_, buffer.te);
+		std::swap(undo_, buffer.undo);
+		std::swap(spell_check_, buffer.spell_check);
+		std::swap(loader_, buffer.loader);
+		std::swap(watcher_, buffer.watcher);
+		std::swap(saver_, buffer.saver);
+		std::swap(disk_synced_, buffer.disk_synced);
+		std::swap(top_, buffer.top);
+		std::swap(left_, buffer.left);
+		std::swap(mark_, buffer.mark);
+		std::swap(wrap_, buffer.wrap);
+		layout_.swap(buffer.layout);
+		stats_.swap(buffer.stats);
+	}
+
+	// Wait for the rest of the file that's loading in the background, if any.
+	void finishLoading() {
+		while (loader_->loading()) {
+			if (!loader_->ready()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			checkFileLoaded();
+		}
+	}
+
+	// Wait for the file that's being saved in the background, if any.
+	void finishSaving() {
+		while (saver_->saving()) {
+			if (!saver_->done()) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			checkFileSaved();
+		}
+	}
+
+	// The first press starts tracing where the time goes; the ones after that write the newest events
+	// to the trace file, WURD_TRACE if that's set. Tracing stays on until the editor exits.
+	void traceOrDumpTrace() {
+		if (!Trace::enabled()) {
+			Trace::enable(true);
+			writeStatus("Tracing. Press Ctrl-G again to write the trace.");
+		}
+		else {
+			const std::string file = Trace::outputFile().empty() ? kTraceFile : Trace::outputFile();
+			writeStatus(Trace::dump(file) ? "Wrote trace to " + file : "Unable to write trace.");
+		}
+		publishFrame(false);
+	}
+
+	// Show the memory each part of the editor takes up on the status line.
+	void showMemoryUsage() {
+		MemoryReport report;
+		reportMemory(report);
+		writeStatus(report.summary());
+		publishFrame(false);
+	}
+
 	// Places the user cursor at the top of the file.
 	void resetCursorToTopOfFile() {
 		top_ = left_ = 0;
 	}
 
 	// Private variables and constants.
-	static const char kGoodChar = ' ', kBadChar = '*';
+	static const int kDictionaryPollMillis = 100;
+	static const int kLoadPollMillis = 10;	// how often to add what the loader thread has read
+	static const int kLoadPiecesPerCheck = 4;	// at most this many pieces are added between keys
+	static const int kWatchPollMillis = 250;	// how often to see if the file changed on disk
+	static const int kCountPiecesPerCheck = 4;	// at most this many pieces of misspelling counts are added between keys
+	static const int kCheckLinesRightAway = 64;	// changes of up to this many lines are spell checked as they're taken
+	static const int kHotWindows = 2;	// with compression on, windows' worth of lines kept unpacked on each side of the cursor
+	static const int kNumCompletions = 8;
+	static const int kMaxIndentWidth = 16;	// spaces per level a reindent can ask for
+	static constexpr int kFrameMillis = 16;	// how long to keep gathering waiting keys before redrawing
+	static constexpr int kSequenceMillis = 50;	// how long to wait for the rest of an escape sequence
+	static constexpr int kPasteMillis = 500;	// how long to wait for more of a paste
+	static constexpr int kEscape = 27;
+	static const int kMaxInputLength = 1024;
+	static constexpr const char* kTraceFile = "wurd-trace.json";
+	std::vector<std::unique_ptr<Buffer>> buffers_;	// every open file, in the order they were opened
+	int buffer_;	// which of buffers_ is on screen
+
 	std::string filename_;
 	TextEditor* te_;
 	Undo* undo_;
 	SpellCheck* spell_check_;
 	bool loaded_dictionary_;
-	int top_, left_;
+	bool loading_dictionary_;
+	int dictionary_generation_;
+	std::unique_ptr<FileLoader> loader_;	// reads the file being loaded in the background
+	std::string load_status_;	// how loading was going, last time it was shown
+	std::unique_ptr<FileWatcher> watcher_;	// notices when other programs change the file being edited
+	std::unique_ptr<FileSaver> saver_;	// writes the file being saved in the background
+	bool disk_synced_;	// true if the text hasn't been edited since it last matched the file on disk
+	bool compress_lines_;	// true to keep the lines far from the cursor compressed
+	std::vector<std::string> completions_;	// completions of the word in front of the cursor
+	bool completing_;	// true if the last key completed a word, so another press moves to the next completion
+	int completion_index_;	// which of completions_ is in the document
+	int completion_prefix_length_;	// how much of the word the user typed
+	int top_, left_;	// with wrap on, top_ is a screen row counted from the top of the document
+	int mark_;	// the line Ctrl-K marked, -1 if none
+	bool wrap_;	// true if long lines wrap onto the rows below them
+	std::string last_find_query_;	// what the user last looked for
+	int find_options_;	// TextSearch::Options the user last looked with
+	WrapLayout layout_;	// where each line goes on the screen while wrap_ is on
+	DocStats stats_;	// the lines, words, characters and misspellings of the text, for the status line
+	MisspellingCounter counter_;	// counts the misspellings stats_ doesn't know yet, on a thread of its own
+	std::vector<Change> count_changes_;	// the changes to the text since counter_ started, in order
+	// The lines changed since the last frame, as one span: rows [damage_first_, damage_old_end_) of the
+	// text the last frame showed are rows [damage_first_, damage_new_end_) now
+	bool damaged_;
+	int damage_first_, damage_old_end_, damage_new_end_;
+	std::string status_;	// the status line
+	bool needs_redisplay_;	// true if keys processed since the last redisplay changed what the window shows
 	int rows_, cols_;
+
+	InputReader input_;	// reads keys on the input thread
+	std::unique_ptr<FrameRenderer> renderer_;	// draws frames, only ever used by one thread at a time
+	std::shared_ptr<const Frame> last_frame_;	// the last frame built, for sharing unchanged lines
+	std::vector<int> last_rows_;	// the line each row of last_frame_ shows, INT_MAX past the end of the file
+	std::thread render_thread_;
+	std::mutex frame_mutex_;	// guards the hand-off of frames to the render thread
+	std::condition_variable frame_ready_;
+	std::shared_ptr<const Frame> latest_frame_;	// the newest frame for the render thread to draw
+	int frame_version_;	// counts published frames so the render thread can tell when there's a new one
+	bool stop_rendering_;
+	StageTimes* stage_times_;	// where step() adds up the time spent on frames, null outside step()
 };
 
 #endif // #ifndef _EDITORGUI_H_
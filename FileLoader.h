@@ -0,0 +1,130 @@
+#ifndef FILELOADER_H_
+#define FILELOADER_H_
+
+// Reads a text file on a thread of its own and hands its lines to the editor a piece at a time through
+// a lock-free queue, so the top of a huge file can be shown and edited while the rest is still being read.
+// The first piece is only as many lines as it takes to fill the window; the ones after it are bigger.
+
+#include "SpscQueue.h"
+#include "Trace.h"
+#include <fstream>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+
+class FileLoader {
+public:
+	// A run of lines, and how much of the file has been read up to the end of them.
+	struct Piece {
+		std::vector<std::string> lines;
+		size_t bytes_read;
+	};
+
+	FileLoader() : pieces_(kQueueSize), file_bytes_(0), stop_(false), done_(false) { }
+
+	~FileLoader() {
+		stop();
+	}
+
+	// Start reading file on the loader thread, stopping any read that's still going on.
+	// first_lines: How many lines to put in the first piece.
+	// Returns false if the file can't be opened.
+	bool start(const std::string& file, int first_lines) {
+		stop();
+		in_.close();
+		in_.clear();
+		in_.open(file, std::ios::binary | std::ios::ate);	// opened at the end to find out how big it is
+		if (!in_) return false;
+		file_bytes_ = static_cast<size_t>(in_.tellg());
+		in_.seekg(0);
+		std::shared_ptr<Piece> piece;
+		while (pieces_.pop(piece)) { }	// what's left of the last file
+		stop_ = false;
+		done_ = false;
+		thread_ = std::thread(&FileLoader::readFile, this, first_lines);
+		return true;
+	}
+
+	// Stop reading and wait for the loader thread to finish. Pieces that were read are left to take.
+	void stop() {
+		if (!thread_.joinable()) return;
+		stop_ = true;
+		thread_.join();
+	}
+
+	// True from start() until stop().
+	bool loading() const {
+		return thread_.joinable();
+	}
+
+	// True if there's a piece waiting to be taken.
+	bool ready() const {
+		return !pieces_.empty();
+	}
+
+	// True once the whole file has been read and every piece has been taken.
+	bool finished() const {
+		return done_ && pieces_.empty();
+	}
+
+	// Take the next piece that has been read, if there is one. Only one thread may take pieces.
+	bool take(Piece& piece) {
+		std::shared_ptr<Piece> next;
+		if (!pieces_.pop(next)) return false;
+		piece = std::move(*next);
+		return true;
+	}
+
+	// How much of the file the pieces taken up to piece cover, from 0 to 100.
+	int percent(const Piece& piece) const {
+		return file_bytes_ > 0 ? static_cast<int>(piece.bytes_read * 100 / file_bytes_) : 100;
+	}
+
+private:
+	// The loader thread: read lines (stripping the '\r' of "\r\n" the way the editor's load() does) and
+	// queue them up a piece at a time.
+	void readFile(int first_lines) {
+		Trace::nameThread("loader");
+		TRACE_SCOPE("readFile");
+		auto piece = std::make_shared<Piece>();
+		size_t limit = first_lines > 0 ? first_lines : 1;
+		size_t bytes_read = 0;
+		std::string line;
+		while (!stop_ && std::getline(in_, line)) {
+			bytes_read += line.size() + 1;
+			if (!line.empty() && line.back() == '\r') line.pop_back();
+			piece->lines.push_back(std::move(line));
+			if (piece->lines.size() >= limit) {
+				piece->bytes_read = bytes_read;
+				if (!push(piece)) return;
+				piece = std::make_shared<Piece>();
+				limit = kPieceLines;
+			}
+		}
+		piece->bytes_read = file_bytes_;
+		if (push(piece)) done_ = true;	// the last piece, even if it's empty
+	}
+
+	// Queue a piece up, waiting while the editor is behind. Returns false if told to stop first.
+	bool push(const std::shared_ptr<Piece>& piece) {
+		while (!pieces_.push(piece)) {
+			if (stop_) return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	static const int kQueueSize = 16;
+	static const int kPieceLines = 8192;
+	SpscQueue<std::shared_ptr<Piece>> pieces_;
+	std::ifstream in_;
+	size_t file_bytes_;
+	std::atomic<bool> stop_;
+	std::atomic<bool> done_;
+	std::thread thread_;
+};
+
+#endif // FILELOADER_H_
@@ -0,0 +1,62 @@
+#ifndef FILESAVER_H_
+#define FILESAVER_H_
+
+// Writes a snapshot of the text to a file on a thread of its own, so the user can go on editing while a
+// big file is written out. The snapshot never changes, so the two threads share nothing but a flag.
+
+#include "LineStore.h"
+#include "Trace.h"
+#include <fstream>
+#include <string>
+#include <thread>
+#include <atomic>
+
+class FileSaver {
+public:
+	FileSaver() : done_(false), saved_(false) { }
+
+	~FileSaver() {
+		finish();
+	}
+
+	// Start writing text to file, after any save that's still going on.
+	void start(const LineStore::Snapshot& text, const std::string& file) {
+		finish();
+		done_ = false;
+		thread_ = std::thread(&FileSaver::writeFile, this, text, file);
+	}
+
+	// True from start() until finish().
+	bool saving() const {
+		return thread_.joinable();
+	}
+
+	// True once the file has been written (or writing it failed).
+	bool done() const {
+		return done_;
+	}
+
+	// Wait for the saver thread to finish. Returns true if the last save wrote the whole file.
+	bool finish() {
+		if (thread_.joinable()) thread_.join();
+		return saved_;
+	}
+
+private:
+	// The saver thread: one line of text per line of the file, like the editor's save() writes them.
+	void writeFile(LineStore::Snapshot text, std::string file) {
+		Trace::nameThread("saver");
+		TRACE_SCOPE("writeFile");
+		std::ofstream out(file);
+		for (const std::string& line : text) out << line << '\n';
+		out.flush();
+		saved_ = static_cast<bool>(out);
+		done_ = true;
+	}
+
+	std::thread thread_;
+	std::atomic<bool> done_;
+	bool saved_;	// only read after joining the thread that writes it
+};
+
+#endif // FILESAVER_H_
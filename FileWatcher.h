@@ -0,0 +1,165 @@
+#ifndef FILEWATCHER_H_
+#define FILEWATCHER_H_
+
+// Notices when another program changes the file being edited, so the editor can bring the change in.
+// The directory the file is in is watched with inotify rather than the file itself, so a program that
+// saves by writing a new file and renaming it over the old one is noticed too. Nothing blocks on the
+// notifications: the editor checks for them between keys.
+// It also remembers how big the file was when the editor last read or wrote it and the bytes it ended
+// with, so when the file has only grown (like a log) just the new bytes are read.
+
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+class FileWatcher {
+public:
+	FileWatcher() : fd_(-1), size_(0), inode_(0), device_(0), mtime_{0, 0}, ends_with_newline_(true) { }
+
+	~FileWatcher() {
+		stop();
+	}
+
+	// Start watching file, which the editor's text now matches, in place of any file watched before.
+	// Returns false if it can't be watched.
+	bool start(const std::string& file) {
+		stop();
+		const size_t slash = file.find_last_of('/');
+		const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : file.substr(0, slash);
+		fd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+		if (fd_ < 0) return false;
+		if (inotify_add_watch(fd_, dir.c_str(), IN_MODIFY | IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE) < 0) {
+			stop();
+			return false;
+		}
+		file_ = file;
+		name_ = slash == std::string::npos ? file : file.substr(slash + 1);
+		sync();
+		return true;
+	}
+
+	void stop() {
+		if (fd_ >= 0) close(fd_);
+		fd_ = -1;
+	}
+
+	bool watching() const {
+		return fd_ >= 0;
+	}
+
+	// Remember the file as it is now as what the editor's text matches, e.g. after saving it.
+	void sync() {
+		struct stat st;
+		std::string tail;
+		if (stat(file_.c_str(), &st) != 0) {
+			size_ = 0;
+			inode_ = 0;
+			tail_.clear();
+			ends_with_newline_ = true;
+			return;
+		}
+		const off_t start = st.st_size - std::min<off_t>(st.st_size, kTailBytes);
+		if (!readBytes(start, st.st_size - start, tail)) tail.clear();
+		remember(st, st.st_size, tail);
+	}
+
+	// True if the file changed since the editor last read or wrote it. Doesn't wait.
+	bool changed() {
+		if (fd_ < 0) return false;
+		bool touched = false;
+		alignas(inotify_event) char events[4096];
+		for (;;) {
+			const ssize_t bytes = read(fd_, events, sizeof(events));
+			if (bytes <= 0) break;
+			for (const char* next = events; next < events + bytes; ) {
+				const inotify_event* event = reinterpret_cast<const inotify_event*>(next);
+				if (event->len > 0 && name_ == event->name) touched = true;
+				next += sizeof(inotify_event) + event->len;
+			}
+		}
+		if (!touched) return false;
+		struct stat st;
+		if (stat(file_.c_str(), &st) != 0) return false;	// gone, maybe about to be replaced
+		return st.st_ino != inode_ || st.st_dev != device_ || st.st_size != size_ ||
+			st.st_mtim.tv_sec != mtime_.tv_sec || st.st_mtim.tv_nsec != mtime_.tv_nsec;
+	}
+
+	// If all the file did since the editor last read or wrote it was grow, puts the lines added to the end
+	// onto lines and returns true, after reading only the new bytes (and the few before them, to check
+	// that the end of what was there is still the same). Returns false if anything else happened.
+	bool readAppended(std::vector<std::string>& lines) {
+		lines.clear();
+		struct stat st;
+		if (!ends_with_newline_ || stat(file_.c_str(), &st) != 0) return false;
+		if (st.st_ino != inode_ || st.st_dev != device_ || st.st_size <= size_) return false;
+		const off_t start = size_ - static_cast<off_t>(tail_.size());
+		std::string bytes;
+		if (!readBytes(start, st.st_size - start, bytes) || bytes.compare(0, tail_.size(), tail_) != 0)
+			return false;
+		splitLines(bytes, tail_.size(), lines);
+		const size_t keep = std::min<size_t>(bytes.size(), kTailBytes);
+		remember(st, st.st_size, bytes.substr(bytes.size() - keep));
+		return true;
+	}
+
+	// Read the whole file into lines, stripping the '\r' of "\r\n" the way the editor's load() does, and
+	// remember it as what the editor's text matches. Returns false if it can't be read.
+	bool readFile(std::vector<std::string>& lines) {
+		lines.clear();
+		struct stat st;
+		std::string bytes;
+		if (stat(file_.c_str(), &st) != 0 || !readBytes(0, st.st_size, bytes)) return false;
+		splitLines(bytes, 0, lines);
+		const size_t keep = std::min<size_t>(bytes.size(), kTailBytes);
+		remember(st, bytes.size(), bytes.substr(bytes.size() - keep));
+		return true;
+	}
+
+private:
+	bool readBytes(off_t start, off_t count, std::string& bytes) const {
+		std::ifstream in(file_, std::ios::binary);
+		if (!in || !in.seekg(start)) return false;
+		bytes.resize(count);
+		in.read(&bytes[0], count);
+		return in.gcount() == count;
+	}
+
+	// Split bytes from start on into lines, with or without a '\n' at the end.
+	static void splitLines(const std::string& bytes, size_t start, std::vector<std::string>& lines) {
+		while (start < bytes.size()) {
+			size_t end = bytes.find('\n', start);
+			if (end == std::string::npos) end = bytes.size();
+			size_t length = end - start;
+			if (length > 0 && bytes[end - 1] == '\r') --length;
+			lines.emplace_back(bytes, start, length);
+			start = end + 1;
+		}
+	}
+
+	void remember(const struct stat& st, off_t size, const std::string& tail) {
+		size_ = size;
+		inode_ = st.st_ino;
+		device_ = st.st_dev;
+		mtime_ = st.st_mtim;
+		tail_ = tail;
+		ends_with_newline_ = tail_.empty() || tail_.back() == '\n';
+	}
+
+	static const int kTailBytes = 4096;	// how much of the end of the file is kept to check it's still there
+	int fd_;
+	std::string file_;
+	std::string name_;	// the file's name in its directory, which is what the events are about
+	// The file as the editor last read or wrote it.
+	off_t size_;
+	ino_t inode_;
+	dev_t device_;
+	struct timespec mtime_;
+	std::string tail_;	// the last kTailBytes bytes
+	bool ends_with_newline_;
+};
+
+#endif // FILEWATCHER_H_
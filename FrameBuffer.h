@@ -0,0 +1,147 @@
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+// A screen that only exists in memory, for running the editor without a terminal: install it with
+// TextIO's backend constructor, queue up keys with type(), and look at what ended up on the screen.
+// Output is laid out the way curses would lay it out, so the editor draws exactly what it would draw
+// on a terminal. It's meant to be driven from one thread.
+
+#include "TextIO.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <algorithm>
+
+class FrameBuffer : public TextIO::Backend {
+public:
+	FrameBuffer(int rows, int cols)
+		: rows_(rows), cols_(cols), cells_(rows * cols, kBlank), row_(0), col_(0), refreshes_(0) { }
+
+	// Queue up keys for getChar(), as curses would report them.
+	void type(int key) {
+		keys_.push_back(key);
+	}
+	void type(const std::string& text) {
+		for (const char ch : text)
+			keys_.push_back(static_cast<unsigned char>(ch));
+	}
+
+	// What's on a row of the screen.
+	std::string row(int r) const {
+		std::string text(cols_, ' ');
+		for (int c = 0; c < cols_; ++c)
+			text[c] = TextIO::cellChar(cells_[r * cols_ + c]);
+		return text;
+	}
+
+	TextIO::COLOR color(int r, int c) const {
+		return TextIO::cellColor(cells_[r * cols_ + c]);
+	}
+
+	int rows() const { return rows_; }
+	int cols() const { return cols_; }
+	int cursorRow() const { return row_; }
+	int cursorCol() const { return col_; }
+	int refreshes() const { return refreshes_; }
+	size_t keysLeft() const { return keys_.size(); }
+
+	void clear() override {
+		cells_.assign(cells_.size(), kBlank);
+		row_ = col_ = 0;
+	}
+
+	void move(int row, int col) override {
+		if (row < 0 || row >= rows_ || col < 0 || col >= cols_) return;	// curses refuses too
+		row_ = row;
+		col_ = col;
+	}
+
+	void print(const char* s, int n, TextIO::COLOR fcolor) override {
+		for (int i = 0; n < 0 ? s[i] != '\0' : i < n; ++i)
+			put(s[i], fcolor);
+	}
+
+	void print(const TextIO::Cell* cells, int n) override {
+		for (int i = 0; i < n && col_ + i < cols_; ++i)
+			cells_[row_ * cols_ + col_ + i] = cells[i];
+	}
+
+	void scrollRows(int top, int bottom, int n) override {
+		const int height = bottom - top + 1;
+		std::vector<TextIO::Cell> region(height * cols_, kBlank);
+		for (int r = top; r <= bottom; ++r) {
+			const int from = r + n;
+			if (from >= top && from <= bottom)
+				std::copy(cells_.begin() + from * cols_, cells_.begin() + (from + 1) * cols_, region.begin() + (r - top) * cols_);
+		}
+		std::copy(region.begin(), region.end(), cells_.begin() + top * cols_);
+	}
+
+	void refresh() override {
+		++refreshes_;
+	}
+
+	int getKey() override {
+		if (keys_.empty()) return ERR;
+		const int key = keys_.front();
+		keys_.pop_front();
+		return key;
+	}
+
+	void setInputTimeout(int milliseconds) override { }
+
+	bool waitForInput(int milliseconds) override {
+		return !keys_.empty();
+	}
+
+	void getString(std::string& str) override {
+		str.clear();
+		for (int key = getKey(); key != ERR && key != '\n' && key != '\r' && key != KEY_ENTER; key = getKey())
+			str += static_cast<char>(key);
+	}
+
+private:
+	// Put a character at the cursor and move past it. Like curses, tabs go to the next multiple of
+	// 8 columns, control characters show up as ^X and the cursor wraps at the end of a row.
+	void put(char ch, TextIO::COLOR fcolor) {
+		if (ch == '\n') {
+			while (col_ < cols_)
+				cells_[row_ * cols_ + col_++] = kBlank;
+			advance();
+			return;
+		}
+		if (ch == '\t') {
+			for (int spaces = kTabSize - col_ % kTabSize; spaces > 0; --spaces)
+				put(' ', fcolor);
+			return;
+		}
+		if ((ch >= 0 && ch < ' ') || ch == 127) {
+			put('^', fcolor);
+			put(ch == 127 ? '?' : ch + '@', fcolor);
+			return;
+		}
+		cells_[row_ * cols_ + col_] = TextIO::cell(ch, fcolor);
+		++col_;
+		if (col_ == cols_) advance();
+	}
+
+	// Go to the start of the next row, or stay at the end of the last one.
+	void advance() {
+		if (row_ + 1 < rows_) {
+			++row_;
+			col_ = 0;
+		}
+		else
+			col_ = cols_ - 1;
+	}
+
+	static constexpr TextIO::Cell kBlank = ' ' | COLOR_PAIR(TextIO::COLOR::WHITE);
+	static const int kTabSize = 8;
+	int rows_, cols_;
+	std::vector<TextIO::Cell> cells_;	// row by row
+	int row_, col_;	// the cursor
+	int refreshes_;
+	std::deque<int> keys_;	// keys typed but not read yet
+};
+
+#endif // FRAMEBUFFER_H_
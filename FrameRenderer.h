@@ -0,0 +1,277 @@
+#ifndef FRAMERENDERER_H_
+#define FRAMERENDERER_H_
+
+// Draws snapshots of the editor window on the terminal. The editor builds a Frame after every batch of
+// keys and hands it over; once handed over a frame never changes, so it can be drawn on another thread
+// while the editor goes on to the next keys.
+
+#include "SpellCheck.h"
+#include "TextIO.h"
+#include "Trace.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <cctype>
+#include <algorithm>
+
+// One picture of the editor window.
+struct Frame {
+	int top, left;	// the document row and column shown in the top left corner of the window; with wrap, top
+			// is a screen row counted from the top of the document and left is 0
+	std::vector<std::shared_ptr<const std::string>> lines;	// the line on each row, null past the end of the file
+	std::vector<int> starts;	// the column of its line that each row starts at
+	bool wrap;	// true if long lines wrap onto the rows below them instead of running off the window
+	std::string status;	// the status line
+	bool show_suggestions;	// true to show spelling suggestions for the word under the cursor on the status line
+	bool spell_check;	// true to hilight misspelled words
+	SpellCheck* checker;	// the shown buffer's spell checker; it has to be safe to use from the thread that draws
+	int generation;	// the dictionary the editor is using
+	int cursor_row, cursor_col;	// where the cursor goes on the screen
+};
+
+class FrameRenderer {
+public:
+	// Misspellings are found with the spell checker each frame names.
+	// rows: # of rows in the editor window, the status line goes below them.
+	// cols: # of columns in the editor window.
+	FrameRenderer(int rows, int cols)
+		: rows_(rows), cols_(cols) {
+		screen_top_ = 0;
+		screen_wrap_ = false;
+		screen_generation_ = -1;
+	}
+
+	// Draw a frame, sending the terminal only the rows that don't show what they should yet. Rows are
+	// spell checked before the screen lock is taken, so reading keys never waits on a spell check.
+	void draw(const Frame& frame) {
+		TRACE_SCOPE("draw");
+		const int scrolled = followFrame(frame);
+
+		std::vector<int> changed;
+		std::vector<std::string> patterns;
+		for (int row = 0; row < rows_; ++row) {
+			const std::shared_ptr<const std::string>& line = frame.lines[row];
+			const ScreenRow& shown = screen_[row];
+			if (shown.valid && shown.start == frame.starts[row] && (shown.line == line || textOf(shown.line) == textOf(line)))
+				continue;
+			changed.push_back(row);
+			patterns.push_back(std::string());
+			if (frame.spell_check) produceBadPattern(frame.checker, textOf(line), frame.starts[row], patterns.back());
+		}
+		const std::string suggestions = frame.show_suggestions ? getSuggestionString(frame) : std::string();
+
+		std::lock_guard<std::mutex> lock(TextIO::mutex());
+		TRACE_SCOPE("output");
+		if (scrolled != 0) TextIO::scrollRows(0, rows_ - 1, scrolled);
+		for (int i = 0; i < changed.size(); ++i) {
+			const int row = changed[i];
+			const std::string& text = textOf(frame.lines[row]);
+			if (text.length() <= frame.starts[row])
+				clearLine(row);
+			else
+				writeLine(row, text, patterns[i], frame.starts[row]);
+			screen_[row].line = frame.lines[row];
+			screen_[row].start = frame.starts[row];
+			screen_[row].valid = true;
+		}
+		writeStatus(frame.status);
+		// If the cursor is on a misspelled word, then display spelling suggestions (if there
+		// are any) at the bottom of the screen.
+		TextIO::move(rows_, 0);
+		TextIO::print(suggestions, TextIO::COLOR::RED);
+		TextIO::move(frame.cursor_row, frame.cursor_col);
+		TRACE_SCOPE("refresh");
+		TextIO::refresh();
+	}
+
+private:
+	// Bring the shadow screen in line with where the frame is in the document. Moving the window up or
+	// down scrolls the rows that stay visible instead of redrawing them; a different dictionary or
+	// turning wrap on or off changes every row.
+	// Returns how many rows the terminal has to be scrolled up (down if negative).
+	int followFrame(const Frame& frame) {
+		const int generation = frame.spell_check ? frame.generation : -1;
+		if (screen_.size() != rows_ || frame.wrap != screen_wrap_ || generation != screen_generation_) {
+			screen_.assign(rows_, ScreenRow());
+			screen_top_ = frame.top;
+			screen_wrap_ = frame.wrap;
+			screen_generation_ = generation;
+		}
+
+		const int scrolled = frame.top - screen_top_;
+		screen_top_ = frame.top;
+		if (scrolled == 0) return 0;
+		if (scrolled >= rows_ || -scrolled >= rows_) {
+			screen_.assign(rows_, ScreenRow());
+			return 0;
+		}
+		if (scrolled > 0) {
+			screen_.erase(screen_.begin(), screen_.begin() + scrolled);
+			screen_.insert(screen_.end(), scrolled, ScreenRow());
+		}
+		else {
+			screen_.erase(screen_.end() + scrolled, screen_.end());
+			screen_.insert(screen_.begin(), -scrolled, ScreenRow());
+		}
+		return scrolled;
+	}
+
+	static const std::string& textOf(const std::shared_ptr<const std::string>& line) {
+		static const std::string kNoLine;
+		return line ? *line : kNoLine;
+	}
+
+	// Get a list of spelling suggestions for the word in the editor that the cursor is currently
+	// positioned on top of. If the word is spelled correctly, this returns the empty string.
+	// Otherwise it returns a string like: "Spelling suggestions: apple, ample" if there are
+	// suggestions or "No spelling suggestions." if there are no suggestions.
+	// Returns the suggestion string.
+	std::string getSuggestionString(const Frame& frame) {
+		TRACE_SCOPE("getSuggestionString");
+		if (frame.cursor_row < 0 || frame.cursor_row >= rows_) return "";
+		const std::string& line = textOf(frame.lines[frame.cursor_row]);
+		int cur_col = frame.starts[frame.cursor_row] + frame.cursor_col;
+		if (line.empty()) return "";  // empty line
+		if (cur_col >= line.length()) return ""; // at end of line
+		if (!SpellCheck::isWordChar(line[cur_col])) return "";  // not on a word
+
+		// Extract the full word that the cursor is sitting on.
+		while (cur_col >= 0 && SpellCheck::isWordChar(line[cur_col]))
+			--cur_col;
+		++cur_col;
+		std::string cur_word;
+		while (cur_col != line.length() && SpellCheck::isWordChar(line[cur_col])) {
+			cur_word += line[cur_col];
+			++cur_col;
+		}
+
+		// Ask the student's spell checker if the word is spelled correctly, and if not
+		// for up to kNumSuggestions suggestions.
+		const int kNumSuggestions = 20;
+		std::vector<std::string> suggestions;
+		if (frame.checker->spellCheck(cur_word, kNumSuggestions, suggestions)) return "";
+
+		// Create a string with the suggestions (if any).
+		std::string sugg_line;
+		std::string sugg_base = "Spelling suggestions: ";
+		const int kCommaLength = 2;
+		for (const auto& s : suggestions) {
+			if (sugg_line.length() + s.length() + sugg_base.length() + kCommaLength <= cols_) {
+				if (!sugg_line.empty()) sugg_line += ", ";
+				sugg_line += s;
+			}
+		}
+
+		if (sugg_line.empty()) return "No spelling suggestions.";
+
+		return sugg_base + sugg_line;
+	}
+
+	// Compute a pattern of spaces and asterisks for the part of the current line shown on a row,
+	// indicating where spelling mistakes were found. A space indicates a spot where a word is spelled
+	// properly, and an asterisk indicates that the letter is part of a word that's spelled improperly. e.g.:
+	// For this line:    "Thys is spelt wrong."
+	// Would yield this: "****    *****       "
+	// This is used to hilight misspellings in red. Only the words that show up on the row are checked,
+	// so a very long line costs no more than a screenful.
+	// checker: The spell checker to find them with.
+	// line: The input line from the text editor
+	// start: The column of the line the row starts at.
+	// prob_str: The spaces and asterisks that show the locations of the spelling mistakes, one for each
+	// column of the row the line reaches.
+	void produceBadPattern(SpellCheck* checker, const std::string& line, int start, std::string& prob_str) {
+		TRACE_SCOPE("produceBadPattern");
+		if (line.length() <= start) return;
+		const int end = std::min(static_cast<int>(line.length()), start + cols_);
+		// Create a string of all spaces that is the same length as the part of the line that's shown.
+		// We start by assuming all words are spelled correctly.
+		prob_str = std::string(end - start, kGoodChar);
+		std::vector<SpellCheck::Position> problems;
+		// Get a list of all problems on the shown part of the line.
+		checker->spellCheckRange(line, start, end, problems);
+		// Add asterisks to problem spots in the string.
+		for (const auto& p : problems) {
+			for (int i = std::max(p.start, start); i <= p.end && i < end; ++i)
+				prob_str[i - start] = kBadChar;
+		}
+	}
+
+	// Write a line to the console at the specified location, hilighting misspelled words in red.
+	// row: What row of the screen to print the line on.
+	// line: The line to output
+	// prob_str: Where the misspellings in the shown part of the line are, see produceBadPattern(); empty if none.
+	// start: The column of the line to start printing at.
+	void writeLine(int row, const std::string& line, std::string prob_str, int start) {
+		TextIO::move(row, 0);
+		// Determine what to actually print out. Since lines can be very long, we need to compute
+		// what columns of the line is currently being displayed within the GUI.
+		std::string print_me;
+		if (line.length() >= start)
+			print_me = line.substr(start, cols_);
+		if (prob_str.empty()) prob_str.assign(print_me.length(), kGoodChar);
+		// Pad with spaces as necessary to overwrite other text from before.
+		if (cols_ > print_me.length()) {
+			print_me.insert(print_me.length(), cols_ - print_me.length(), ' ');
+			prob_str.insert(prob_str.length(), cols_ - prob_str.length(), ' ');
+		}
+		// Print the text in white/red to hilight errors. A line of plain printable characters is copied
+		// onto the screen as one row of prebuilt cells.
+		bool printable = true;
+		for (const char ch : print_me)
+			printable = printable && ch >= ' ' && ch <= '~';
+		if (printable) {
+			cells_.resize(print_me.length());
+			for (int i = 0; i < print_me.length(); ++i)
+				cells_[i] = TextIO::cell(print_me[i], prob_str[i] == kBadChar ? TextIO::COLOR::RED : TextIO::COLOR::WHITE);
+			TextIO::print(cells_.data(), static_cast<int>(cells_.size()));
+			return;
+		}
+		// Otherwise curses has to expand tabs and control characters, so print one run of same colored
+		// characters at a time.
+		for (int i = 0; i < print_me.length(); ) {
+			const bool bad = prob_str[i] == kBadChar;
+			int end = i + 1;
+			while (end < print_me.length() && (prob_str[end] == kBadChar) == bad)
+				++end;
+			TextIO::print(print_me.data() + i, end - i, bad ? TextIO::COLOR::RED : TextIO::COLOR::WHITE);
+			i = end;
+		}
+	}
+
+	// Print the status line on the bottom of the screen, overwriting other text that might have been there before.
+	void writeStatus(const std::string& line) {
+		TextIO::move(rows_, 0);
+		if (line.length() <= cols_) {
+			TextIO::print(line);
+			TextIO::print(std::string(cols_ - line.length(), ' '));
+		}
+		else
+			TextIO::print(line.substr(0, cols_));
+	}
+
+	// Clears the specified row on the screen.
+	void clearLine(const int row) const {
+		TextIO::move(row, 0);
+		const std::string empty(cols_, ' ');
+		TextIO::print(empty);
+	}
+
+	// What a row of the editor window currently shows on the terminal.
+	struct ScreenRow {
+		ScreenRow() : start(0), valid(false) { }
+		std::shared_ptr<const std::string> line;	// the whole line shown on the row
+		int start;	// the column of the line the row starts at
+		bool valid;	// false if we don't know what's on the row
+	};
+
+	static const char kGoodChar = ' ', kBadChar = '*';
+	int rows_, cols_;
+	std::vector<ScreenRow> screen_;	// shadow copy of what the editor window shows
+	std::vector<TextIO::Cell> cells_;	// row of screen cells writeLine() builds, kept to reuse its memory
+	int screen_top_;	// the frame position the shadow was drawn with
+	bool screen_wrap_;	// whether the shadow was drawn with wrap on
+	int screen_generation_;	// the dictionary the shadow was spell checked with, -1 for none
+};
+
+#endif // FRAMERENDERER_H_
@@ -0,0 +1,342 @@
+#ifndef IMPLICITTREAP_H_
+#define IMPLICITTREAP_H_
+
+#include <vector>
+#include <random>
+#include <cstddef>
+#include <utility> // for std::swap
+
+// A sequence kept in a treap keyed by position (an "implicit" treap), where every subtree knows how
+// many items are under it and a summary of them, so a run of items is replaced, added or removed in
+// O(log n) plus building the new ones, and an index finds its item, or a position by summary, in
+// O(log n). Every node links to its parent too, so a node kept hold of elsewhere (e.g., in a posting
+// list) finds its index in O(log n). The Summary policy says what is kept and how it adds up:
+//	typedef ... Item; // kept for every item
+//	typedef ... Sum; // kept for every subtree, value initialized to the sum of nothing
+//	static Sum sumOf(const Item& item);
+//	static void add(Sum& sum, const Sum& more);
+template<typename Summary>
+class ImplicitTreap
+{
+public:
+	typedef typename Summary::Item Item;
+	typedef typename Summary::Sum Sum;
+
+	struct Node
+	{
+		Node* left;
+		Node* right;
+		Node* parent; // null at the root
+		unsigned priority;
+		int size; // items in this subtree
+		Item item;
+		Sum sum; // of this subtree
+	};
+
+	explicit ImplicitTreap(unsigned seed) : m_root(nullptr), m_random(seed) {}
+	ImplicitTreap(const ImplicitTreap&) = delete;
+	ImplicitTreap& operator=(const ImplicitTreap&) = delete;
+	~ImplicitTreap() { destroy(m_root, [](Node*) {}); }
+
+	// Items [first, first+oldCount) are replaced by count new ones, item(i) being the ith of them; they're
+	// made in order, so item can walk along whatever they come from
+	// The old nodes are given the first of the new items, so replacing a run with as many items (e.g.,
+	// sorting lines) allocates and frees nothing, and only the rest are built or freed
+	template<typename MakeItem> void replace(int first, int oldCount, size_t count, MakeItem item)
+	{
+		replaceNodes(first, oldCount, count, [&](int i, Node* node) { node->item = item(i); }, [](Node*) {});
+	}
+
+	// replace() for new items made one apiece from the count things starting at from, item(*from) making
+	// each; it's for iterators that are cheap to step to the next thing but not to jump with (e.g., a
+	// LineStore::const_iterator), since the items are made in order and from is only ever stepped by one
+	template<typename Iterator, typename MakeItem> void replaceFrom(int first, int oldCount, Iterator from, size_t count, MakeItem item)
+	{
+		replace(first, oldCount, count, [&](size_t)
+		{
+			Item made = item(*from);
+			++from;
+			return made;
+		});
+	}
+
+	// replace() for items that have to know their nodes: set(i, node) gives node the ith new item, in
+	// order, node being an old one with its old item or a new one with Item(), and drop(node) is told of
+	// every old node that's left over before it's freed
+	template<typename Set, typename Drop> void replaceNodes(int first, int oldCount, size_t count, Set set, Drop drop)
+	{
+		Node* before;
+		Node* rest;
+		Node* replaced;
+		Node* after;
+		split(m_root, first, before, rest);
+		split(rest, oldCount, replaced, after);
+		Node* unused = nullptr;
+		if (count < static_cast<size_t>(oldCount))
+			split(replaced, static_cast<int>(count), replaced, unused);
+		destroy(unused, drop);
+		int index = 0;
+		eachNode(replaced, index, [&](int i, Node* node) { set(i, node); });
+		Node* added = build(count - index, [&](size_t i, Node* node) { set(index + static_cast<int>(i), node); });
+		setRoot(merge(merge(merge(before, replaced), added), after));
+	}
+
+	// Lets change() change the item at index, O(log n)
+	template<typename Change> void change(int index, Change change)
+	{
+		changeAt(m_root, index, change);
+	}
+
+	// Puts the order.size() items from first on in a new order, the ith of them being the one that was
+	// order[i]th, O(log n + count); nothing is made again, so it's for items that only moved
+	void reorder(int first, const std::vector<size_t>& order)
+	{
+		Node* before;
+		Node* rest;
+		Node* range;
+		Node* after;
+		split(m_root, first, before, rest);
+		split(rest, static_cast<int>(order.size()), range, after);
+		std::vector<Item> items;
+		items.reserve(order.size());
+		int index = 0;
+		changeEach(range, index, [&](int, Item& item) { items.push_back(item); });
+		// gathered in a loop of its own, where the reads all over items can overlap
+		std::vector<Item> moved(order.size());
+		for (size_t i = 0; i < order.size(); i++)
+			moved[i] = items[order[i]];
+		index = 0;
+		changeEach(range, index, [&](int i, Item& item) { item = moved[i]; });
+		setRoot(merge(merge(before, range), after));
+	}
+
+	// Lets change(i, item) change the count items from first on, item being the ith of them,
+	// O(log n + count)
+	template<typename Change> void changeRange(int first, int count, Change change)
+	{
+		Node* before;
+		Node* rest;
+		Node* range;
+		Node* after;
+		split(m_root, first, before, rest);
+		split(rest, count, range, after);
+		int index = 0;
+		changeEach(range, index, change);
+		setRoot(merge(merge(before, range), after));
+	}
+
+	// Lets change() change every item, O(n)
+	template<typename Change> void changeAll(Change change)
+	{
+		// Parents come before their children, so going back over them sums the children first
+		std::vector<Node*> nodes;
+		if (m_root != nullptr)
+			nodes.push_back(m_root);
+		for (size_t i = 0; i < nodes.size(); i++)
+		{
+			change(nodes[i]->item);
+			if (nodes[i]->left != nullptr)
+				nodes.push_back(nodes[i]->left);
+			if (nodes[i]->right != nullptr)
+				nodes.push_back(nodes[i]->right);
+		}
+		for (size_t i = nodes.size(); i > 0; i--)
+			update(nodes[i - 1]);
+	}
+
+	// Lets visit() see every item, in order, O(n)
+	template<typename Visit> void forEach(Visit visit) const
+	{
+		std::vector<const Node*> pending;
+		for (const Node* node = m_root; node != nullptr || !pending.empty(); )
+		{
+			for (; node != nullptr; node = node->left)
+				pending.push_back(node);
+			node = pending.back();
+			pending.pop_back();
+			visit(node->item);
+			node = node->right;
+		}
+	}
+
+	void clear()
+	{
+		destroy(m_root, [](Node*) {});
+		m_root = nullptr;
+	}
+
+	// Trade items with other, O(1)
+	void swap(ImplicitTreap& other)
+	{
+		std::swap(m_root, other.m_root);
+		std::swap(m_random, other.m_random);
+	}
+
+	int size() const { return sizeOf(m_root); }
+	Sum total() const { return sumOf(m_root); }
+	size_t bytes() const { return sizeof(*this) + sizeOf(m_root) * sizeof(Node); }
+
+	// For walking down the tree to find an item by its summary
+	const Node* root() const { return m_root; }
+	static int sizeOf(const Node* node) { return node != nullptr ? node->size : 0; }
+	static Sum sumOf(const Node* node) { return node != nullptr ? node->sum : Sum(); }
+
+	// The index of the item at node, O(log n): climbs to the root, adding up the items left of every
+	// step up from a right child
+	static int indexOf(const Node* node)
+	{
+		int index = sizeOf(node->left);
+		for (; node->parent != nullptr; node = node->parent)
+		{
+			if (node == node->parent->right)
+				index += sizeOf(node->parent->left) + 1;
+		}
+		return index;
+	}
+
+private:
+	static void update(Node* node)
+	{
+		node->size = 1;
+		node->sum = Summary::sumOf(node->item);
+		if (node->left != nullptr)
+		{
+			node->size += node->left->size;
+			Summary::add(node->sum, node->left->sum);
+			node->left->parent = node;
+		}
+		if (node->right != nullptr)
+		{
+			node->size += node->right->size;
+			Summary::add(node->sum, node->right->sum);
+			node->right->parent = node;
+		}
+	}
+
+	// Every node's parent is set as its parent is updated, which leaves the root's
+	void setRoot(Node* root)
+	{
+		m_root = root;
+		if (m_root != nullptr)
+			m_root->parent = nullptr;
+	}
+
+	template<typename Change> static void changeAt(Node* node, int index, Change& change)
+	{
+		if (node == nullptr)
+			return;
+		const int left = sizeOf(node->left);
+		if (index < left)
+			changeAt(node->left, index, change);
+		else if (index == left)
+			change(node->item);
+		else
+			changeAt(node->right, index - left - 1, change);
+		update(node);
+	}
+
+	// In order, so index counts the items changed so far
+	template<typename Change> static void changeEach(Node* node, int& index, Change&& change)
+	{
+		eachNode(node, index, [&](int i, Node* at) { change(i, at->item); });
+	}
+
+	template<typename Change> static void eachNode(Node* node, int& index, Change&& change)
+	{
+		if (node == nullptr)
+			return;
+		eachNode(node->left, index, change);
+		change(index++, node);
+		eachNode(node->right, index, change);
+		update(node);
+	}
+
+	// Builds the treap of a run of items in O(n), set(i, node) giving the ith its item: the nodes are
+	// added left to right, keeping the right spine on a stack, so each node is pushed and popped once
+	template<typename Set> Node* build(size_t count, Set set)
+	{
+		std::vector<Node*> spine;
+		for (size_t i = 0; i < count; i++)
+		{
+			Node* node = new Node{ nullptr, nullptr, nullptr, static_cast<unsigned>(m_random()), 1, Item(), Sum() };
+			set(i, node);
+			Node* last = nullptr;
+			while (!spine.empty() && spine.back()->priority < node->priority)
+			{
+				last = spine.back();
+				spine.pop_back();
+				update(last);
+			}
+			node->left = last;
+			if (!spine.empty())
+				spine.back()->right = node;
+			spine.push_back(node);
+		}
+		for (size_t i = spine.size(); i > 0; i--)
+			update(spine[i - 1]);
+		return spine.empty() ? nullptr : spine.front();
+	}
+
+	// Splits off the first count items into left, the rest into right
+	static void split(Node* node, int count, Node*& left, Node*& right)
+	{
+		if (node == nullptr)
+		{
+			left = right = nullptr;
+			return;
+		}
+		if (sizeOf(node->left) < count)
+		{
+			split(node->right, count - sizeOf(node->left) - 1, node->right, right);
+			left = node;
+		}
+		else
+		{
+			split(node->left, count, left, node->left);
+			right = node;
+		}
+		update(node);
+	}
+
+	static Node* merge(Node* left, Node* right)
+	{
+		if (left == nullptr)
+			return right;
+		if (right == nullptr)
+			return left;
+		if (left->priority > right->priority)
+		{
+			left->right = merge(left->right, right);
+			update(left);
+			return left;
+		}
+		right->left = merge(left, right->left);
+		update(right);
+		return right;
+	}
+
+	// Frees the nodes under node, telling drop(node) of every one first
+	template<typename Drop> static void destroy(Node* node, Drop&& drop)
+	{
+		// Iterative so a degenerate tree can't overflow the stack
+		std::vector<Node*> pending;
+		if (node != nullptr)
+			pending.push_back(node);
+		while (!pending.empty())
+		{
+			Node* next = pending.back();
+			pending.pop_back();
+			if (next->left != nullptr)
+				pending.push_back(next->left);
+			if (next->right != nullptr)
+				pending.push_back(next->right);
+			drop(next);
+			delete next;
+		}
+	}
+
+	Node* m_root;
+	std::minstd_rand m_random;
+};
+
+#endif // IMPLICITTREAP_H_
@@ -0,0 +1,107 @@
+#ifndef INPUTREADER_H_
+#define INPUTREADER_H_
+
+// Reads keys from the terminal on a thread of its own and hands them to the editor through a lock-free
+// queue, so keys keep being picked up while the editor is busy editing, saving or spell checking.
+
+#include "TextIO.h"
+#include "SpscQueue.h"
+#include "Trace.h"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <vector>
+
+class InputReader {
+public:
+	InputReader() : keys_(kQueueSize), stop_(false) { }
+
+	~InputReader() {
+		stop();
+	}
+
+	// Start reading keys on the input thread.
+	void start() {
+		stop_ = false;
+		thread_ = std::thread(&InputReader::readKeys, this);
+	}
+
+	// Stop reading keys and wait for the input thread to finish.
+	void stop() {
+		if (!thread_.joinable()) return;
+		stop_ = true;
+		thread_.join();
+	}
+
+	bool running() const {
+		return thread_.joinable();
+	}
+
+	// Take the next key the user pressed, waiting up to timeout_millis for one (forever if negative).
+	// Only one thread may take keys.
+	// Returns ERR if no key came in time.
+	int getKey(int timeout_millis) {
+		int ch;
+		if (keys_.pop(ch)) return ch;
+		if (timeout_millis == 0) return ERR;
+
+		// The queue is empty, so sleep until the input thread rings.
+		std::unique_lock<std::mutex> lock(doorbell_mutex_);
+		const auto ready = [this] { return !keys_.empty(); };
+		if (timeout_millis < 0)
+			doorbell_.wait(lock, ready);
+		else if (!doorbell_.wait_for(lock, std::chrono::milliseconds(timeout_millis), ready))
+			return ERR;
+		keys_.pop(ch);
+		return ch;
+	}
+
+private:
+	// The input thread: wait for the terminal to have input, take every key curses can decode from it
+	// under the screen lock, and queue them up for the editor.
+	void readKeys() {
+		Trace::nameThread("input");
+		std::vector<int> batch;
+		while (!stop_) {
+			if (!TextIO::waitForInput(kPollMillis)) continue;
+			batch.clear();
+			{
+				TRACE_SCOPE("readKeys");
+				std::lock_guard<std::mutex> lock(TextIO::mutex());
+				TextIO::setInputTimeout(0);
+				for (int ch = TextIO::getChar(); ch != ERR; ch = TextIO::getChar())
+					batch.push_back(ch);
+			}
+			for (const int ch : batch) {
+				while (!keys_.push(ch)) {
+					// The editor is behind (e.g., a huge paste); let it catch up.
+					if (stop_) return;
+					ring();
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+				}
+			}
+			if (!batch.empty()) ring();
+		}
+	}
+
+	// Wake the editor up if it's waiting for a key. Taking the lock makes sure a getKey() that just
+	// found the queue empty is already waiting before it gets notified.
+	void ring() {
+		{
+			std::lock_guard<std::mutex> lock(doorbell_mutex_);
+		}
+		doorbell_.notify_one();
+	}
+
+	static const int kQueueSize = 4096;
+	static const int kPollMillis = 50;	// how often the input thread checks if it should stop
+	SpscQueue<int> keys_;
+	std::atomic<bool> stop_;
+	std::thread thread_;
+	std::mutex doorbell_mutex_;
+	std::condition_variable doorbell_;
+};
+
+#endif // INPUTREADER_H_
@@ -0,0 +1,142 @@
+#include "LineDiff.h"
+#include <string>
+#include <vector>
+#include <functional> // for std::hash
+#include <algorithm> // for std::reverse
+#include <utility> // for std::pair
+using namespace std;
+
+namespace
+{
+	// The middle of the two versions, the part that isn't the same at the start or the end
+	class Middle
+	{
+	public:
+		Middle(const vector<string>& before, const vector<string>& after, int start, int oldCount, int newCount)
+			: m_before(before), m_after(after), m_start(start)
+		{
+			hash<string> hasher;
+			for (int i = 0; i < oldCount; i++)
+				m_oldHashes.push_back(hasher(before[start + i]));
+			for (int i = 0; i < newCount; i++)
+				m_newHashes.push_back(hasher(after[start + i]));
+		}
+
+		int oldCount() const { return m_oldHashes.size(); }
+		int newCount() const { return m_newHashes.size(); }
+
+		bool same(int x, int y) const
+		{
+			return m_oldHashes[x] == m_newHashes[y] && m_before[m_start + x] == m_after[m_start + y];
+		}
+
+	private:
+		const vector<string>& m_before;
+		const vector<string>& m_after;
+		int m_start;
+		vector<size_t> m_oldHashes;
+		vector<size_t> m_newHashes;
+	};
+
+	// Finds the lines of the middle that stay the same, as (old line, new line) pairs in order, returns
+	// false if it takes more than maxEdits edits
+	bool matchLines(const Middle& middle, int maxEdits, vector<pair<int, int>>& matches)
+	{
+		// O((N+M)D) time and O(D^2) space where D is the number of lines added and removed
+		const int n = middle.oldCount();
+		const int m = middle.newCount();
+		const int limit = min(n + m, maxEdits);
+		// furthest[k] is how far along the old lines the furthest path on diagonal k (x - y) got
+		vector<int> furthest(2 * limit + 3, 0);
+		const int offset = limit + 1;
+		vector<vector<int>> trace; // furthest[-d, d] before each round d, to walk the path back
+		for (int d = 0; d <= limit; d++)
+		{
+			trace.push_back(vector<int>(furthest.begin() + offset - d, furthest.begin() + offset + d + 1));
+			for (int k = -d; k <= d; k += 2)
+			{
+				// step down (an added line) from diagonal k+1 or right (a removed line) from k-1
+				int x;
+				if (k == -d || (k != d && furthest[offset + k - 1] < furthest[offset + k + 1]))
+					x = furthest[offset + k + 1];
+				else
+					x = furthest[offset + k - 1] + 1;
+				int y = x - k;
+				while (x < n && y < m && middle.same(x, y))
+				{
+					x++;
+					y++;
+				}
+				furthest[offset + k] = x;
+				if (x < n || y < m)
+					continue;
+
+				// walk the path back from the end, picking up the lines it went along diagonally
+				for (int back = d; back > 0; back--)
+				{
+					const vector<int>& before = trace[back]; // covers diagonals [-back, back]
+					const auto at = [&](int diagonal) { return before[diagonal + back]; };
+					const int diagonal = x - y;
+					const int from = (diagonal == -back || (diagonal != back && at(diagonal - 1) < at(diagonal + 1))) ? diagonal + 1 : diagonal - 1;
+					const int fromX = at(from);
+					const int fromY = fromX - from;
+					const int startX = from == diagonal + 1 ? fromX : fromX + 1; // where the diagonal run started
+					while (x > startX)
+					{
+						x--;
+						y--;
+						matches.push_back(make_pair(x, y));
+					}
+					x = fromX;
+					y = fromY;
+				}
+				while (x > 0)
+				{
+					x--;
+					y--;
+					matches.push_back(make_pair(x, y));
+				}
+				reverse(matches.begin(), matches.end());
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+void diffLines(const std::vector<std::string>& before, const std::vector<std::string>& after,
+	std::vector<DiffHunk>& hunks, int maxEdits)
+{
+	hunks.clear();
+	int start = 0;
+	while (start < before.size() && start < after.size() && before[start] == after[start])
+		start++;
+	int oldEnd = before.size();
+	int newEnd = after.size();
+	while (oldEnd > start && newEnd > start && before[oldEnd - 1] == after[newEnd - 1])
+	{
+		oldEnd--;
+		newEnd--;
+	}
+	if (oldEnd == start && newEnd == start)
+		return;
+
+	const Middle middle(before, after, start, oldEnd - start, newEnd - start);
+	vector<pair<int, int>> matches;
+	if (!matchLines(middle, maxEdits, matches))
+	{
+		hunks.push_back(DiffHunk{ start, oldEnd - start, start, newEnd - start });
+		return;
+	}
+	// the hunks are the gaps between the lines that stay the same
+	matches.push_back(make_pair(middle.oldCount(), middle.newCount()));
+	int x = 0;
+	int y = 0;
+	for (const auto& match : matches)
+	{
+		if (match.first > x || match.second > y)
+			hunks.push_back(DiffHunk{ start + x, match.first - x, start + y, match.second - y });
+		x = match.first + 1;
+		y = match.second + 1;
+	}
+}
@@ -0,0 +1,26 @@
+#ifndef LINEDIFF_H_
+#define LINEDIFF_H_
+
+#include <string>
+#include <vector>
+
+// A run of lines that differs between two versions of a text: lines [oldStart, oldStart+oldCount) of
+// the old version became lines [newStart, newStart+newCount) of the new one
+struct DiffHunk
+{
+	int oldStart;
+	int oldCount;
+	int newStart;
+	int newCount;
+};
+
+// Puts the runs of lines that differ between before and after onto hunks, in order, changing as few
+// lines as possible
+// The lines both versions start and end with are skipped first, then what's left is diffed with Myers'
+// O((N+M)D) algorithm, comparing lines by hash and only comparing the text of lines whose hashes agree.
+// If more than maxEdits lines were added or removed, everything between the common start and end is
+// one hunk instead
+void diffLines(const std::vector<std::string>& before, const std::vector<std::string>& after,
+	std::vector<DiffHunk>& hunks, int maxEdits = 1000);
+
+#endif // LINEDIFF_H_
@@ -0,0 +1,514 @@
+#include "LineStore.h"
+#include "LzCodec.h"
+#include "MemoryReport.h"
+#include <string>
+#include <vector>
+#include <memory>
+#include <atomic> // for std::atomic_thread_fence
+#include <iterator> // for std::make_move_iterator
+#include <algorithm> // for std::rotate
+using namespace std;
+
+LineStore::LineStore()
+	: m_root(make_shared<Node>(Node{ true, vector<string>(), vector<Child>() })), m_size(0)
+{
+}
+
+LineStore::const_iterator& LineStore::const_iterator::operator++()
+{
+	m_row++;
+	if (++m_path.back().index < m_lines->size())
+		return *this;
+	// climb to the first node with a child right of the way down, then down its leftmost path
+	m_path.pop_back();
+	while (!m_path.empty() && ++m_path.back().index == m_path.back().node->children.size())
+		m_path.pop_back();
+	if (m_path.empty())
+	{
+		m_block.reset(); // the end
+		return *this;
+	}
+	const Node* node = m_path.back().node->children[m_path.back().index].node.get();
+	for (; !node->leaf; node = node->children.front().node.get())
+		m_path.push_back(Step{ node, 0 });
+	m_path.push_back(Step{ node, 0 });
+	m_lines = &leafLines(node, m_hot, m_block);
+	return *this;
+}
+
+const std::string& LineStore::operator[](int row) const
+{
+	const Node* node = m_root.get();
+	while (!node->leaf)
+		node = node->children[childAt(node, row)].node.get();
+	if (!node->packed)
+		return node->lines[row];
+	shared_ptr<const vector<string>> block; // the hot list keeps it after this lets go
+	return leafLines(node, &m_hot, block)[row];
+}
+
+void LineStore::copyLines(int row, int count, std::vector<std::string>& lines) const
+{
+	if (count > m_size - row)
+		count = m_size - row;
+	auto it = at(row);
+	for (int i = 0; i < count; i++, ++it)
+		lines.push_back(*it);
+}
+
+std::string& LineStore::edit(int row)
+{
+	Node* node = own(m_root);
+	while (!node->leaf)
+		node = own(node->children[childAt(node, row)].node);
+	unpack(node);
+	return node->lines[row];
+}
+
+void LineStore::insert(int row, std::vector<std::string> lines)
+{
+	if (lines.empty())
+		return;
+	m_size += lines.size();
+	insertInto(own(m_root), row, lines);
+	fixRoot();
+}
+
+void LineStore::insert(int row, std::string line)
+{
+	vector<string> lines;
+	lines.push_back(std::move(line));
+	insert(row, std::move(lines));
+}
+
+void LineStore::erase(int row, int count)
+{
+	if (count <= 0)
+		return;
+	m_size -= count;
+	eraseFrom(own(m_root), row, count, nullptr);
+	fixRoot();
+}
+
+void LineStore::erase(int row, int count, std::vector<std::string>& removed)
+{
+	if (count <= 0)
+		return;
+	removed.reserve(removed.size() + count);
+	m_size -= count;
+	eraseFrom(own(m_root), row, count, &removed);
+	fixRoot();
+}
+
+void LineStore::clear()
+{
+	m_root = make_shared<Node>(Node{ true, vector<string>(), vector<Child>() });
+	m_size = 0;
+	m_hot.clear();
+}
+
+LineStore::Snapshot LineStore::snapshot() const
+{
+	Snapshot snapshot;
+	snapshot.m_root = m_root;
+	snapshot.m_size = m_size;
+	return snapshot;
+}
+
+void LineStore::pack(int keepFrom, int keepTo)
+{
+	if (m_size > 0)
+		packFrom(m_root, 0, m_size, keepFrom, keepTo);
+}
+
+template<typename F>
+void LineStore::forEachNode(F visit) const
+{
+	vector<const Node*> pending(1, m_root.get());
+	while (!pending.empty())
+	{
+		const Node* node = pending.back();
+		pending.pop_back();
+		visit(node);
+		for (const Child& child : node->children)
+			pending.push_back(child.node.get());
+	}
+}
+
+size_t LineStore::nodeBytes() const
+{
+	// the shared_ptr control block make_shared puts in front of every node is two counts
+	size_t bytes = 0;
+	forEachNode([&](const Node* node)
+	{
+		bytes += sizeof(Node) + 2 * sizeof(int) + node->lines.capacity() * sizeof(string) + node->children.capacity() * sizeof(Child);
+	});
+	return bytes;
+}
+
+size_t LineStore::lineBytes() const
+{
+	// the lines in the tree, and the ones unpacked from packed leaves read lately
+	size_t bytes = 0;
+	forEachNode([&](const Node* node)
+	{
+		for (const string& line : node->lines)
+			bytes += MemoryReport::heapBytes(line);
+	});
+	for (const Block& block : m_hot)
+	{
+		bytes += sizeof(vector<string>) + block.lines->capacity() * sizeof(string);
+		for (const string& line : *block.lines)
+			bytes += MemoryReport::heapBytes(line);
+	}
+	return bytes;
+}
+
+size_t LineStore::packedBytes() const
+{
+	size_t bytes = 0;
+	forEachNode([&](const Node* node)
+	{
+		if (node->packed)
+			bytes += sizeof(string) + 2 * sizeof(int) + node->packed->capacity() + 1;
+	});
+	return bytes;
+}
+
+int LineStore::packedLines() const
+{
+	int lines = 0;
+	forEachNode([&](const Node* node)
+	{
+		if (node->packed)
+			lines += node->packedLines;
+	});
+	return lines;
+}
+
+LineStore::const_iterator LineStore::iteratorAt(const Node* root, int size, int row, std::vector<Block>* hot)
+{
+	const_iterator it;
+	it.m_row = row;
+	it.m_hot = hot;
+	if (row >= size)
+		return it;
+	const Node* node = root;
+	while (!node->leaf)
+	{
+		const size_t i = childAt(node, row);
+		it.m_path.push_back(const_iterator::Step{ node, i });
+		node = node->children[i].node.get();
+	}
+	it.m_path.push_back(const_iterator::Step{ node, static_cast<size_t>(row) });
+	it.m_lines = &leafLines(node, hot, it.m_block);
+	return it;
+}
+
+// The lines of leaf; for a packed one, from hot if it was read lately, and otherwise unpacked, and put at
+// the front of hot unless it's null. block keeps a packed leaf's lines from going away
+const std::vector<std::string>& LineStore::leafLines(const Node* leaf, std::vector<Block>* hot,
+	std::shared_ptr<const std::vector<std::string>>& block)
+{
+	if (!leaf->packed)
+	{
+		block.reset();
+		return leaf->lines;
+	}
+	if (hot != nullptr)
+	{
+		for (size_t i = 0; i < hot->size(); i++)
+		{
+			const weak_ptr<const string>& packed = (*hot)[i].packed;
+			if (!packed.owner_before(leaf->packed) && !leaf->packed.owner_before(packed))
+			{
+				rotate(hot->begin(), hot->begin() + i, hot->begin() + i + 1);
+				block = hot->front().lines;
+				return *block;
+			}
+		}
+	}
+	auto lines = make_shared<vector<string>>();
+	lines->reserve(leaf->packedLines);
+	unpackLines(*leaf->packed, *lines);
+	block = lines;
+	if (hot != nullptr)
+	{
+		hot->insert(hot->begin(), Block{ leaf->packed, lines });
+		if (hot->size() > HOT_BLOCKS)
+			hot->pop_back();
+	}
+	return *block;
+}
+
+void LineStore::unpackLines(const std::string& packed, std::vector<std::string>& lines)
+{
+	string text;
+	lzDecompress(packed, text);
+	for (size_t start = 0, end; start < text.size(); start = end + 1)
+	{
+		end = text.find('\n', start);
+		lines.emplace_back(text, start, end - start);
+	}
+}
+
+// Unpacks leaf, which the store owns, for good, so it can be changed
+void LineStore::unpack(Node* leaf)
+{
+	if (!leaf->packed)
+		return;
+	bool hot = false;
+	for (const Block& block : m_hot)
+	{
+		if (!block.packed.owner_before(leaf->packed) && !leaf->packed.owner_before(block.packed))
+		{
+			leaf->lines = *block.lines;
+			hot = true;
+			break;
+		}
+	}
+	if (!hot)
+	{
+		leaf->lines.reserve(leaf->packedLines);
+		unpackLines(*leaf->packed, leaf->lines);
+	}
+	leaf->packed.reset();
+	leaf->packedLines = 0;
+}
+
+// Which child of an inner node row is under, leaving row as the row within that child; a row past the
+// end is under the last child
+size_t LineStore::childAt(const Node* node, int& row)
+{
+	size_t i = 0;
+	while (i + 1 < node->children.size() && row >= node->children[i].count)
+		row -= node->children[i++].count;
+	return i;
+}
+
+// Makes node the store's own, copying it if a snapshot shares it, and returns it to change
+// Only called on the way down from the root, after owning the parent, so a node nothing else points to
+// can't be reached from a snapshot either
+LineStore::Node* LineStore::own(std::shared_ptr<Node>& node)
+{
+	if (node.use_count() != 1)
+		node = make_shared<Node>(*node);
+	else
+		atomic_thread_fence(memory_order_acquire); // a snapshot on another thread may have just let go of it
+	node->allPacked = false; // whatever changes under it may unpack a leaf
+	return node.get();
+}
+
+// Inserts lines before row of node, which the store owns, splitting the nodes on the way that get too big
+void LineStore::insertInto(Node* node, int row, std::vector<std::string>& lines)
+{
+	if (node->leaf)
+	{
+		unpack(node);
+		node->lines.insert(node->lines.begin() + row, make_move_iterator(lines.begin()), make_move_iterator(lines.end()));
+		return;
+	}
+	const size_t i = childAt(node, row);
+	node->children[i].count += lines.size();
+	insertInto(own(node->children[i].node), row, lines);
+	split(node, i);
+}
+
+// Erases count lines starting at row of node, which the store owns, moving them onto removed unless
+// it's null
+void LineStore::eraseFrom(Node* node, int row, int count, std::vector<std::string>* removed)
+{
+	if (node->leaf)
+	{
+		unpack(node);
+		if (removed != nullptr)
+			removed->insert(removed->end(), make_move_iterator(node->lines.begin() + row), make_move_iterator(node->lines.begin() + row + count));
+		node->lines.erase(node->lines.begin() + row, node->lines.begin() + row + count);
+		return;
+	}
+	// children the lines cover completely go, at most the first and the last are only partly erased
+	size_t firstGone = node->children.size();
+	size_t lastGone = 0;
+	size_t partly[2];
+	int partlyCount = 0;
+	int start = 0;
+	for (size_t i = 0; i < node->children.size() && start < row + count; i++)
+	{
+		Child& child = node->children[i];
+		const int from = max(row, start);
+		const int to = min(row + count, start + child.count);
+		start += child.count;
+		if (from >= to)
+			continue;
+		if (to - from == child.count)
+		{
+			if (removed != nullptr)
+				takeLines(child.node, true, *removed);
+			firstGone = min(firstGone, i);
+			lastGone = i;
+			continue;
+		}
+		eraseFrom(own(child.node), from - (start - child.count), to - from, removed);
+		child.count -= to - from;
+		partly[partlyCount++] = i;
+	}
+	if (firstGone <= lastGone)
+	{
+		node->children.erase(node->children.begin() + firstGone, node->children.begin() + lastGone + 1);
+		for (int p = 0; p < partlyCount; p++)
+		{
+			if (partly[p] > lastGone)
+				partly[p] -= lastGone + 1 - firstGone;
+		}
+	}
+	// the later one first, so merging it doesn't move the earlier one
+	for (int p = partlyCount - 1; p >= 0; p--)
+	{
+		if (partly[p] < node->children.size())
+			rebalance(node, partly[p]);
+	}
+}
+
+// Moves the lines under node onto the end of lines, copying them if a snapshot shares it; owned is
+// whether the store owns its parent, since a node only the parent points to is still shared through it
+void LineStore::takeLines(const std::shared_ptr<Node>& node, bool owned, std::vector<std::string>& lines)
+{
+	owned = owned && node.use_count() == 1;
+	if (owned)
+		atomic_thread_fence(memory_order_acquire); // a snapshot on another thread may have just let go of it
+	if (!node->leaf)
+	{
+		for (const Child& child : node->children)
+			takeLines(child.node, owned, lines);
+		return;
+	}
+	if (owned && !node->packed)
+	{
+		lines.insert(lines.end(), make_move_iterator(node->lines.begin()), make_move_iterator(node->lines.end()));
+		return;
+	}
+	shared_ptr<const vector<string>> block;
+	const vector<string>& leaf = leafLines(node.get(), nullptr, block);
+	lines.insert(lines.end(), leaf.begin(), leaf.end());
+}
+
+// Splits child i of parent, which the store owns, into nodes SPLIT_ENTRIES full if it has too many entries
+void LineStore::split(Node* parent, size_t i)
+{
+	Node* node = parent->children[i].node.get();
+	const size_t total = entries(node);
+	if (total <= MAX_ENTRIES)
+		return;
+	if (node->leaf)
+		unpack(node);
+	const size_t pieces = (total + SPLIT_ENTRIES - 1) / SPLIT_ENTRIES;
+	vector<Child> siblings;
+	for (size_t p = 1; p < pieces; p++)
+	{
+		const size_t from = total * p / pieces;
+		const size_t to = total * (p + 1) / pieces;
+		auto sibling = make_shared<Node>(Node{ node->leaf, vector<string>(), vector<Child>() });
+		int count = 0;
+		if (node->leaf)
+		{
+			sibling->lines.assign(make_move_iterator(node->lines.begin() + from), make_move_iterator(node->lines.begin() + to));
+			count = to - from;
+		}
+		else
+		{
+			sibling->children.assign(node->children.begin() + from, node->children.begin() + to);
+			for (const Child& child : sibling->children)
+				count += child.count;
+		}
+		siblings.push_back(Child{ sibling, count });
+	}
+	const size_t kept = total / pieces;
+	if (node->leaf)
+		node->lines.resize(kept);
+	else
+		node->children.resize(kept);
+	if (pieces > 2) // a bulk insert, don't leave the first piece holding room for all of it
+	{
+		node->lines.shrink_to_fit();
+		node->children.shrink_to_fit();
+	}
+	for (const Child& sibling : siblings)
+		parent->children[i].count -= sibling.count;
+	parent->children.insert(parent->children.begin() + i + 1, siblings.begin(), siblings.end());
+}
+
+// Merges child i of parent, which the store owns, with a neighbour if it has too few entries
+void LineStore::rebalance(Node* parent, size_t i)
+{
+	if (parent->children.size() < 2 || entries(parent->children[i].node.get()) >= MIN_ENTRIES)
+		return;
+	const size_t left = i + 1 < parent->children.size() ? i : i - 1;
+	Node* into = own(parent->children[left].node);
+	const Child& right = parent->children[left + 1];
+	if (into->leaf)
+	{
+		unpack(into);
+		shared_ptr<const vector<string>> block;
+		const vector<string>& lines = leafLines(right.node.get(), &m_hot, block);
+		into->lines.insert(into->lines.end(), lines.begin(), lines.end());
+	}
+	else
+		into->children.insert(into->children.end(), right.node->children.begin(), right.node->children.end());
+	parent->children[left].count += right.count;
+	parent->children.erase(parent->children.begin() + left + 1);
+	split(parent, left);
+}
+
+// Grows the tree a level while the root has too many entries, and shrinks it while the root has one child
+void LineStore::fixRoot()
+{
+	while (entries(m_root.get()) > MAX_ENTRIES)
+	{
+		auto root = make_shared<Node>(Node{ false, vector<string>(), vector<Child>() });
+		root->children.push_back(Child{ m_root, m_size });
+		m_root = root;
+		split(root.get(), 0);
+	}
+	while (!m_root->leaf && m_root->children.size() == 1)
+		m_root = m_root->children.front().node;
+	if (!m_root->leaf && m_root->children.empty())
+		clear();
+}
+
+// Packs the leaves under node that are wholly outside rows [keepFrom, keepTo), owning the nodes it changes,
+// and returns whether every leaf under it is packed; node's count lines start at row start
+bool LineStore::packFrom(std::shared_ptr<Node>& node, int start, int count, int keepFrom, int keepTo)
+{
+	if (node->allPacked)
+		return true;
+	if (start + count > keepFrom && start < keepTo && (node->leaf || (start >= keepFrom && start + count <= keepTo)))
+		return false; // it's kept, or a leaf partly kept
+	if (node->leaf)
+	{
+		Node* leaf = own(node);
+		string text;
+		for (const string& line : leaf->lines)
+		{
+			text += line;
+			text += '\n';
+		}
+		auto packed = make_shared<string>();
+		lzCompress(text.data(), text.size(), *packed);
+		packed->shrink_to_fit();
+		leaf->packed = packed;
+		leaf->packedLines = leaf->lines.size();
+		vector<string>().swap(leaf->lines);
+		leaf->allPacked = true;
+		return true;
+	}
+	Node* inner = own(node);
+	bool all = true;
+	for (Child& child : inner->children)
+	{
+		if (!packFrom(child.node, start, child.count, keepFrom, keepTo))
+			all = false;
+		start += child.count;
+	}
+	inner->allPacked = all;
+	return all;
+}
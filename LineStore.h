@@ -0,0 +1,156 @@
+#ifndef LINESTORE_H_
+#define LINESTORE_H_
+
+#include <string>
+#include <vector>
+#include <memory>
+#include <cstddef>
+
+// The lines of a document, in a B-tree whose nodes are shared between versions of it
+// A snapshot() is O(1) and keeps seeing the lines as they were however the store changes after it. A
+// change copies the nodes on the way down to the lines it touches that a snapshot still shares, and
+// changes nodes nothing else shares in place, so without snapshots around it's an ordinary B-tree.
+// Snapshots never change, so any thread can read one without locking, and the nodes of a version are
+// freed when the store and the last snapshot sharing them have both let go of them
+// pack() compresses the leaves away from the rows being worked on, for documents too big to keep one
+// string per line of. Reading a packed leaf unpacks it into a short list of recently read blocks, and
+// changing it unpacks it for good, until the next pack(). That list makes even reading the store itself
+// something one thread at a time does
+class LineStore
+{
+	struct Node;
+	struct Child
+	{
+		std::shared_ptr<Node> node;
+		int count; // lines under it
+	};
+	struct Node
+	{
+		bool leaf;
+		std::vector<std::string> lines; // a leaf's lines, unless it's packed
+		std::vector<Child> children; // an inner node's children
+		std::shared_ptr<const std::string> packed; // a packed leaf's lines, each ended by '\n', compressed
+		int packedLines = 0;
+		bool allPacked = false; // every leaf under it is packed, cleared by every change under it
+	};
+	// A packed leaf's lines, unpacked for reading
+	struct Block
+	{
+		std::weak_ptr<const std::string> packed; // keeps the address from being reused while it's listed
+		std::shared_ptr<const std::vector<std::string>> lines;
+	};
+
+public:
+	// Walks the lines of a store or a snapshot in order, ++ is O(1) amortized
+	// Changing the store invalidates iterators into it, but not into a snapshot. An iterator keeps the
+	// packed leaf it's on unpacked for as long as it's on it
+	class const_iterator
+	{
+	public:
+		const std::string& operator*() const { return (*m_lines)[m_path.back().index]; }
+		const std::string* operator->() const { return &**this; }
+		const_iterator& operator++();
+		bool operator==(const const_iterator& other) const { return m_row == other.m_row; }
+		bool operator!=(const const_iterator& other) const { return m_row != other.m_row; }
+		int row() const { return m_row; }
+
+	private:
+		friend class LineStore;
+		struct Step
+		{
+			const Node* node;
+			size_t index;
+		};
+		std::vector<Step> m_path; // from the root down to the line
+		int m_row;
+		const std::vector<std::string>* m_lines = nullptr; // of the leaf it's on
+		std::shared_ptr<const std::vector<std::string>> m_block; // that leaf's lines if it's packed
+		std::vector<Block>* m_hot = nullptr; // the store's recently read blocks, none for a snapshot
+	};
+
+	// A version of the lines that never changes, O(1) to take and to copy
+	// Its iterators unpack the packed leaves they go through on their own, so threads share nothing
+	class Snapshot
+	{
+	public:
+		Snapshot() : m_size(0) {}
+		int size() const { return m_size; }
+		const_iterator begin() const { return iteratorAt(m_root.get(), m_size, 0, nullptr); }
+		const_iterator end() const { return iteratorAt(m_root.get(), m_size, m_size, nullptr); }
+		const_iterator at(int row) const { return iteratorAt(m_root.get(), m_size, row, nullptr); }
+
+	private:
+		friend class LineStore;
+		std::shared_ptr<const Node> m_root;
+		int m_size;
+	};
+
+	LineStore();
+
+	int size() const { return m_size; }
+	bool empty() const { return m_size == 0; }
+	// O(log n), plus unpacking the line's leaf if it's packed and wasn't read lately
+	// The line stays put until the store changes or, for a packed one, HOT_BLOCKS other packed leaves
+	// are read
+	const std::string& operator[](int row) const;
+	const_iterator begin() const { return iteratorAt(m_root.get(), m_size, 0, &m_hot); }
+	const_iterator end() const { return iteratorAt(m_root.get(), m_size, m_size, &m_hot); }
+	const_iterator at(int row) const { return iteratorAt(m_root.get(), m_size, row, &m_hot); }
+	// Adds the count lines from row on (fewer past the end) to the end of lines, O(log n + count)
+	void copyLines(int row, int count, std::vector<std::string>& lines) const;
+
+	// The line at row, to change in place, O(log n)
+	std::string& edit(int row);
+	// Inserts lines before row, or at the end if row is size(), O(log n + K) for K lines
+	void insert(int row, std::vector<std::string> lines);
+	void insert(int row, std::string line);
+	void push_back(std::string line) { insert(m_size, std::move(line)); }
+	// Erases count lines starting at row, O(log n + count)
+	void erase(int row, int count);
+	// Erases them the same way, moving them onto the end of removed in order; only the lines a snapshot
+	// still shares are copied
+	void erase(int row, int count, std::vector<std::string>& removed);
+	void clear();
+
+	Snapshot snapshot() const;
+
+	// Packs the leaves wholly outside rows [keepFrom, keepTo) that aren't packed yet, O(log n) per leaf
+	// unpacked since the last call plus the time to compress the ones it packs
+	// Leaves a snapshot shares stay unpacked in the snapshot, so memory only goes down once it's gone
+	void pack(int keepFrom, int keepTo);
+
+	// What the store takes up, O(n): the nodes, the unpacked lines' own buffers, and the packed leaves
+	size_t nodeBytes() const;
+	size_t lineBytes() const;
+	size_t packedBytes() const;
+	int packedLines() const;
+
+private:
+	static const size_t MAX_ENTRIES = 64; // lines in a leaf or children of an inner node
+	static const size_t MIN_ENTRIES = 16; // fewer and a node is merged with its neighbour
+	static const size_t SPLIT_ENTRIES = 48; // how full the nodes a split makes are
+	static const size_t HOT_BLOCKS = 32; // packed leaves kept unpacked after reading them
+
+	static const_iterator iteratorAt(const Node* root, int size, int row, std::vector<Block>* hot);
+	static const std::vector<std::string>& leafLines(const Node* leaf, std::vector<Block>* hot,
+		std::shared_ptr<const std::vector<std::string>>& block);
+	static void unpackLines(const std::string& packed, std::vector<std::string>& lines);
+	static size_t entries(const Node* node) { return !node->leaf ? node->children.size() : node->packed ? node->packedLines : node->lines.size(); }
+	static size_t childAt(const Node* node, int& row);
+	static Node* own(std::shared_ptr<Node>& node);
+	void unpack(Node* leaf);
+	void insertInto(Node* node, int row, std::vector<std::string>& lines);
+	void eraseFrom(Node* node, int row, int count, std::vector<std::string>* removed);
+	static void takeLines(const std::shared_ptr<Node>& node, bool owned, std::vector<std::string>& lines);
+	void split(Node* parent, size_t i);
+	void rebalance(Node* parent, size_t i);
+	void fixRoot();
+	static bool packFrom(std::shared_ptr<Node>& node, int start, int count, int keepFrom, int keepTo);
+	template<typename F> void forEachNode(F visit) const;
+
+	std::shared_ptr<Node> m_root;
+	int m_size;
+	mutable std::vector<Block> m_hot; // the packed leaves read lately, the latest first
+};
+
+#endif // LINESTORE_H_
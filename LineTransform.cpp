@@ -0,0 +1,227 @@
+#include "LineTransform.h"
+#include "Regex.h"
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstdint>
+#include <cstring> // for std::memcpy
+#include <thread>
+#include <unordered_set>
+#include <functional> // for std::hash
+#include <algorithm> // for std::sort, std::merge
+#include <numeric> // for std::gcd
+using namespace std;
+
+namespace
+{
+	const size_t LINES_PER_THREAD = 4096; // fewer and starting a thread costs more than it saves
+	const int TAB_STOP = 8;
+
+	size_t threadsFor(size_t lines)
+	{
+		size_t threads = thread::hardware_concurrency();
+		if (threads == 0)
+			threads = 1;
+		if (threads > lines / LINES_PER_THREAD + 1)
+			threads = lines / LINES_PER_THREAD + 1;
+		return threads;
+	}
+
+	// Runs work(t) for every t below threads, the first on this thread and the rest on threads of their own
+	template<typename F> void onThreads(size_t threads, F work)
+	{
+		vector<thread> workers;
+		for (size_t t = 1; t < threads; t++)
+			workers.push_back(thread(work, t));
+		work(0);
+		for (thread& worker : workers)
+			worker.join();
+	}
+
+	// Keeps the lines keep says to, in order
+	void keepLines(vector<string>& lines, const vector<char>& keep)
+	{
+		size_t kept = 0;
+		for (size_t i = 0; i < lines.size(); i++)
+		{
+			if (!keep[i])
+				continue;
+			if (kept != i)
+				lines[kept] = std::move(lines[i]);
+			kept++;
+		}
+		lines.resize(kept);
+	}
+
+	// How many columns the whitespace line starts with takes up, and how many characters it is
+	int indentOf(const string& line, size_t& length)
+	{
+		int columns = 0;
+		for (length = 0; length < line.size(); length++)
+		{
+			if (line[length] == ' ')
+				columns++;
+			else if (line[length] == '\t')
+				columns += TAB_STOP - columns % TAB_STOP;
+			else
+				break;
+		}
+		return columns;
+	}
+}
+
+void sortLines(std::vector<std::string>& lines, std::vector<size_t>* order)
+{
+	// O(N log N / T) for the runs, then O(N) for every one of the log T rounds of merging, on T threads
+	const size_t size = lines.size();
+	const size_t threads = threadsFor(size);
+	vector<size_t> bounds(threads + 1);
+	for (size_t t = 0; t <= threads; t++)
+		bounds[t] = size * t / threads;
+
+	// a view of every line, with where it came from so it can be moved rather than copied into place,
+	// and its first 8 bytes as a number that sorts the same way, so most comparisons don't have to go
+	// out to the line's characters, which are all over the heap
+	struct Entry
+	{
+		uint64_t prefix;
+		string_view text;
+		size_t line;
+		bool operator<(const Entry& other) const
+		{
+			if (prefix != other.prefix)
+				return prefix < other.prefix;
+			return text < other.text;
+		}
+	};
+	vector<Entry> views(size);
+	for (size_t i = 0; i < size; i++)
+	{
+		unsigned char bytes[8] = {}; // short lines end in zeros, and fall back on comparing the text
+		memcpy(bytes, lines[i].data(), min(lines[i].size(), sizeof(bytes)));
+		uint64_t prefix = 0;
+		for (unsigned char byte : bytes)
+			prefix = prefix << 8 | byte;
+		views[i] = Entry{ prefix, lines[i], i };
+	}
+	onThreads(threads, [&](size_t t)
+	{
+		sort(views.begin() + bounds[t], views.begin() + bounds[t + 1]);
+	});
+	vector<Entry> merged(size);
+	for (size_t width = 1; width < threads; width *= 2)
+	{
+		// runs [r, r+width) and [r+width, r+2*width) become one, for every r that's a multiple of 2*width
+		const size_t pairs = (threads + 2 * width - 1) / (2 * width);
+		onThreads(pairs, [&](size_t p)
+		{
+			const size_t from = bounds[min(2 * width * p, threads)];
+			const size_t middle = bounds[min(2 * width * p + width, threads)];
+			const size_t to = bounds[min(2 * width * (p + 1), threads)];
+			merge(views.begin() + from, views.begin() + middle, views.begin() + middle, views.begin() + to, merged.begin() + from);
+		});
+		views.swap(merged);
+	}
+
+	vector<string> sorted(size);
+	for (size_t i = 0; i < size; i++)
+		sorted[i] = std::move(lines[views[i].line]);
+	lines.swap(sorted);
+	if (order != nullptr)
+	{
+		order->resize(size);
+		for (size_t i = 0; i < size; i++)
+			(*order)[i] = views[i].line;
+	}
+}
+
+void uniqueLines(std::vector<std::string>& lines)
+{
+	// O(N) on T threads: hashing a share of the lines each, then each looking up the lines in its share
+	// of the hashes
+	const size_t size = lines.size();
+	const size_t threads = threadsFor(size);
+	vector<size_t> hashes(size);
+	onThreads(threads, [&](size_t t)
+	{
+		hash<string> hasher;
+		for (size_t i = size * t / threads; i < size * (t + 1) / threads; i++)
+			hashes[i] = hasher(lines[i]);
+	});
+
+	// the sets hold line numbers, so a line's hash is only worked out the once above
+	struct ByHash
+	{
+		const vector<size_t>* hashes;
+		size_t operator()(size_t i) const { return (*hashes)[i]; }
+	};
+	struct SameLine
+	{
+		const vector<string>* lines;
+		bool operator()(size_t a, size_t b) const { return (*lines)[a] == (*lines)[b]; }
+	};
+	vector<char> keep(size);
+	onThreads(threads, [&](size_t t)
+	{
+		unordered_set<size_t, ByHash, SameLine> seen(size / threads + 1, ByHash{ &hashes }, SameLine{ &lines });
+		for (size_t i = 0; i < size; i++)
+		{
+			if (hashes[i] % threads == t)
+				keep[i] = seen.insert(i).second;
+		}
+	});
+	keepLines(lines, keep);
+}
+
+void filterLines(std::vector<std::string>& lines, const Regex& regex, bool keepMatches)
+{
+	// O(M/T) where M is the number of characters in lines, with a Matcher per thread
+	const size_t size = lines.size();
+	const size_t threads = threadsFor(size);
+	vector<char> keep(size);
+	onThreads(threads, [&](size_t t)
+	{
+		Regex::Matcher matcher(regex);
+		size_t start, end;
+		for (size_t i = size * t / threads; i < size * (t + 1) / threads; i++)
+			keep[i] = matcher.find(lines[i], 0, start, end) == keepMatches;
+	});
+	keepLines(lines, keep);
+}
+
+int reindentLines(std::vector<std::string>& lines, int width)
+{
+	// O(M/T) on T threads: finding the level, then rewriting the indents
+	const size_t size = lines.size();
+	const size_t threads = threadsFor(size);
+	vector<int> levels(threads, 0);
+	onThreads(threads, [&](size_t t)
+	{
+		size_t length;
+		for (size_t i = size * t / threads; i < size * (t + 1) / threads; i++)
+		{
+			const int columns = indentOf(lines[i], length);
+			if (length < lines[i].size())
+				levels[t] = gcd(levels[t], columns);
+		}
+	});
+	int level = 0;
+	for (int found : levels)
+		level = gcd(level, found);
+	if (level == 0) // nothing to rewrite, and the caller leaves the lines alone
+		return 0;
+
+	onThreads(threads, [&](size_t t)
+	{
+		size_t length;
+		for (size_t i = size * t / threads; i < size * (t + 1) / threads; i++)
+		{
+			const int columns = indentOf(lines[i], length);
+			if (length == lines[i].size())
+				lines[i].clear();
+			else if (length > 0)
+				lines[i].replace(0, length, columns / level * width, ' ');
+		}
+	});
+	return level;
+}
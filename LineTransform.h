@@ -0,0 +1,31 @@
+#ifndef LINETRANSFORM_H_
+#define LINETRANSFORM_H_
+
+#include <string>
+#include <vector>
+
+class Regex;
+
+// Transforms of a run of whole lines, for sorting, deduplicating, filtering and reindenting big files
+// Each one splits the lines among as many threads as the machine has (a few thousand lines apiece at
+// least) and changes lines in place
+
+// Sorts lines in byte order: every thread sorts a run of string_views into the lines, then runs are
+// merged pairwise, a pair per thread, and the lines are moved into their new order. If order isn't
+// null it's given the line every sorted line came from, so whatever is kept per line can be moved too
+void sortLines(std::vector<std::string>& lines, std::vector<size_t>* order = nullptr);
+
+// Keeps the first of every set of equal lines, wherever they are, in order. Lines are hashed on every
+// thread, then each thread keeps a hash set of the lines whose hashes fall in its share of them
+void uniqueLines(std::vector<std::string>& lines);
+
+// Keeps the lines regex finds a (non-empty) match in, or with keepMatches false the lines it doesn't
+void filterLines(std::vector<std::string>& lines, const Regex& regex, bool keepMatches);
+
+// Rewrites the leading whitespace of every line as spaces, width of them per level of indentation,
+// where a level is the greatest common divisor of the lines' indents (tabs go to the next multiple of
+// 8 columns). Lines of nothing but whitespace become empty. Returns the columns a level was; if no
+// line was indented it returns 0 and changes nothing, lines of nothing but whitespace included
+int reindentLines(std::vector<std::string>& lines, int width);
+
+#endif // LINETRANSFORM_H_
@@ -0,0 +1,143 @@
+#include "LzCodec.h"
+#include <string>
+#include <cstring> // for std::memcpy
+#include <cstdint>
+using namespace std;
+
+namespace
+{
+	const size_t MIN_MATCH = 4;
+	const size_t MAX_OFFSET = 65535;
+	const int HASH_BITS = 12;
+
+	uint32_t read32(const char* p)
+	{
+		uint32_t v;
+		memcpy(&v, p, sizeof(v));
+		return v;
+	}
+
+	size_t hash4(const char* p)
+	{
+		return (read32(p) * 2654435761u) >> (32 - HASH_BITS);
+	}
+
+	// A length that doesn't fit in its half of the token goes on in bytes of 255 and one of less
+	void putLength(string& out, size_t length)
+	{
+		for (; length >= 255; length -= 255)
+			out += static_cast<char>(255);
+		out += static_cast<char>(length);
+	}
+
+	size_t getLength(const unsigned char*& in, size_t length)
+	{
+		if (length < 15)
+			return length;
+		unsigned char byte;
+		do
+		{
+			byte = *in++;
+			length += byte;
+		} while (byte == 255);
+		return length;
+	}
+
+	// One token: the literals from anchor to literalEnd, then a copy of matchLength bytes from offset back
+	// (none if matchLength is 0, which only the last token has)
+	void putSequence(string& out, const char* anchor, const char* literalEnd, size_t offset, size_t matchLength)
+	{
+		const size_t literals = literalEnd - anchor;
+		const size_t match = matchLength == 0 ? 0 : matchLength - MIN_MATCH;
+		out += static_cast<char>(((literals < 15 ? literals : 15) << 4) | (match < 15 ? match : 15));
+		if (literals >= 15)
+			putLength(out, literals - 15);
+		out.append(anchor, literals);
+		if (matchLength == 0)
+			return;
+		out += static_cast<char>(offset & 0xff);
+		out += static_cast<char>(offset >> 8);
+		if (match >= 15)
+			putLength(out, match - 15);
+	}
+}
+
+void lzCompress(const char* data, size_t size, std::string& packed)
+{
+	packed.clear();
+	packed.reserve(size / 2 + 16);
+	for (size_t n = size; ; n >>= 7) // the unpacked size, 7 bits at a time with the high bit meaning more
+	{
+		if (n < 0x80)
+		{
+			packed += static_cast<char>(n);
+			break;
+		}
+		packed += static_cast<char>((n & 0x7f) | 0x80);
+	}
+
+	// where each hash of 4 bytes was last seen, plus one so 0 is never
+	uint32_t last[1 << HASH_BITS] = {};
+	const char* const end = data + size;
+	const char* anchor = data;
+	const char* p = data;
+	while (size >= MIN_MATCH && p <= end - MIN_MATCH)
+	{
+		const size_t h = hash4(p);
+		const char* candidate = last[h] == 0 ? nullptr : data + last[h] - 1;
+		last[h] = static_cast<uint32_t>(p - data) + 1;
+		if (candidate == nullptr || static_cast<size_t>(p - candidate) > MAX_OFFSET || read32(candidate) != read32(p))
+		{
+			p += 1 + ((p - anchor) >> 6); // skip faster through text that doesn't repeat
+			continue;
+		}
+		size_t length = MIN_MATCH;
+		while (p + length < end && p[length] == candidate[length])
+			length++;
+		putSequence(packed, anchor, p, p - candidate, length);
+		p += length;
+		anchor = p;
+		if (p <= end - MIN_MATCH && p - 2 > data)
+			last[hash4(p - 2)] = static_cast<uint32_t>(p - 2 - data) + 1;
+	}
+	putSequence(packed, anchor, end, 0, 0);
+}
+
+void lzDecompress(const std::string& packed, std::string& text)
+{
+	const unsigned char* in = reinterpret_cast<const unsigned char*>(packed.data());
+	size_t size = 0;
+	for (int shift = 0; ; shift += 7)
+	{
+		const unsigned char byte = *in++;
+		size |= static_cast<size_t>(byte & 0x7f) << shift;
+		if (byte < 0x80)
+			break;
+	}
+	text.resize(size);
+	char* const begin = &text[0];
+	char* out = begin;
+	char* const end = begin + size;
+	for (;;)
+	{
+		const unsigned char token = *in++;
+		const size_t literals = getLength(in, token >> 4);
+		memcpy(out, in, literals);
+		out += literals;
+		in += literals;
+		if (out == end)
+			break;
+		const size_t offset = in[0] | (in[1] << 8);
+		in += 2;
+		const size_t length = getLength(in, token & 15) + MIN_MATCH;
+		const char* from = out - offset;
+		if (offset >= length)
+			memcpy(out, from, length);
+		else
+		{
+			for (size_t i = 0; i < length; i++) // the copy overlaps what it's making, like a run of one byte
+				out[i] = from[i];
+		}
+		out += length;
+	}
+}
@@ -0,0 +1,19 @@
+#ifndef LZCODEC_H_
+#define LZCODEC_H_
+
+#include <string>
+#include <cstddef>
+
+// A small LZ77 codec in the style of LZ4, for packing blocks of text that are kept around but seldom read
+// The packed form starts with the unpacked size, then alternates runs of literal bytes with copies of
+// at least 4 bytes from up to 64 KB back. It favours speed over ratio: packing looks for matches through
+// a hash of the next 4 bytes and tries only the last position that had the same hash, and unpacking is a
+// loop of copies
+
+// Packs size bytes of data into packed, replacing what was there
+void lzCompress(const char* data, size_t size, std::string& packed);
+
+// Unpacks what lzCompress packed into text, replacing what was there
+void lzDecompress(const std::string& packed, std::string& text);
+
+#endif // LZCODEC_H_
@@ -0,0 +1,178 @@
+#ifndef MEMORYREPORT_H_
+#define MEMORYREPORT_H_
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <ostream>
+#include <cstdio>
+#include <cstddef>
+
+// What a session's memory goes to, counted by each subsystem from its own data structures
+// Byte counts are what the structures hold on to: the objects themselves, their heap blocks and the
+// bookkeeping of the standard containers they live in (node pointers, hash buckets), not what the
+// allocator adds on top
+class MemoryReport {
+public:
+	struct Item
+	{
+		std::string subsystem; // e.g. "text", "undo", "dictionary", "caches"
+		std::string name;
+		size_t value;
+		bool isBytes; // false for plain counts
+	};
+
+	struct Histogram
+	{
+		std::string subsystem;
+		std::string name;
+		std::vector<size_t> buckets; // buckets[i] is how many things had value i
+	};
+
+	void addBytes(const std::string& subsystem, const std::string& name, size_t bytes)
+	{
+		m_items.push_back(Item{ subsystem, name, bytes, true });
+	}
+
+	void addCount(const std::string& subsystem, const std::string& name, size_t count)
+	{
+		m_items.push_back(Item{ subsystem, name, count, false });
+	}
+
+	void addHistogram(const std::string& subsystem, const std::string& name, const std::vector<size_t>& buckets)
+	{
+		m_histograms.push_back(Histogram{ subsystem, name, buckets });
+	}
+
+	// Total bytes of a subsystem, or of everything if subsystem is empty
+	size_t totalBytes(const std::string& subsystem = "") const
+	{
+		size_t total = 0;
+		for (const Item& item : m_items)
+		{
+			if (item.isBytes && (subsystem.empty() || item.subsystem == subsystem))
+				total += item.value;
+		}
+		return total;
+	}
+
+	// A count reported by a subsystem, 0 if it didn't report it
+	size_t count(const std::string& subsystem, const std::string& name) const
+	{
+		for (const Item& item : m_items)
+		{
+			if (!item.isBytes && item.subsystem == subsystem && item.name == name)
+				return item.value;
+		}
+		return 0;
+	}
+
+	const std::vector<Item>& items() const { return m_items; }
+	const std::vector<Histogram>& histograms() const { return m_histograms; }
+
+	// The subsystems in the order they first reported something
+	std::vector<std::string> subsystems() const
+	{
+		std::vector<std::string> names;
+		for (const Item& item : m_items)
+		{
+			bool seen = false;
+			for (const std::string& name : names)
+				seen = seen || name == item.subsystem;
+			if (!seen)
+				names.push_back(item.subsystem);
+		}
+		return names;
+	}
+
+	// One line with the total of every subsystem, e.g. "text 3.2 MB, undo 40 KB, total 65.1 MB"
+	std::string summary() const
+	{
+		std::string line;
+		for (const std::string& subsystem : subsystems())
+			line += subsystem + " " + formatBytes(totalBytes(subsystem)) + ", ";
+		return line + "total " + formatBytes(totalBytes());
+	}
+
+	// Everything, one item per line, grouped by subsystem
+	void print(std::ostream& out) const
+	{
+		for (const std::string& subsystem : subsystems())
+		{
+			out << subsystem << ": " << formatBytes(totalBytes(subsystem)) << std::endl;
+			for (const Item& item : m_items)
+			{
+				if (item.subsystem != subsystem)
+					continue;
+				out << "  " << item.name << ": ";
+				if (item.isBytes)
+					out << formatBytes(item.value) << " (" << item.value << " bytes)" << std::endl;
+				else
+					out << item.value << std::endl;
+			}
+			for (const Histogram& histogram : m_histograms)
+			{
+				if (histogram.subsystem != subsystem)
+					continue;
+				out << "  " << histogram.name << ":";
+				for (size_t i = 0; i < histogram.buckets.size(); i++)
+				{
+					if (histogram.buckets[i] != 0)
+						out << " " << i << ":" << histogram.buckets[i];
+				}
+				out << std::endl;
+			}
+		}
+		out << "total: " << formatBytes(totalBytes()) << std::endl;
+	}
+
+	static std::string formatBytes(size_t bytes)
+	{
+		const char* units[] = { "B", "KB", "MB", "GB" };
+		double value = bytes;
+		int unit = 0;
+		while (value >= 1024 && unit < 3)
+		{
+			value /= 1024;
+			unit++;
+		}
+		char text[32];
+		snprintf(text, sizeof(text), unit == 0 ? "%.0f %s" : "%.1f %s", value, units[unit]);
+		return text;
+	}
+
+	// Heap bytes a string holds on to beyond the std::string object, none while it fits in the object
+	static size_t heapBytes(const std::string& s)
+	{
+		static const size_t kInlineCapacity = std::string().capacity();
+		return s.capacity() > kInlineCapacity ? s.capacity() + 1 : 0;
+	}
+
+	// Bytes of a vector's buffer
+	template<typename T>
+	static size_t heapBytes(const std::vector<T>& v)
+	{
+		return v.capacity() * sizeof(T);
+	}
+
+	// Bytes of the nodes of a std::list holding count elements of type T, two links per node
+	template<typename T>
+	static size_t listNodeBytes(size_t count)
+	{
+		return count * (sizeof(T) + 2 * sizeof(void*));
+	}
+
+	// Bytes of the bucket array and nodes of a std::unordered_map, one link and a cached hash per node
+	template<typename K, typename V>
+	static size_t hashMapBytes(const std::unordered_map<K, V>& map)
+	{
+		return map.bucket_count() * sizeof(void*) + map.size() * (sizeof(std::pair<const K, V>) + sizeof(void*) + sizeof(size_t));
+	}
+
+private:
+	std::vector<Item> m_items;
+	std::vector<Histogram> m_histograms;
+};
+
+#endif // MEMORYREPORT_H_
@@ -0,0 +1,111 @@
+#ifndef MISSPELLINGCOUNTER_H_
+#define MISSPELLINGCOUNTER_H_
+
+// Counts the misspelled words of every line of a snapshot of the text on a thread of its own, and hands
+// the counts to the editor a run of lines at a time through a lock-free queue, so a file read in or a new
+// dictionary doesn't hold up keys while every line is spell checked. The snapshot never changes, so the
+// editor maps the counts onto the text as it is by the changes made since it was taken.
+
+#include "LineStore.h"
+#include "SpellCheck.h"
+#include "SpscQueue.h"
+#include "Trace.h"
+#include <vector>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <pthread.h>
+#include <sched.h>
+
+class MisspellingCounter {
+public:
+	// The misspelled words of rows [first, first + counts.size()) of the snapshot.
+	struct Piece {
+		int first;
+		std::vector<int> counts;
+	};
+
+	MisspellingCounter() : pieces_(kQueueSize), stop_(false), done_(false) { }
+
+	~MisspellingCounter() {
+		stop();
+	}
+
+	// Start counting the lines of text from row first on with spell_check, stopping any count that's
+	// still going on. spell_check has to be safe to use from another thread while the editor uses it.
+	void start(const LineStore::Snapshot& text, int first, SpellCheck* spell_check) {
+		stop();
+		std::shared_ptr<Piece> piece;
+		while (pieces_.pop(piece)) { }	// what's left of the last count
+		stop_ = false;
+		done_ = false;
+		thread_ = std::thread(&MisspellingCounter::countLines, this, text, first, spell_check);
+	}
+
+	// Stop counting and wait for the counter thread to finish. Pieces that were counted are left to take
+	// until the next start().
+	void stop() {
+		if (!thread_.joinable()) return;
+		stop_ = true;
+		thread_.join();
+	}
+
+	// True from start() until stop().
+	bool counting() const {
+		return thread_.joinable();
+	}
+
+	// True once every line has been counted and every piece has been taken.
+	bool finished() const {
+		return done_ && pieces_.empty();
+	}
+
+	// Take the next piece that has been counted, if there is one. Only one thread may take pieces.
+	bool take(Piece& piece) {
+		std::shared_ptr<Piece> next;
+		if (!pieces_.pop(next)) return false;
+		piece = std::move(*next);
+		return true;
+	}
+
+private:
+	// The counter thread: spell check the lines in order and queue up their counts a piece at a time.
+	// It only runs when no other thread wants the CPU, so on a busy or single core machine the keys
+	// and frames still come first.
+	void countLines(LineStore::Snapshot text, int first, SpellCheck* spell_check) {
+		Trace::nameThread("counter");
+		sched_param idle = { };
+		pthread_setschedparam(pthread_self(), SCHED_IDLE, &idle);
+		TRACE_SCOPE("countLines");
+		std::vector<SpellCheck::Position> problems;
+		for (auto line = text.at(first); line != text.end() && !stop_; ) {
+			auto piece = std::make_shared<Piece>();
+			piece->first = line.row();
+			for (int i = 0; i < kPieceLines && line != text.end(); ++i, ++line) {
+				spell_check->spellCheckLine(*line, problems);
+				piece->counts.push_back(static_cast<int>(problems.size()));
+			}
+			if (!push(piece)) return;
+		}
+		if (!stop_) done_ = true;
+	}
+
+	// Queue a piece up, waiting while the editor is behind. Returns false if told to stop first.
+	bool push(const std::shared_ptr<Piece>& piece) {
+		while (!pieces_.push(piece)) {
+			if (stop_) return false;
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+		return true;
+	}
+
+	static const int kQueueSize = 16;
+	static const int kPieceLines = 2048;
+	SpscQueue<std::shared_ptr<Piece>> pieces_;
+	std::atomic<bool> stop_;
+	std::atomic<bool> done_;
+	std::thread thread_;
+};
+
+#endif // MISSPELLINGCOUNTER_H_
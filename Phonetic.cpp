@@ -0,0 +1,185 @@
+#include "Phonetic.h"
+#include <string>
+#include <vector>
+#include <algorithm> // for std::min
+#include <cctype> // for toupper, tolower, isalpha
+using namespace std;
+
+// Whether c is one of the vowels Metaphone cares about
+static bool isVowel(char c)
+{
+	return c == 'A' || c == 'E' || c == 'I' || c == 'O' || c == 'U';
+}
+
+std::string metaphone(const std::string& word)
+{
+	// O(L) where L is the length of the word
+	// Follows the rules of Lawrence Philips' original Metaphone
+
+	// Only keep the letters, in upper case
+	string w;
+	for (char c : word)
+	{
+		if (isalpha(static_cast<unsigned char>(c)))
+			w += toupper(static_cast<unsigned char>(c));
+	}
+	if (w.empty())
+		return "";
+
+	// letter at i, or '\0' when i is off either end of the word
+	auto at = [&w](int i) -> char
+	{
+		if (i < 0 || i >= static_cast<int>(w.size()))
+			return '\0';
+		return w[i];
+	};
+
+	string key;
+	int i = 0;
+	// Initial letter exceptions
+	string start = w.substr(0, 2);
+	if (start == "AE" || start == "GN" || start == "KN" || start == "PN" || start == "WR")
+	{
+		i = 1; // the first letter is silent
+	}
+	else if (w[0] == 'X')
+	{
+		key += 'S';
+		i = 1;
+	}
+	else if (start == "WH")
+	{
+		key += 'W';
+		i = 2;
+	}
+
+	for (; i < static_cast<int>(w.size()) && key.size() < MAX_PHONETIC_KEY; i++)
+	{
+		char c = w[i];
+		if (c != 'C' && i > 0 && at(i - 1) == c) // doubled letters sound like one, except for C
+			continue;
+
+		switch (c)
+		{
+		case 'A': case 'E': case 'I': case 'O': case 'U':
+			if (i == 0) // vowels only count at the start of a word
+				key += c;
+			break;
+		case 'B':
+			if (!(at(i - 1) == 'M' && i == static_cast<int>(w.size()) - 1)) // silent in a final "MB"
+				key += 'B';
+			break;
+		case 'C':
+			if (at(i + 1) == 'I' && at(i + 2) == 'A')
+				key += 'X';
+			else if (at(i + 1) == 'H')
+			{
+				key += (at(i - 1) == 'S') ? 'K' : 'X'; // "SCH" sounds like "SK"
+				i++;
+			}
+			else if (at(i + 1) == 'I' || at(i + 1) == 'E' || at(i + 1) == 'Y')
+			{
+				if (at(i - 1) != 'S') // silent in "SCI", "SCE", "SCY"
+					key += 'S';
+			}
+			else
+				key += 'K';
+			break;
+		case 'D':
+			if (at(i + 1) == 'G' && (at(i + 2) == 'E' || at(i + 2) == 'I' || at(i + 2) == 'Y'))
+			{
+				key += 'J';
+				i++;
+			}
+			else
+				key += 'T';
+			break;
+		case 'G':
+			if (at(i + 1) == 'H' && !(i + 2 >= static_cast<int>(w.size()) || isVowel(at(i + 2))))
+				break; // silent in "GH" unless at the end or before a vowel
+			if (at(i + 1) == 'N' && (i + 2 == static_cast<int>(w.size()) || (at(i + 2) == 'E' && at(i + 3) == 'D' && i + 4 == static_cast<int>(w.size()))))
+				break; // silent in a final "GN" or "GNED"
+			if ((at(i + 1) == 'I' || at(i + 1) == 'E' || at(i + 1) == 'Y') && at(i - 1) != 'G')
+				key += 'J';
+			else
+				key += 'K';
+			break;
+		case 'H':
+			if (isVowel(at(i - 1)) && !isVowel(at(i + 1)))
+				break; // silent after a vowel when no vowel follows
+			if (at(i - 1) == 'C' || at(i - 1) == 'G' || at(i - 1) == 'P' || at(i - 1) == 'S' || at(i - 1) == 'T')
+				break; // part of a two letter sound
+			key += 'H';
+			break;
+		case 'K':
+			if (at(i - 1) != 'C')
+				key += 'K';
+			break;
+		case 'P':
+			key += (at(i + 1) == 'H') ? 'F' : 'P';
+			break;
+		case 'Q':
+			key += 'K';
+			break;
+		case 'S':
+			if (at(i + 1) == 'H' || (at(i + 1) == 'I' && (at(i + 2) == 'O' || at(i + 2) == 'A')))
+				key += 'X';
+			else
+				key += 'S';
+			break;
+		case 'T':
+			if (at(i + 1) == 'I' && (at(i + 2) == 'O' || at(i + 2) == 'A'))
+				key += 'X';
+			else if (at(i + 1) == 'H')
+				key += '0'; // "TH" is written as a zero, for theta
+			else if (!(at(i + 1) == 'C' && at(i + 2) == 'H')) // silent in "TCH"
+				key += 'T';
+			break;
+		case 'V':
+			key += 'F';
+			break;
+		case 'W':
+		case 'Y':
+			if (isVowel(at(i + 1))) // only sounded before a vowel
+				key += c;
+			break;
+		case 'X':
+			key += "KS";
+			break;
+		case 'Z':
+			key += 'S';
+			break;
+		default: // F, J, L, M, N, R sound like themselves
+			key += c;
+			break;
+		}
+	}
+	if (key.size() > MAX_PHONETIC_KEY)
+		key.resize(MAX_PHONETIC_KEY);
+	return key;
+}
+
+int editDistance(std::string_view a, std::string_view b)
+{
+	// O(|a|*|b|) Damerau-Levenshtein (optimal string alignment) distance with three rolling rows
+
+	vector<int> prevprev(b.size() + 1), prev(b.size() + 1), cur(b.size() + 1);
+	for (size_t j = 0; j <= b.size(); j++)
+		prev[j] = j;
+	for (size_t i = 1; i <= a.size(); i++)
+	{
+		cur[0] = i;
+		char ca = tolower(static_cast<unsigned char>(a[i - 1]));
+		for (size_t j = 1; j <= b.size(); j++)
+		{
+			char cb = tolower(static_cast<unsigned char>(b[j - 1]));
+			int cost = (ca == cb) ? 0 : 1;
+			cur[j] = min(min(prev[j] + 1, cur[j - 1] + 1), prev[j - 1] + cost);
+			if (i > 1 && j > 1 && ca == tolower(static_cast<unsigned char>(b[j - 2])) && tolower(static_cast<unsigned char>(a[i - 2])) == cb)
+				cur[j] = min(cur[j], prevprev[j - 2] + 1); // adjacent swap
+		}
+		prevprev.swap(prev);
+		prev.swap(cur);
+	}
+	return prev[b.size()];
+}
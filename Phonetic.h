@@ -0,0 +1,20 @@
+#ifndef PHONETIC_H_
+#define PHONETIC_H_
+
+#include <string>
+#include <string_view>
+
+// Phonetic helpers for finding words that sound like a misspelled word
+
+// Maximum length of a phonetic key, longer keys make buckets smaller but miss more sound-alikes
+constexpr int MAX_PHONETIC_KEY = 6;
+
+// Returns the Metaphone key of a word, e.g. both "phonetic" and "fonetik" give "FNTK"
+// Case insensitive, characters that aren't letters are ignored
+std::string metaphone(const std::string& word);
+
+// Returns the number of single character insertions, deletions, substitutions and
+// adjacent swaps it takes to turn a into b, case insensitive
+int editDistance(std::string_view a, std::string_view b);
+
+#endif // PHONETIC_H_
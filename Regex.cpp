@@ -0,0 +1,424 @@
+#include "Regex.h"
+#include <string>
+#include <vector>
+#include <algorithm> // for std::sort
+#include <cctype> // for isdigit, isalnum, isspace
+using namespace std;
+
+namespace
+{
+	bitset<256> bytesWhere(int (*test)(int))
+	{
+		bitset<256> bytes;
+		for (int b = 0; b < 256; b++)
+			bytes[b] = test(b) != 0;
+		return bytes;
+	}
+
+	int isWordByte(int b)
+	{
+		return isalnum(b) || b == '_';
+	}
+}
+
+bool Regex::compile(const std::string& pattern, std::string& error)
+{
+	// O(P) in the length of the pattern, the NFA has at most a few states per character of it
+	m_nfa.clear();
+	m_anchorStart = false;
+	m_anchorEnd = false;
+	size_t i = 0;
+	size_t end = pattern.size();
+	if (i < end && pattern[i] == '^')
+	{
+		m_anchorStart = true;
+		i++;
+	}
+	// a $ after an odd run of backslashes is escaped, after an even one (e.g., \\$) it's the anchor
+	size_t backslashes = 0;
+	while (end > i + 1 + backslashes && pattern[end - 2 - backslashes] == '\\')
+		backslashes++;
+	if (end > i && pattern[end - 1] == '$' && backslashes % 2 == 0)
+	{
+		m_anchorEnd = true;
+		end--;
+	}
+	const string body = pattern.substr(i, end - i);
+	size_t pos = 0;
+	Fragment frag;
+	if (!parseAlternation(body, pos, frag, error))
+		return false;
+	if (pos != body.size()) // only an unmatched ) stops the parser early
+	{
+		error = "unmatched )";
+		return false;
+	}
+	patch(frag, addState(MATCH));
+	m_start = frag.start;
+	return true;
+}
+
+int Regex::addState(Kind kind, int out, int out1)
+{
+	State state;
+	state.kind = kind;
+	state.out = out;
+	state.out1 = out1;
+	m_nfa.push_back(state);
+	return m_nfa.size() - 1;
+}
+
+Regex::Fragment Regex::bytesFragment(const std::bitset<256>& bytes)
+{
+	Fragment frag;
+	frag.start = addState(BYTES);
+	m_nfa[frag.start].bytes = bytes;
+	frag.dangling.push_back(make_pair(frag.start, 0));
+	return frag;
+}
+
+void Regex::patch(const Fragment& frag, int target)
+{
+	for (const auto& out : frag.dangling)
+	{
+		if (out.second == 0)
+			m_nfa[out.first].out = target;
+		else
+			m_nfa[out.first].out1 = target;
+	}
+}
+
+bool Regex::parseAlternation(const std::string& p, size_t& i, Fragment& frag, std::string& error)
+{
+	if (!parseConcatenation(p, i, frag, error))
+		return false;
+	while (i < p.size() && p[i] == '|')
+	{
+		i++;
+		Fragment other;
+		if (!parseConcatenation(p, i, other, error))
+			return false;
+		Fragment both;
+		both.start = addState(SPLIT, frag.start, other.start);
+		both.dangling = frag.dangling;
+		both.dangling.insert(both.dangling.end(), other.dangling.begin(), other.dangling.end());
+		frag = both;
+	}
+	return true;
+}
+
+bool Regex::parseConcatenation(const std::string& p, size_t& i, Fragment& frag, std::string& error)
+{
+	// an empty concatenation matches the empty string
+	frag.start = addState(SPLIT);
+	frag.dangling.assign(1, make_pair(frag.start, 0));
+	while (i < p.size() && p[i] != '|' && p[i] != ')')
+	{
+		Fragment next;
+		if (!parseRepeat(p, i, next, error))
+			return false;
+		patch(frag, next.start);
+		frag.dangling = next.dangling;
+	}
+	return true;
+}
+
+bool Regex::parseRepeat(const std::string& p, size_t& i, Fragment& frag, std::string& error)
+{
+	if (!parseAtom(p, i, frag, error))
+		return false;
+	while (i < p.size() && (p[i] == '*' || p[i] == '+' || p[i] == '?'))
+	{
+		const int split = addState(SPLIT, frag.start);
+		Fragment repeated;
+		if (p[i] == '*') // split -> atom -> back to split, or on
+		{
+			patch(frag, split);
+			repeated.start = split;
+		}
+		else if (p[i] == '+') // atom -> split -> back to atom, or on
+		{
+			patch(frag, split);
+			repeated.start = frag.start;
+		}
+		else // split -> atom, or skip it
+		{
+			repeated.start = split;
+			repeated.dangling = frag.dangling;
+		}
+		repeated.dangling.push_back(make_pair(split, 1));
+		frag = repeated;
+		i++;
+	}
+	return true;
+}
+
+bool Regex::parseAtom(const std::string& p, size_t& i, Fragment& frag, std::string& error)
+{
+	const char ch = p[i++];
+	bitset<256> bytes;
+	switch (ch)
+	{
+	case '(':
+		if (!parseAlternation(p, i, frag, error))
+			return false;
+		if (i >= p.size() || p[i] != ')')
+		{
+			error = "missing )";
+			return false;
+		}
+		i++;
+		return true;
+	case '[':
+		if (!parseClass(p, i, bytes, error))
+			return false;
+		break;
+	case '.':
+		bytes.set();
+		break;
+	case '*':
+	case '+':
+	case '?':
+		error = string("nothing to repeat before ") + ch;
+		return false;
+	case '^':
+	case '$':
+		error = string(1, ch) + " only works at the start or end of the pattern";
+		return false;
+	case '\\':
+		if (i >= p.size())
+		{
+			error = "\\ at the end of the pattern";
+			return false;
+		}
+		switch (p[i++])
+		{
+		case 'd': bytes = bytesWhere(isdigit); break;
+		case 'D': bytes = ~bytesWhere(isdigit); break;
+		case 'w': bytes = bytesWhere(isWordByte); break;
+		case 'W': bytes = ~bytesWhere(isWordByte); break;
+		case 's': bytes = bytesWhere(isspace); break;
+		case 'S': bytes = ~bytesWhere(isspace); break;
+		case 't': bytes['\t'] = true; break;
+		default: bytes[static_cast<unsigned char>(p[i - 1])] = true; break;
+		}
+		break;
+	default:
+		bytes[static_cast<unsigned char>(ch)] = true;
+		break;
+	}
+	frag = bytesFragment(bytes);
+	return true;
+}
+
+bool Regex::parseClass(const std::string& p, size_t& i, std::bitset<256>& bytes, std::string& error)
+{
+	// i is just past the [
+	bool negate = false;
+	if (i < p.size() && p[i] == '^')
+	{
+		negate = true;
+		i++;
+	}
+	bool first = true;
+	while (i < p.size() && (p[i] != ']' || first))
+	{
+		first = false;
+		unsigned char low = p[i++];
+		if (low == '\\' && i < p.size())
+		{
+			const char escape = p[i++];
+			if (escape == 'd' || escape == 'w' || escape == 's')
+			{
+				bytes |= escape == 'd' ? bytesWhere(isdigit) : escape == 'w' ? bytesWhere(isWordByte) : bytesWhere(isspace);
+				continue;
+			}
+			low = escape == 't' ? '\t' : escape;
+		}
+		unsigned char high = low;
+		if (i + 1 < p.size() && p[i] == '-' && p[i + 1] != ']')
+		{
+			high = p[i + 1];
+			i += 2;
+			if (high < low)
+			{
+				error = "backwards range in [ ]";
+				return false;
+			}
+		}
+		for (int b = low; b <= high; b++)
+			bytes[b] = true;
+	}
+	if (i >= p.size())
+	{
+		error = "missing ]";
+		return false;
+	}
+	i++; // the ]
+	if (negate)
+		bytes.flip();
+	return true;
+}
+
+void Regex::closure(int state, std::vector<int>& set, std::vector<bool>& seen) const
+{
+	// iterative, a long chain of empty steps can't overflow the stack
+	vector<int> pending(1, state);
+	while (!pending.empty())
+	{
+		const int s = pending.back();
+		pending.pop_back();
+		if (s < 0 || seen[s])
+			continue;
+		seen[s] = true;
+		if (m_nfa[s].kind == SPLIT)
+		{
+			pending.push_back(m_nfa[s].out1);
+			pending.push_back(m_nfa[s].out);
+		}
+		else
+			set.push_back(s);
+	}
+}
+
+Regex::Matcher::Matcher(const Regex& regex)
+	: m_regex(regex), m_startState(-1), m_resets(0)
+{
+	const int start = startState();
+	for (int b = 0; b < 256; b++)
+		m_firstBytes[b] = step(start, b) != DEAD;
+}
+
+int Regex::Matcher::addState(std::vector<int>& nfa)
+{
+	sort(nfa.begin(), nfa.end());
+	auto found = m_ids.find(nfa);
+	if (found != m_ids.end())
+		return found->second;
+	if (m_states.size() >= MAX_STATES) // start over rather than grow without bound
+	{
+		m_states.clear();
+		m_ids.clear();
+		m_startState = -1;
+		m_resets++;
+	}
+	DState state;
+	state.nfa = nfa;
+	state.accepting = false;
+	for (int s : nfa)
+		state.accepting = state.accepting || m_regex.m_nfa[s].kind == MATCH;
+	fill(state.next, state.next + 256, UNKNOWN);
+	m_states.push_back(state);
+	m_ids[nfa] = m_states.size() - 1;
+	return m_states.size() - 1;
+}
+
+int Regex::Matcher::startState()
+{
+	if (m_startState < 0)
+	{
+		vector<int> nfa;
+		vector<bool> seen(m_regex.m_nfa.size(), false);
+		m_regex.closure(m_regex.m_start, nfa, seen);
+		m_startState = addState(nfa);
+	}
+	return m_startState;
+}
+
+int Regex::Matcher::step(int state, unsigned char byte)
+{
+	// O(1) once the step has been taken before
+	const int known = m_states[state].next[byte];
+	if (known != UNKNOWN)
+		return known;
+	vector<int> nfa;
+	vector<bool> seen(m_regex.m_nfa.size(), false);
+	for (int s : m_states[state].nfa)
+	{
+		const State& from = m_regex.m_nfa[s];
+		if (from.kind == BYTES && from.bytes[byte])
+			m_regex.closure(from.out, nfa, seen);
+	}
+	if (nfa.empty())
+	{
+		m_states[state].next[byte] = DEAD;
+		return DEAD;
+	}
+	const unsigned resets = m_resets;
+	const int next = addState(nfa);
+	if (m_resets == resets) // else state went away with the rest of the DFA
+		m_states[state].next[byte] = next;
+	return next;
+}
+
+size_t Regex::Matcher::longestAt(const std::string& line, size_t start)
+{
+	size_t end = string::npos;
+	int state = startState();
+	for (size_t i = start; ; i++)
+	{
+		if (m_states[state].accepting && (!m_regex.m_anchorEnd || i == line.size()))
+			end = i;
+		if (i == line.size())
+			break;
+		state = step(state, line[i]);
+		if (state == DEAD)
+			break;
+	}
+	return end;
+}
+
+bool Regex::Matcher::find(const std::string& line, size_t from, size_t& start, size_t& end)
+{
+	// O(N*M) worst case in the length of the line and the longest attempt, usually close to O(N) since
+	// most attempts die after a byte or two and bytes no match can start with are skipped outright
+	const size_t last = m_regex.m_anchorStart ? 1 : line.size(); // one past the last place a match can start
+	for (size_t i = from; i < last && i < line.size(); i++)
+	{
+		if (!m_firstBytes[static_cast<unsigned char>(line[i])])
+			continue;
+		const size_t matchEnd = longestAt(line, i);
+		if (matchEnd != string::npos && matchEnd > i)
+		{
+			start = i;
+			end = matchEnd;
+			return true;
+		}
+	}
+	return false;
+}
+
+int Regex::Matcher::replace(const std::string& line, const std::string& replacement, std::string& out)
+{
+	int count = 0;
+	size_t pos = 0;
+	size_t start, end;
+	string result;
+	while (find(line, pos, start, end))
+	{
+		result.append(line, pos, start - pos);
+		for (size_t i = 0; i < replacement.size(); i++)
+		{
+			if (replacement[i] == '$' && i + 1 < replacement.size() && replacement[i + 1] == '0')
+			{
+				result.append(line, start, end - start);
+				i++;
+			}
+			else if (replacement[i] == '$' && i + 1 < replacement.size() && replacement[i + 1] == '$')
+			{
+				result += '$';
+				i++;
+			}
+			else
+				result += replacement[i];
+		}
+		pos = end;
+		count++;
+	}
+	if (count > 0)
+	{
+		result.append(line, pos, string::npos);
+		out = move(result);
+	}
+	return count;
+}
@@ -0,0 +1,95 @@
+#ifndef REGEX_H_
+#define REGEX_H_
+
+#include <string>
+#include <vector>
+#include <map>
+#include <bitset>
+
+// A regular expression for matching within a line of text
+// Supports literals, '.', classes like [a-z] and [^0-9], the escapes \d \w \s (and their capitals for
+// "anything but"), grouping with ( ), alternation with |, the repeats * + ?, and ^ and $ at the very
+// start and end of the pattern. A match is the leftmost one, and the longest one starting there
+// The pattern compiles to an NFA once; each Matcher turns it into a DFA as it goes, so matching costs
+// one table lookup per byte once the states it needs have been built
+class Regex {
+public:
+	Regex() : m_start(-1), m_anchorStart(false), m_anchorEnd(false) {}
+
+	// Returns false and says what's wrong in error if pattern isn't a regular expression this supports
+	bool compile(const std::string& pattern, std::string& error);
+
+	// Finds matches with a DFA of its own, so every thread that matches needs its own Matcher
+	class Matcher
+	{
+	public:
+		explicit Matcher(const Regex& regex);
+
+		// Finds the first non-empty match in line at or after from, returns false if there's none
+		bool find(const std::string& line, size_t from, size_t& start, size_t& end);
+
+		// Replaces every match in line with replacement, where $0 stands for the match and $$ for a $
+		// Returns the number of matches, out is only set if there were any
+		int replace(const std::string& line, const std::string& replacement, std::string& out);
+
+	private:
+		struct DState
+		{
+			std::vector<int> nfa; // the NFA states it stands for
+			bool accepting;
+			int next[256]; // UNKNOWN until the step is worked out, DEAD if nothing can match after it
+		};
+
+		enum { UNKNOWN = -2, DEAD = -1 };
+		static const size_t MAX_STATES = 4096; // the DFA starts over once it gets this big
+
+		const Regex& m_regex;
+		std::vector<DState> m_states;
+		std::map<std::vector<int>, int> m_ids;
+		int m_startState;
+		unsigned m_resets; // how many times the DFA started over
+		std::bitset<256> m_firstBytes; // bytes a match can start with
+
+		int addState(std::vector<int>& nfa);
+		int startState();
+		int step(int state, unsigned char byte);
+		// The end of the longest match starting at start, or npos
+		size_t longestAt(const std::string& line, size_t start);
+	};
+
+private:
+	enum Kind { BYTES, SPLIT, MATCH };
+	struct State
+	{
+		Kind kind;
+		std::bitset<256> bytes; // for BYTES, the bytes that move on to out
+		int out;
+		int out1; // for SPLIT, the other way to go
+	};
+	// A piece of the NFA under construction: where it starts and the outs that still have to be hooked up
+	struct Fragment
+	{
+		int start;
+		std::vector<std::pair<int, int>> dangling; // (state, 0 for out or 1 for out1)
+	};
+
+	std::vector<State> m_nfa;
+	int m_start;
+	bool m_anchorStart; // ^, a match has to start at the start of the line
+	bool m_anchorEnd; // $, a match has to end at the end of the line
+
+	// The parser, one function per level of precedence
+	bool parseAlternation(const std::string& p, size_t& i, Fragment& frag, std::string& error);
+	bool parseConcatenation(const std::string& p, size_t& i, Fragment& frag, std::string& error);
+	bool parseRepeat(const std::string& p, size_t& i, Fragment& frag, std::string& error);
+	bool parseAtom(const std::string& p, size_t& i, Fragment& frag, std::string& error);
+	bool parseClass(const std::string& p, size_t& i, std::bitset<256>& bytes, std::string& error);
+
+	int addState(Kind kind, int out = -1, int out1 = -1);
+	Fragment bytesFragment(const std::bitset<256>& bytes);
+	void patch(const Fragment& frag, int target);
+	// Adds state and everything it reaches without reading a byte to set
+	void closure(int state, std::vector<int>& set, std::vector<bool>& seen) const;
+};
+
+#endif // REGEX_H_
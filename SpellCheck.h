@@ -3,6 +3,9 @@
 
 #include <string>
 #include <vector>
+#include <cctype>
+
+class MemoryReport;
 
 class SpellCheck {
 public:
@@ -14,9 +17,28 @@ public:
 	SpellCheck() { }
 	virtual ~SpellCheck() { }
 
+	// Checks if ch is part of a word, as spell checking splits lines into words: letters and the
+	// apostrophe. Anything that looks for words the spell checker would see uses this. The cast keeps
+	// bytes over 127 from reaching isalpha() as negative numbers.
+	static bool isWordChar(char ch) {
+		return isalpha(static_cast<unsigned char>(ch)) || ch == '\'';
+	}
+
+	// A new spell checker that uses the same dictionary as this one, including the ones either of them
+	// loads after, with caches of its own. The dictionary is freed along with the last of them.
+	virtual SpellCheck* shareDictionary() const = 0;
 	virtual bool load(std::string dictionaryFile) = 0;
+	virtual bool loadAsync(std::string dictionaryFile) = 0;
+	virtual bool isLoading() const = 0;
+	virtual int generation() const = 0;
 	virtual bool spellCheck(std::string word, int maxSuggestions, std::vector<std::string>& suggestions) = 0;
 	virtual void spellCheckLine(const std::string& line, std::vector<Position>& problems) = 0;
+	// Like spellCheckLine(), but only checks the words that overlap columns [startCol, endCol) of line,
+	// whole words included. Positions are columns of line.
+	virtual void spellCheckRange(const std::string& line, int startCol, int endCol, std::vector<Position>& problems) = 0;
+	virtual void complete(const std::string& prefix, int k, std::vector<std::string>& completions) = 0;
+	// Adds what the dictionary and caches take up to report, under "dictionary" and "caches".
+	virtual void reportMemory(MemoryReport& report) const = 0;
 
 private:
 
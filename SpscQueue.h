@@ -0,0 +1,64 @@
+#ifndef SPSCQUEUE_H_
+#define SPSCQUEUE_H_
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+
+// A bounded lock-free ring buffer for exactly one producer thread and one consumer thread
+// Only the producer writes m_tail and only the consumer writes m_head; each publishes its side with a
+// release store and reads the other side with an acquire load, so neither side ever blocks the other
+template<typename T>
+class SpscQueue {
+public:
+	// capacity is rounded up to a power of two so positions wrap with a mask
+	explicit SpscQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size *= 2;
+		m_slots.resize(size);
+		m_mask = size - 1;
+		m_head = 0;
+		m_tail = 0;
+	}
+	SpscQueue(const SpscQueue&) = delete;
+	SpscQueue& operator=(const SpscQueue&) = delete;
+
+	// Producer only, returns false if the queue is full
+	bool push(const T& item)
+	{
+		const size_t tail = m_tail.load(std::memory_order_relaxed);
+		if (tail - m_head.load(std::memory_order_acquire) == m_slots.size())
+			return false;
+		m_slots[tail & m_mask] = item;
+		m_tail.store(tail + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Consumer only, returns false if the queue is empty
+	bool pop(T& item)
+	{
+		const size_t head = m_head.load(std::memory_order_relaxed);
+		if (head == m_tail.load(std::memory_order_acquire))
+			return false;
+		item = m_slots[head & m_mask];
+		m_head.store(head + 1, std::memory_order_release);
+		return true;
+	}
+
+	bool empty() const
+	{
+		return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire);
+	}
+
+	size_t capacity() const { return m_slots.size(); }
+
+private:
+	std::vector<T> m_slots;
+	size_t m_mask;
+	alignas(64) std::atomic<size_t> m_head; // next position to pop, on its own cache line
+	alignas(64) std::atomic<size_t> m_tail; // next position to push
+};
+
+#endif // SPSCQUEUE_H_
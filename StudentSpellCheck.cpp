@@ -1,8 +1,13 @@
 #include "StudentSpellCheck.h"
+#include "Trace.h"
 #include <string>
 #include <vector>
 #include <fstream> // for file streams
 #include <iostream> // for cerr
+#include <thread> // for std::thread
+#include <mutex> // for std::lock_guard
+#include <algorithm> // for std::find
+#include <cctype> // for tolower
 using namespace std;
 
 SpellCheck* createSpellCheck()
@@ -12,29 +17,35 @@ SpellCheck* createSpellCheck()
 
 StudentSpellCheck::~StudentSpellCheck()
 {
-	clearDictionary(); // Need to clear dictionary when destructing class
+	// the dictionary goes when the last spell checker sharing it lets go of m_shared
+}
+
+StudentSpellCheck::Shared::~Shared()
+{
+	stopLoader(); // a worker thread can't outlive what it publishes to
+	publish(nullptr); // Need to clear dictionary when destructing class
+}
+
+SpellCheck* StudentSpellCheck::shareDictionary() const
+{
+	return new StudentSpellCheck(m_shared);
 }
 
 bool StudentSpellCheck::load(std::string dictionaryFile)
 {
 	//  O(N) time where N is the number of lines in the dictionary
-	// Need to clear present dictionary if there is one
-
-	ifstream infile(dictionaryFile);
-	if (!infile) // if file doesn't exist/couldn't be loaded
-	{
-		return false;
-	}
+	// The present dictionary stays in use until the new one is completely built
 
-	clearDictionary(); // clear dictionary
-	root = newNode(); // after clearing a dictionary, add new root node
+	TRACE_SCOPE("StudentSpellCheck::load");
+	m_shared->stopLoader(); // a synchronous load wins over a background one
 
-	// for every line in the dictionaryFile, insert the line into the dictionary
-	string s;
-	while (getline(infile, s))
+	Dictionary* dict = new Dictionary;
+	if (!dict->build(dictionaryFile)) // if file doesn't exist/couldn't be loaded
 	{
-		insertWord(s);
+		delete dict;
+		return false;
 	}
+	m_shared->publish(dict);
 
 	// For testing purposes
 	/*
@@ -53,14 +64,121 @@ bool StudentSpellCheck::load(std::string dictionaryFile)
 	return true;
 }
 
+bool StudentSpellCheck::loadAsync(std::string dictionaryFile)
+{
+	// Builds the new dictionary on a worker thread so whoever called this can keep going
+	// Readers keep using the old dictionary until the new one is published
+	// Returns false right away if the file can't be opened
+
+	{
+		ifstream infile(dictionaryFile);
+		if (!infile) // if file doesn't exist/couldn't be loaded
+		{
+			return false;
+		}
+	}
+
+	Shared* shared = m_shared.get(); // the worker can't outlive it, ~Shared() stops the worker first
+	shared->stopLoader(); // only the latest requested dictionary matters
+	shared->cancelLoad = false;
+	shared->loading = true;
+	shared->loader = thread([shared, dictionaryFile]()
+	{
+		Trace::nameThread("dictionary loader");
+		TRACE_SCOPE("StudentSpellCheck::loadAsync");
+		Dictionary* dict = new Dictionary;
+		if (dict->build(dictionaryFile, &shared->cancelLoad))
+			shared->publish(dict);
+		else
+			delete dict;
+		shared->loading = false;
+	});
+	return true;
+}
+
+bool StudentSpellCheck::isLoading() const
+{
+	return m_shared->loading;
+}
+
+int StudentSpellCheck::generation() const
+{
+	return m_shared->generation;
+}
+
+void StudentSpellCheck::Shared::publish(Dictionary* newDict)
+{
+	lock_guard<mutex> lock(publishMutex);
+	Dictionary* old = dict.exchange(newDict);
+	if (newDict != nullptr)
+		generation++;
+	if (old == nullptr)
+		return;
+	waitForReaders(); // after this nobody can be holding old anymore
+	delete old;
+}
+
+void StudentSpellCheck::Shared::waitForReaders()
+{
+	// A reader might have read the epoch right before it was flipped and only registered afterwards,
+	// so the epoch is flipped twice, waiting for the readers of each previous epoch to leave
+	for (int phase = 0; phase < 2; phase++)
+	{
+		unsigned previous = epoch.fetch_add(1) & 1;
+		while (readers[previous].load() != 0)
+		{
+			this_thread::yield();
+		}
+	}
+}
+
+void StudentSpellCheck::Shared::stopLoader()
+{
+	if (!loader.joinable())
+		return;
+	cancelLoad = true;
+	loader.join();
+	cancelLoad = false;
+}
+
 bool StudentSpellCheck::spellCheck(std::string word, int max_suggestions, std::vector<std::string>& suggestions)
+{
+	// return true if the word is in the dictionary
+	// return false and push suggestions onto the vector
+	// Results are cached per normalized word and dictionary generation, so asking about the same word
+	// again (like when the cursor moves around on it) costs one hash lookup
+
+	string normalized = word;
+	for (char& c : normalized)
+		c = tolower(static_cast<unsigned char>(c));
+
+	const int dictGeneration = generation();
+	bool correct;
+	vector<string> cached;
+	if (m_cache.get(normalized, dictGeneration, max_suggestions, correct, cached))
+	{
+		if (correct)
+			return true;
+		suggestions = cached;
+		return false;
+	}
+
+	correct = computeSuggestions(normalized, max_suggestions, suggestions);
+	m_cache.put(normalized, dictGeneration, max_suggestions, correct, correct ? vector<string>() : suggestions);
+	return correct;
+}
+
+bool StudentSpellCheck::computeSuggestions(const std::string& word, int max_suggestions, std::vector<std::string>& suggestions)
 {
 	// return true if the word is in the dictionary
 	// return false and push suggestions onto the vector
 	// xole -> aole bole...xolz xol'
 	// O(L^2 + maxSuggestions) where L is the length of the word being searched for
+	// plus one phonetic index lookup and a bounded re-ranking of the sound-alike words
 
-	if (search(word)) // if word is in the dictionary, return true
+	ReadGuard guard(*this); // one dictionary for the whole word
+	const Dictionary* dict = guard.get();
+	if (search(dict, word)) // if word is in the dictionary, return true
 	{
 		return true;
 	}
@@ -76,40 +194,60 @@ bool StudentSpellCheck::spellCheck(std::string word, int max_suggestions, std::v
 			{
 				return false; // return false as the original word is not in the dictionary
 			}
-			s[i] = getLetter(j);
-			if (search(s))
+			s[i] = Dictionary::getLetter(j);
+			if (search(dict, s))
 			{
 				suggestions.push_back(s);
 			}
 		}
 	}
+
+	// substitutions can't find words that only sound alike ("fonetik" -> "phonetic"),
+	// so fill up the rest with words that have the same phonetic key
+	vector<string> soundAlikes;
+	soundsLike(dict, word, max_suggestions, soundAlikes);
+	for (const string& s : soundAlikes)
+	{
+		if (suggestions.size() == max_suggestions)
+			break;
+		if (find(suggestions.begin(), suggestions.end(), s) == suggestions.end()) // don't suggest the same word twice
+			suggestions.push_back(s);
+	}
 	return false; // return false as the original word is not in the dictionary
 }
 
+void StudentSpellCheck::complete(const std::string& prefix, int k, std::vector<std::string>& completions)
+{
+	// returns up to k words that start with prefix, best first
+	// bounded by the length of the prefix and k, never by the size of the dictionary
+
+	ReadGuard guard(*this);
+	completions.clear();
+	if (guard.get() != nullptr)
+		guard.get()->complete(prefix, k, completions);
+}
+
 void StudentSpellCheck::spellCheckLine(const std::string& line, std::vector<SpellCheck::Position>& problems)
 {
 	// spell checks line of full text
 	// puts start and end (inclusive) of a misspelled word onto problems vector
 	// O(S+W*L) where S is the length of the line passed in, W is the number of words in the line, L is the max length of a word
 
-	problems.clear(); // clear vectors
+	spellCheckRange(line, 0, line.size(), problems);
+
+	// Slow but readable solution O(S^2 + L*W)
+	/*
 	if (line.empty()) // if the line is empty, do nothing
 		return;
 
 	string word = ""; // stores which word to currently check
-	int start = 0;
-	int end = 0;
 
-	// loop through the line, checking each word to check
-	// goes through the line once so S
-	// searching for the ALL the words in the dictionary is num of words * bound for a word (W*L)
-	// time compleity is O(S+W*L)
+	// loop through the line, finding each word to check
 	for (int i = 0; i < line.size(); i++)
 	{
-		if (isalpha(line[i]) || line[i] == '\'') // if the current character is a letter or an apostrophe
+		if (isWordChar(line[i])) // if the current character is a letter or an apostrophe
 		{
-			end = i; // the end of the current word is the last letter of the word
-			word = word + line[i]; // add letter to word
+			word = word + line[i];
 		}
 		else
 		{
@@ -117,58 +255,92 @@ void StudentSpellCheck::spellCheckLine(const std::string& line, std::vector<Spel
 			{
 				if (!search(word)) // if the word is NOT in the dictionary, add position to the vector
 				{
+					int start = line.find(word); // find the start position of a word
+					int end = start + word.length() - 1; // the end position of a word
 					addToProblemVector(problems, start, end);
 				}
 				word = ""; // reset word
 			}
-			start = i + 1; // the start of the next word is the next letter or apostrophe, this will always ensure that the start will be on an index with a letter or an apostrophe
 		}
 	}
-	// to account for the last word in the line
 	if (!word.empty()) // if word is not empty
 	{
 		if (!search(word)) // if the word is NOT in the dictionary, add position to the vector
 		{
+			int start = line.find(word); // find the start position of a word
+			int end = start + word.length() - 1; // the end position of a word
 			addToProblemVector(problems, start, end);
 		}
 	}
+	*/
+}
 
-	// Slow but readable solution O(S^2 + L*W)
-	/*
-	if (line.empty()) // if the line is empty, do nothing
+void StudentSpellCheck::spellCheckRange(const std::string& line, int startCol, int endCol, std::vector<SpellCheck::Position>& problems)
+{
+	// spell checks the words of line that overlap columns [startCol, endCol)
+	// puts start and end (inclusive) of a misspelled word onto problems vector
+	// O(R+W*L) where R is the length of the range plus the words cut off at its ends, W is the number of words in it, L is the max length of a word
+
+	problems.clear(); // clear vectors
+	if (startCol < 0)
+		startCol = 0;
+	if (endCol > static_cast<int>(line.size()))
+		endCol = line.size();
+	if (startCol >= endCol) // if the range is empty, do nothing
 		return;
 
+	// widen the range to whole words, so a word cut off by either end is checked as a whole
+	while (startCol > 0 && isWordChar(line[startCol - 1]))
+		startCol--;
+	while (endCol < line.size() && isWordChar(line[endCol]))
+		endCol++;
+
+	ReadGuard guard(*this); // one dictionary for the whole range
+	const Dictionary* dict = guard.get();
 	string word = ""; // stores which word to currently check
+	int start = startCol;
+	int end = startCol;
 
-	// loop through the line, finding each word to check
-	for (int i = 0; i < line.size(); i++)
+	// loop through the range, checking each word to check
+	// goes through the range once so R
+	// searching for the ALL the words in the dictionary is num of words * bound for a word (W*L)
+	// time compleity is O(R+W*L)
+	for (int i = startCol; i < endCol; i++)
 	{
-		if (isalpha(line[i]) || line[i] == '\'') // if the current character is a letter or an apostrophe
+		if (isWordChar(line[i])) // if the current character is a letter or an apostrophe
 		{
-			word = word + line[i];
+			end = i; // the end of the current word is the last letter of the word
+			word = word + line[i]; // add letter to word
 		}
 		else
 		{
 			if (!word.empty()) // if the word is not empty
 			{
-				if (!search(word)) // if the word is NOT in the dictionary, add position to the vector
+				if (!search(dict, word)) // if the word is NOT in the dictionary, add position to the vector
 				{
-					int start = line.find(word); // find the start position of a word
-					int end = start + word.length() - 1; // the end position of a word
 					addToProblemVector(problems, start, end);
 				}
 				word = ""; // reset word
 			}
+			start = i + 1; // the start of the next word is the next letter or apostrophe, this will always ensure that the start will be on an index with a letter or an apostrophe
 		}
 	}
+	// to account for the last word in the range
 	if (!word.empty()) // if word is not empty
 	{
-		if (!search(word)) // if the word is NOT in the dictionary, add position to the vector
+		if (!search(dict, word)) // if the word is NOT in the dictionary, add position to the vector
 		{
-			int start = line.find(word); // find the start position of a word
-			int end = start + word.length() - 1; // the end position of a word
 			addToProblemVector(problems, start, end);
 		}
 	}
-	*/
+}
+
+void StudentSpellCheck::reportMemory(MemoryReport& report) const
+{
+	{
+		ReadGuard guard(*this);
+		if (guard.get() != nullptr)
+			guard.get()->reportMemory(report);
+	}
+	m_cache.reportMemory(report);
 }
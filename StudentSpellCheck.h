@@ -2,137 +2,131 @@
 #define STUDENTSPELLCHECK_H_
 
 #include "SpellCheck.h"
+#include "Dictionary.h"
+#include "SuggestionCache.h"
 
 #include <string>
 #include <vector>
 #include <fstream> // for filestream
+#include <atomic> // for std::atomic
+#include <thread> // for std::thread
+#include <mutex> // for std::mutex
+#include <memory> // for std::shared_ptr
 
 // File constants
-constexpr int NUM_CHARS = 27; // number of children a trie node should have, 27 for all letters plus an apostrophe
+constexpr size_t SUGGESTION_CACHE_SIZE = 256; // number of words whose spell check results are remembered
 
 class StudentSpellCheck : public SpellCheck {
 public:
     StudentSpellCheck()
+		: m_shared(std::make_shared<Shared>()), m_cache(SUGGESTION_CACHE_SIZE)
 	{
-		root = nullptr; // root doesn't start off with anything
 	}
 	virtual ~StudentSpellCheck();
+	SpellCheck* shareDictionary() const;
 	bool load(std::string dict_file);
+	bool loadAsync(std::string dict_file);
+	bool isLoading() const;
+	int generation() const;
 	bool spellCheck(std::string word, int maxSuggestions, std::vector<std::string>& suggestions);
 	void spellCheckLine(const std::string& line, std::vector<Position>& problems);
+	void spellCheckRange(const std::string& line, int startCol, int endCol, std::vector<Position>& problems);
+	void complete(const std::string& prefix, int k, std::vector<std::string>& completions);
+	void reportMemory(MemoryReport& report) const;
 
 private:
-	// Trie Implementation
-	struct TrieNode
+	// The dictionary and the loading of new ones, which every spell checker shareDictionary() made from
+	// this one (or this one was made from) uses; it goes away with the last of them
+	struct Shared
 	{
-		bool isDefined;
-		TrieNode* children[NUM_CHARS];
-	};
-	TrieNode* root;
-
-	// Private helper functions
-
-	TrieNode* newNode() // returns a TrieNode ptr with initiliazed variables
-	{
-		TrieNode* tmp = new TrieNode;
-		tmp->isDefined = false;
-		for (int i = 0; i < NUM_CHARS; i++)
+		Shared()
 		{
-			tmp->children[i] = nullptr;
+			dict = nullptr; // doesn't start off with a dictionary
+			epoch = 0;
+			readers[0] = 0;
+			readers[1] = 0;
+			generation = 0;
+			loading = false;
+			cancelLoad = false;
 		}
-		return tmp;
-	}
+		~Shared();
 
-	// getIndex of a character
-	// 0 to 25 for letters A to Z, 26 for apostrophe
-	// Case insensitive
-	// returns -1 if a character is not a valid letter
-	int getIndex(char c)
-	{
-		if (c >= 'a' && c <= 'z')
-			return c - 'a';
-		if (c >= 'A' && c <= 'Z')
-			return c - 'A';
-		if (c == '\'')
-		{
-			return 26;
-		}
-		return -1; // if character is not a letter or an apostrophe
-	}
+		// The currently published dictionary, readers only ever see a fully built one
+		std::atomic<Dictionary*> dict;
 
-	// returns a lowercase letter given an index
-	// 0 to 25 returns 'a' to 'z'
-	char getLetter(int index)
-	{
-		if (index == 26)
-			return '\'';
-		return index + 'a';
-	}
+		// Epoch based reclamation of replaced dictionaries
+		// Readers register in the counter of the epoch they started in, a writer that swapped out a dictionary
+		// flips the epoch twice and waits for each old counter to drain before it deletes the old dictionary
+		std::atomic<unsigned> epoch;
+		mutable std::atomic<int> readers[2];
+
+		std::atomic<int> generation; // incremented every time a new dictionary is published
+		std::atomic<bool> loading; // true while a worker thread is building a dictionary
+		std::atomic<bool> cancelLoad; // tells the worker thread to give up on the dictionary it's building
+		std::thread loader;
+		std::mutex publishMutex; // only one writer publishes at a time
+
+		// Makes newDict the dictionary readers see, then frees the old one once no reader can still be using it
+		void publish(Dictionary* newDict);
+
+		// Waits for every reader that might have seen the previously published dictionary
+		void waitForReaders();
+
+		// Stops and joins a worker thread that's building a dictionary, if there is one
+		void stopLoader();
+	};
 
-	// Inserts a word into the trie
-	void insertWord(std::string word)
+	explicit StudentSpellCheck(const std::shared_ptr<Shared>& shared)
+		: m_shared(shared), m_cache(SUGGESTION_CACHE_SIZE)
 	{
-		TrieNode* trav = root;
-		for (char c : word)
-		{
-			int index = getIndex(c);
-			if (index == -1) // if char c is not a letter or an apostrophe
-			{
-				continue;
-			}
-			if (!trav->children[index]) // if the children[index] doesn't exist, make one
-			{
-				trav->children[index] = newNode();
-			}
-			trav = trav->children[index];
-		}
-		trav->isDefined = true; // after reaching destination node, note that the word is defined
 	}
 
-	// Searches through dictionary if word is in the dictionary
-	bool search(std::string word)
+	std::shared_ptr<Shared> m_shared;
+	SuggestionCache m_cache; // results of recent spellCheck() calls, this spell checker's own
+
+	// Holds a dictionary for reading, the dictionary won't be freed until the guard goes away
+	class ReadGuard
 	{
-		if (word.empty()) // if the word is empty, then the word is not in the dictionary
+	public:
+		ReadGuard(const StudentSpellCheck& sc)
+			: m_shared(*sc.m_shared)
 		{
-			return false;
+			m_slot = m_shared.epoch.load() & 1;
+			m_shared.readers[m_slot]++;
+			m_dict = m_shared.dict.load();
 		}
-		TrieNode* trav = root;
-
-		// loop through the word, going to the appropriate node
-		for (char c : word)
+		~ReadGuard()
 		{
-			int index = getIndex(c);
-			if (index == -1) // if a character is not a letter or an apostrophe, skip
-				continue;
-			if (!trav->children[index]) // if the children[index] doesn't exist then the word is not defined
-			{
-				return false;
-			}
-			trav = trav->children[index]; // go down corresponding branch
+			m_shared.readers[m_slot]--;
 		}
-		return trav->isDefined;
-	}
+		const Dictionary* get() const { return m_dict; }
+	private:
+		const Shared& m_shared;
+		unsigned m_slot;
+		const Dictionary* m_dict;
+	};
+
+	// Private helper functions
+
+	// Spell checks a normalized word without looking in the cache
+	bool computeSuggestions(const std::string& word, int max_suggestions, std::vector<std::string>& suggestions);
 
-	void clearDictionary() // destructs the trie
+	// Searches through dict if word is in the dictionary
+	// Callers hold one ReadGuard for a whole word, line or range, so all of it is checked against the
+	// same dictionary and the guard's atomics are paid for once
+	static bool search(const Dictionary* dict, const std::string& word)
 	{
-		if (root == nullptr)
-			return;
-		release(root);
-		root = nullptr;
+		if (dict == nullptr) // no dictionary means no word is defined
+			return false;
+		return dict->search(word);
 	}
 
-	// Frees a trie seed and it's children
-	void release(TrieNode* seed)
+	// Puts words from dict that sound like word onto results
+	static void soundsLike(const Dictionary* dict, const std::string& word, int maxResults, std::vector<std::string>& results)
 	{
-		if (seed == nullptr)
-			return;
-		for (int i = 0; i < NUM_CHARS; i++)
-		{
-			release(seed->children[i]);
-		}
-		delete seed;
-		seed = nullptr;
-		return;
+		results.clear();
+		if (dict != nullptr)
+			dict->soundsLike(word, maxResults, results);
 	}
 
 	// Adds a new SpellCheck::Position with the appropriate start and end
@@ -146,35 +140,6 @@ private:
 
 	// tester functions
 	/*
-	void testTrie(std::ofstream& outfile, TrieNode* seed, std::string word)
-	{
-		if (seed == nullptr)
-			return;
-		if (seed->isDefined == true)
-		{
-			outfile << word << std::endl;
-		}
-		for (int i = 0; i < NUM_CHARS; i++)
-		{
-			testTrie(outfile, seed->children[i], word + getLetter(i));
-		}
-		return;
-	}
-	*/
-	/*
-	void testTrieBackwards(std::ofstream& outfile, TrieNode* seed, std::string word)
-	{
-		if (seed == nullptr)
-			return;
-		for (int i = NUM_CHARS - 1; i >= 0; i--)
-		{
-			testTrieBackwards(outfile, seed->children[i], word + getLetter(i));
-		}
-		if (seed->isDefined)
-			outfile << word << std::endl;
-	}
-	*/
-	/*
 	void testSearch(std::ofstream& outfile, TrieNode* seed, std::string word)
 	{
 		if (search(word))
@@ -1,9 +1,16 @@
 #include "StudentTextEditor.h"
 #include "Undo.h"
+#include "Trace.h"
+#include "MemoryReport.h"
+#include "TextSearch.h"
+#include "Regex.h"
 #include <string>
 #include <vector>
 
 #include <fstream> // for file streams
+#include <thread> // for std::thread
+#include <utility> // for std::pair
+#include <climits> // for INT_MAX
 using namespace std;
 
 TextEditor* createTextEditor(Undo* un)
@@ -20,8 +27,11 @@ StudentTextEditor::StudentTextEditor(Undo* undo)
 	m_cursorRow = 0;
 	m_cursorCol = 0;
 	m_lines.push_back("");
-	m_cursorIt = m_lines.begin();
 	m_addToUndoStack = true; // default setting is that calling every operation should add to undo stack
+	m_damaged = false;
+	m_damageFirst = m_damageOldEnd = m_damageNewEnd = 0;
+	m_indexWords = false;
+	m_replaceEmptyRow = false;
 }
 
 StudentTextEditor::~StudentTextEditor()
@@ -38,6 +48,7 @@ bool StudentTextEditor::load(std::string file) {
 	// Else return true
 	// Must reset cursor to the beginning
 
+	TRACE_SCOPE("StudentTextEditor::load");
 	ifstream infile(file);
 	if (!infile) // if file doesn't exist
 	{
@@ -47,8 +58,11 @@ bool StudentTextEditor::load(std::string file) {
 
 	// When loading, reset everything including the cursor
 	reset();
-	m_lines.pop_back(); // reset() adds an empty line so get rid of that empty line
+	m_lines.clear(); // reset() adds an empty line so get rid of that empty line
+	damage(0, 1, 0);
 
+	// the lines go into the store all at once, so its nodes are built full
+	vector<string> lines;
 	string s;
 	while (getline(infile, s))
 	{
@@ -56,19 +70,47 @@ bool StudentTextEditor::load(std::string file) {
 		{
 			s.pop_back(); // remove the '\r'
 		}
-		m_lines.push_back(s);
+		lines.push_back(s);
 	}
+	m_lines.insert(0, std::move(lines));
 
 	// To set up the cursor
 	m_cursorRow = 0;
 	m_cursorCol = 0;
-	m_cursorIt = m_lines.begin();
+	damage(0, 0, m_lines.size());
 
 	return true;
 }
 
+void StudentTextEditor::beginLoad()
+{
+	// O(N + U) like reset()
+	reset();
+	m_replaceEmptyRow = true;
+}
+
+void StudentTextEditor::appendLines(const std::vector<std::string>& lines)
+{
+	// O(K) where K is the number of characters in lines, the rows already there are untouched
+	TRACE_SCOPE("StudentTextEditor::appendLines");
+	if (lines.empty())
+		return;
+	if (m_replaceEmptyRow)
+	{
+		m_replaceEmptyRow = false;
+		m_lines.edit(0) = lines[0];
+		m_lines.insert(1, vector<string>(lines.begin() + 1, lines.end()));
+		damage(0, 1, lines.size());
+		return;
+	}
+	const int row = m_lines.size();
+	m_lines.insert(row, lines);
+	damage(row, 0, lines.size());
+}
+
 bool StudentTextEditor::save(std::string file)
 {
+	TRACE_SCOPE("StudentTextEditor::save");
 	// O(M) where M is the number of lines being edited
 	// Must save to the given file
 	// If the given file can't be opened/accessed, return false
@@ -80,7 +122,7 @@ bool StudentTextEditor::save(std::string file)
 		return false;
 	}
 	// O(M)
-	for (string line : m_lines)
+	for (const string& line : m_lines)
 	{
 		outfile << line << endl;
 	}
@@ -94,13 +136,15 @@ void StudentTextEditor::reset()
 	// Should be no text in the text editor afterwards
 	// O(N + U) where N is the number of lines and U is the number of undo operations in the undo stack
 
-	m_lines.clear(); // clears everything in text editor, O(N)
-	m_lines.push_back(""); // adds a new empty line in the list
+	const int removed = m_lines.size();
+	m_lines.clear(); // clears everything in text editor, O(1) besides freeing the nodes no snapshot shares
+	m_lines.push_back(""); // adds a new empty line
 	
 	// Sets cursor to [0,0]
 	m_cursorCol = 0;
 	m_cursorRow = 0;
-	m_cursorIt = m_lines.begin(); // Point cursorIt to the first line of the list
+	damage(0, removed, 1);
+	m_replaceEmptyRow = false;
 
 	getUndo()->clear();
 }
@@ -116,17 +160,15 @@ void StudentTextEditor::move(Dir dir)
 			if (m_cursorRow == 0) // if cursor at the top of the file, you can't do anything
 				return;
 			m_cursorRow--;
-			m_cursorIt--;
-			if (m_cursorCol > m_cursorIt->size()) // if the cursor will be off the line when going up, go to the end of the current line
-				m_cursorCol = m_cursorIt->size();
+			if (m_cursorCol > cursorLine().size()) // if the cursor will be off the line when going up, go to the end of the current line
+				m_cursorCol = cursorLine().size();
 			break;
 		case DOWN:
 			if (m_cursorRow == m_lines.size() - 1) // if the cursor is at the bottom of the file, don't do anything
 				return;
 			m_cursorRow++;
-			m_cursorIt++;
-			if (m_cursorCol > m_cursorIt->size()) // if the cursor will be off the line when going down, go to the end of the current line
-				m_cursorCol = m_cursorIt->size();
+			if (m_cursorCol > cursorLine().size()) // if the cursor will be off the line when going down, go to the end of the current line
+				m_cursorCol = cursorLine().size();
 			break;
 		case LEFT:
 			if (m_cursorCol == 0) // if the cursor is all the way towards the left
@@ -136,22 +178,20 @@ void StudentTextEditor::move(Dir dir)
 				else // if the cursor is currently at left edge of the current line and there is a line above the cursor, go to the last character of the line above
 				{
 					m_cursorRow--;
-					m_cursorIt--;
-					m_cursorCol = m_cursorIt->size();
+					m_cursorCol = cursorLine().size();
 					return;
 				}
 			}
 			m_cursorCol--;
 			break;
 		case RIGHT:
-			if (m_cursorCol == m_cursorIt->size()) // if the cursor is all the way towards the right of the line
+			if (m_cursorCol == cursorLine().size()) // if the cursor is all the way towards the right of the line
 			{
 				if (m_cursorRow == m_lines.size() - 1) // if the cursor is at the bottom of the file, don't do anything
 					return;
 				else // if the cursor is currently at the right edge of the current line, go to the first character of the line below
 				{
 					m_cursorRow++;
-					m_cursorIt++;
 					m_cursorCol = 0;
 					return;
 				}
@@ -162,13 +202,11 @@ void StudentTextEditor::move(Dir dir)
 			// moves to the beginning of the file
 			m_cursorCol = 0;
 			m_cursorRow = 0;
-			m_cursorIt = m_lines.begin();
 			break;
 		case END:
 			// moves to the end of the file
-			m_cursorIt = std::prev(m_lines.end(), 1);
 			m_cursorRow = m_lines.size() - 1;
-			m_cursorCol = m_cursorIt->size();
+			m_cursorCol = cursorLine().size();
 		default:
 			break;
 	}
@@ -181,10 +219,11 @@ void StudentTextEditor::del()
 	// Implementation is O(L) when erasing a letter and O(L1 + L2) when erasing a line
 
 	// if the cursor is NOT past the last character of a line
-	if (m_cursorCol != m_cursorIt->size()) // if the cursor is NOT past the last character of a line
+	if (m_cursorCol != cursorLine().size()) // if the cursor is NOT past the last character of a line
 	{
-		char ch = m_cursorIt->at(m_cursorCol); // stores the char to delete
-		m_cursorIt->erase(m_cursorCol, 1); // delete character where the cursor is
+		char ch = cursorLine().at(m_cursorCol); // stores the char to delete
+		m_lines.edit(m_cursorRow).erase(m_cursorCol, 1); // delete character where the cursor is
+		damage(m_cursorRow, 1, 1);
 		if(m_addToUndoStack) // if the operation is suppoed to add to the undo stack
 			getUndo()->submit(Undo::Action::DELETE, m_cursorRow, m_cursorCol, ch); // add to Undo stack
 	}
@@ -197,9 +236,9 @@ void StudentTextEditor::del()
 
 		// to get to this point the cursor must be in the last column of a line that's not the last line
 		// in this case a JOIN operation is pushed onto the undo stack because a line is being joined with another
-		auto nextLineIt = std::next(m_cursorIt, 1); // points to the line below the cursor
-		*m_cursorIt = *m_cursorIt + *nextLineIt; // combine the current line and the next line
-		m_lines.erase(nextLineIt); // delete the next line
+		m_lines.edit(m_cursorRow) += m_lines[m_cursorRow + 1]; // combine the current line and the next line
+		m_lines.erase(m_cursorRow + 1, 1); // delete the next line
+		damage(m_cursorRow, 2, 1);
 		if (m_addToUndoStack) // if the operation is suppoed to add to the undo stack
 			getUndo()->submit(Undo::Action::JOIN, m_cursorRow, m_cursorCol, '\n'); // add to Undo stack
 	}
@@ -215,8 +254,9 @@ void StudentTextEditor::backspace()
 	// if the cursor isn't in the first column of the current line
 	if (m_cursorCol > 0)
 	{
-		char ch = m_cursorIt->at(m_cursorCol - 1); // stores the char to delete
-		m_cursorIt->erase(m_cursorCol - 1, 1); // delete character to the left of where the cursor is
+		char ch = cursorLine().at(m_cursorCol - 1); // stores the char to delete
+		m_lines.edit(m_cursorRow).erase(m_cursorCol - 1, 1); // delete character to the left of where the cursor is
+		damage(m_cursorRow, 1, 1);
 		m_cursorCol--;
 		if(m_addToUndoStack) // if the operation is suppoed to add to the undo stack
 			getUndo()->submit(Undo::Action::DELETE, m_cursorRow, m_cursorCol, ch);
@@ -229,13 +269,12 @@ void StudentTextEditor::backspace()
 		}
 		// to get to this point this means that the cursor is in the first col of a line that's not the first line
 		// in this case a JOIN operation is pushed onto the undo stack because a line is being joined with another
-		auto previousLineIt = std::prev(m_cursorIt, 1); // points to the line above the cursor
-		m_cursorCol = previousLineIt->size(); // change column to be at appropriate position
-		*previousLineIt = *previousLineIt + *m_cursorIt; // combine current line and previous line
-		m_lines.erase(m_cursorIt); // remove the current line
+		m_cursorCol = m_lines[m_cursorRow - 1].size(); // change column to be at appropriate position
+		m_lines.edit(m_cursorRow - 1) += cursorLine(); // combine current line and previous line
+		m_lines.erase(m_cursorRow, 1); // remove the current line
 		// move the cursor up
-		m_cursorIt = previousLineIt;
 		m_cursorRow--;
+		damage(m_cursorRow, 2, 1);
 		if(m_addToUndoStack) // if the operation is suppoed to add to the undo stack
 			getUndo()->submit(Undo::Action::JOIN, m_cursorRow, m_cursorCol, '\n'); // add to Undo stack
 	}
@@ -253,7 +292,8 @@ void StudentTextEditor::insert(char ch)
 		// This means that there will be four pushes
 		for (int i = 0; i < TAB_LENGTH; i++) // add four spaces to the current line in the current column, shifting the column as appropriate
 		{
-			m_cursorIt->insert(m_cursorCol, " ");
+			m_lines.edit(m_cursorRow).insert(m_cursorCol, " ");
+			damage(m_cursorRow, 1, 1);
 			m_cursorCol++; // move column to the right by one
 			if(m_addToUndoStack) // if the operation is suppoed to add to the undo stack
 				getUndo()->submit(Undo::Action::INSERT, m_cursorRow, m_cursorCol, ch); // add to undo stack
@@ -261,13 +301,69 @@ void StudentTextEditor::insert(char ch)
 	}
 	else if (ch != '\t') // if a tab is NOT entered
 	{
-		m_cursorIt->insert(m_cursorCol, std::string(1, ch)); // insert ch at the current cursor column
+		m_lines.edit(m_cursorRow).insert(m_cursorCol, std::string(1, ch)); // insert ch at the current cursor column
+		damage(m_cursorRow, 1, 1);
 		m_cursorCol++; // move column to the right by one
 		if(m_addToUndoStack) // if the operation is suppoed to add to the undo stack
 			getUndo()->submit(Undo::Action::INSERT, m_cursorRow, m_cursorCol, ch); // add to undo stack
 	}
 }
 
+void StudentTextEditor::insertText(const std::string& text)
+{
+	// Inserts a whole block of text at the cursor (like a paste) as one edit with one undo entry
+	// '\n' in the text starts a new line, tabs become spaces like they do in insert()
+	// O(L + T) where L is the length of the cursor's line and T is the length of the text
+
+	vector<string> lines(1, cursorLine().substr(0, m_cursorCol));
+	for (char ch : text)
+	{
+		if (ch == '\n')
+			lines.push_back("");
+		else if (ch == '\t')
+			lines.back().append(TAB_LENGTH, ' ');
+		else if (ch != '\r')
+			lines.back() += ch;
+	}
+	const int row = m_cursorRow;
+	const int col = m_cursorCol;
+	const int endCol = lines.back().size(); // the cursor ends up after the inserted text
+	lines.back() += cursorLine().substr(m_cursorCol);
+
+	const int newCount = lines.size();
+	vector<string> oldLines;
+	replaceRows(1, std::move(lines), &oldLines);
+	if (m_addToUndoStack) // if the operation is suppoed to add to the undo stack
+		getUndo()->submitReplace(row, col, newCount, std::move(oldLines));
+
+	// moves the cursor to the end of the inserted text
+	m_cursorRow += newCount - 1;
+	m_cursorCol = endCol;
+}
+
+void StudentTextEditor::replaceRows(int count, std::vector<std::string> lines, std::vector<std::string>* removed)
+{
+	// O(log N + count + size of lines)
+	const int row = m_cursorRow;
+	if (count > m_lines.size() - row)
+		count = m_lines.size() - row;
+	int inserted = lines.size();
+	if (removed != nullptr)
+		m_lines.erase(row, count, *removed);
+	else
+		m_lines.erase(row, count);
+	m_lines.insert(row, std::move(lines));
+	if (m_lines.empty()) // there always has to be a line
+	{
+		m_lines.push_back("");
+		inserted = 1;
+	}
+	else if (row == m_lines.size()) // removed the last lines, so stay on the new last line
+		m_cursorRow--;
+	m_cursorCol = 0;
+	damage(row, count, inserted);
+}
+
 void StudentTextEditor::enter()
 {
 	// For when the user presses enter
@@ -282,32 +378,15 @@ void StudentTextEditor::enter()
 		getUndo()->submit(Undo::Action::SPLIT, m_cursorRow, m_cursorCol, '\n');
 
 
-	// This implementation is O(L)
-	// the check to see if the cursor is on the last line and adding a new line in this case is O(1)
-	// subtr is O(L)
-	auto nextLineIt = std::next(m_cursorIt, 1); // iterator to the next line
-
-	// The if and else if statements figure out how to add the new line
-	if (nextLineIt == m_lines.end()) // if the cursor is currently at the last line, make a new line at the end
-	{
-		m_lines.push_back(""); // makes a new line that's empty, constant time
-		nextLineIt = m_lines.end(); // constant time
-		nextLineIt--; // constant time
-	}
-	else if(nextLineIt != m_lines.end()) // if there is a line below a the cursor, insert a new line below the cursor
-	{
-		m_lines.insert(nextLineIt, "");
-		nextLineIt = std::next(m_cursorIt, 1); // iterator now points to the newly made line
-	}
-
-	string nextLine = m_cursorIt->substr(m_cursorCol); // stores what to put into the next line
-	*nextLineIt = nextLine + *nextLineIt; // add the new string into the next line
-	*m_cursorIt = m_cursorIt->substr(0, m_cursorCol); // cuts the current line
+	// This implementation is O(L + log N)
+	// subtr is O(L), inserting the new line below the cursor is O(log N)
+	m_lines.insert(m_cursorRow + 1, cursorLine().substr(m_cursorCol)); // everything from the cursor on goes to the next line
+	m_lines.edit(m_cursorRow).erase(m_cursorCol); // cuts the current line
+	damage(m_cursorRow, 1, 2);
 
 	// moves the cursor to the appropriate spot after pressing enter
 	m_cursorRow++;
 	m_cursorCol = 0;
-	m_cursorIt++;
 }
 
 void StudentTextEditor::getPos(int& row, int& col) const
@@ -316,75 +395,69 @@ void StudentTextEditor::getPos(int& row, int& col) const
 	col = m_cursorCol;
 }
 
+void StudentTextEditor::setPos(int row, int col)
+{
+	// O(log N)
+	if (row < 0)
+		row = 0;
+	if (row >= m_lines.size())
+		row = m_lines.size() - 1;
+	m_cursorRow = row;
+	if (col < 0)
+		col = 0;
+	if (col > cursorLine().size())
+		col = cursorLine().size();
+	m_cursorCol = col;
+}
+
 int StudentTextEditor::getLines(int startRow, int numRows, std::vector<std::string>& lines) const
 {
 	if (startRow < 0 || numRows < 0 || startRow > m_lines.size()) // if startRow and numRows are invalid numbers
 		return -1;
 	lines.clear(); // clear vector
 
-	// figures out where to start inserting, whether to move the iterator upwards or downwards
-	auto it = m_cursorIt; // set an iterator to where the cursor is
-	if (m_cursorRow > startRow) // if the cursor is below the start row, go up
-	{
-		int count = m_cursorRow - startRow;
-		while (count > 0)
-		{
-			it--;
-			count--;
-		}
-	}
-	else if (m_cursorRow < startRow) // if the cursor is above the start row, go down
-	{
-		int count = startRow - m_cursorRow;
-		while (count > 0)
-		{
-			count--;
-			it++;
-		}
-	}
+	// add to the vector stack starting from startRow, O(log N) to find it and then O(1) per row
+	m_lines.copyLines(startRow, numRows, lines);
+	return lines.size();
+}
+
+LineStore::Snapshot StudentTextEditor::snapshot() const
+{
+	// O(1), the nodes are shared until the text changes them
+	return m_lines.snapshot();
+}
 
-	// add to the vector stack starting from startRow
-	int count = 0;
-	while (it != m_lines.end() && count < numRows)
+void StudentTextEditor::undo()
+{
+	// the entries of a group come off one at a time, the last one handed back says if there are more
+	while (undoEntry() && getUndo()->grouped())
 	{
-		lines.push_back(*it);
-		it++;
-		count++;
 	}
-	return lines.size();
 }
 
-void StudentTextEditor::undo()
+void StudentTextEditor::beginGroup()
+{
+	getUndo()->beginGroup();
+}
+
+void StudentTextEditor::endGroup()
+{
+	getUndo()->endGroup();
+}
+
+bool StudentTextEditor::undoEntry()
 {
 	int row, col, count;
 	string text;
-	Undo::Action action = getUndo()->get(row, col, count, text);
+	vector<string> lines; // the rows a REPLACE puts back
+	Undo::Action action = getUndo()->get(row, col, count, text, lines);
 
 	// do nothing if the undo stack is empty
 	if (action == Undo::Action::ERROR)
-		return;
+		return false;
 
 	// set's the cursor row to the where the operation should start
-	if (m_cursorRow > row) // if the cursor is below the row where the action takes place, go up
-	{
-		int countRow = m_cursorRow - row;
-		while (countRow > 0)
-		{
-			m_cursorIt--;
-			m_cursorRow--;
-			countRow--;
-		}
-	}
-	else if (m_cursorRow < row) // if the cursor is above the row where the action takes place, go down
-	{
-		int countRow = row - m_cursorRow;
-		while (countRow > 0)
-		{
-			countRow--;
-			m_cursorIt++;
-			m_cursorRow++;
-		}
-	}
+	m_cursorRow = row;
 	m_cursorCol = col; // sets the column to where the operation should start
 
 	m_addToUndoStack = false; // make it false since this function uses del(), and enter()
@@ -394,11 +467,13 @@ void StudentTextEditor::undo()
 	{
 		// have to insert text
 		case Undo::Action::INSERT:
-			m_cursorIt->insert(m_cursorCol, text); // insert string text starting from col position
+			m_lines.edit(m_cursorRow).insert(m_cursorCol, text); // insert string text starting from col position
+			damage(m_cursorRow, 1, 1);
 			break;
 		// have to delete text
 		case Undo::Action::DELETE:
-			m_cursorIt->erase(m_cursorCol, count); // delete count number of characters starting from the col position
+			m_lines.edit(m_cursorRow).erase(m_cursorCol, count); // delete count number of characters starting from the col position
+			damage(m_cursorRow, 1, 1);
 			break;
 		// have to join two lines
 		case Undo::Action::JOIN:
@@ -408,9 +483,245 @@ void StudentTextEditor::undo()
 		case Undo::Action::SPLIT:
 			enter(); // entering at right position takes care of the split
 			break;
+		// have to put back the lines that were replaced
+		case Undo::Action::REPLACE:
+			replaceRows(count, std::move(lines));
+			m_cursorCol = col;
+			break;
 		default:
 			break;
 	}
 	m_addToUndoStack = true; // after this function is done, operations should act normal
-	return;
-}
\ No newline at end of file
+	return true;
+}
+
+bool StudentTextEditor::takeDamage(int& first, int& oldCount, int& newCount)
+{
+	// O(1), hands over the damaged span and starts a new one
+	if (!m_damaged)
+		return false;
+	first = m_damageFirst;
+	oldCount = m_damageOldEnd - m_damageFirst;
+	newCount = m_damageNewEnd - m_damageFirst;
+	m_damaged = false;
+	return true;
+}
+
+void StudentTextEditor::findAll(const TextSearch& search, std::vector<Match>& matches) const
+{
+	// O(M) where M is the number of characters in the editor, plus the length of the query for every match
+	TRACE_SCOPE("StudentTextEditor::findAll");
+	matches.clear();
+	int row = 0;
+	for (const string& line : m_lines)
+	{
+		for (size_t col = search.find(line.data(), line.size(), 0); col != string::npos; col = search.find(line.data(), line.size(), col + 1))
+			matches.push_back(Match{ row, static_cast<int>(col) });
+		row++;
+	}
+}
+
+void StudentTextEditor::refineMatches(const TextSearch& search, std::vector<Match>& matches) const
+{
+	// O(R + K*Q) where R is the row of the last match, K is the number of matches and Q is the length of the query
+	TRACE_SCOPE("StudentTextEditor::refineMatches");
+	size_t kept = 0;
+	int row = 0;
+	auto it = m_lines.begin();
+	for (const Match& match : matches)
+	{
+		while (row < match.row && it != m_lines.end())
+		{
+			++it;
+			row++;
+		}
+		if (it == m_lines.end())
+			break;
+		if (search.matchesAt(it->data(), it->size(), match.col))
+			matches[kept++] = match;
+	}
+	matches.resize(kept);
+}
+
+int StudentTextEditor::replaceAll(const Regex& regex, const std::string& replacement)
+{
+	// O(M/T) to find and rewrite the matches on T threads where M is the number of characters in the editor,
+	// then O(log N + S) to swap in the span S of rows from the first changed row to the last
+	TRACE_SCOPE("StudentTextEditor::replaceAll");
+	const size_t size = m_lines.size();
+
+	// each thread takes a run of rows with a Matcher of its own, nothing is shared but the snapshot they read
+	const size_t ROWS_PER_THREAD = 1024;
+	size_t threads = thread::hardware_concurrency();
+	if (threads == 0)
+		threads = 1;
+	if (threads > size / ROWS_PER_THREAD + 1)
+		threads = size / ROWS_PER_THREAD + 1;
+	vector<vector<pair<int, string>>> changed(threads); // (row, new text) for every row with a match
+	vector<int> counts(threads, 0);
+	{
+		const LineStore::Snapshot text = m_lines.snapshot();
+		auto work = [&](size_t t)
+		{
+			Regex::Matcher matcher(regex);
+			const size_t end = size * (t + 1) / threads;
+			string out;
+			size_t row = size * t / threads;
+			for (auto line = text.at(row); row < end; row++, ++line)
+			{
+				const int count = matcher.replace(*line, replacement, out);
+				if (count > 0)
+				{
+					changed[t].push_back(make_pair(static_cast<int>(row), std::move(out)));
+					counts[t] += count;
+				}
+			}
+		};
+		vector<thread> workers;
+		for (size_t t = 1; t < threads; t++)
+			workers.push_back(thread(work, t));
+		work(0);
+		for (thread& worker : workers)
+			worker.join();
+	} // let go of the snapshot, so replacing the rows doesn't copy the nodes it shares
+
+	int total = 0;
+	vector<pair<int, string>> rows;
+	for (size_t t = 0; t < threads; t++)
+	{
+		total += counts[t];
+		for (auto& row : changed[t])
+			rows.push_back(std::move(row));
+	}
+	if (rows.empty())
+		return 0;
+
+	// the rows from the first changed one to the last become one replaced span, so one undo puts it all back
+	const int first = rows.front().first;
+	const int last = rows.back().first;
+	vector<string> span;
+	size_t next = 0;
+	auto line = m_lines.at(first);
+	for (int row = first; row <= last; row++, ++line)
+	{
+		if (rows[next].first == row)
+			span.push_back(std::move(rows[next++].second));
+		else
+			span.push_back(*line);
+	}
+	int row, col;
+	getPos(row, col);
+	setPos(first, 0);
+	const int spanSize = span.size();
+	vector<string> oldLines;
+	replaceRows(spanSize, std::move(span), &oldLines);
+	if (m_addToUndoStack)
+		getUndo()->submitReplace(first, 0, spanSize, std::move(oldLines));
+	setPos(row, col);
+	return total;
+}
+
+void StudentTextEditor::replaceLines(int row, int count, std::vector<std::string> lines)
+{
+	// O(log N + R + L) where R is the number of replaced rows, which are moved into the undo entry rather
+	// than copied, and L is the number of lines
+	TRACE_SCOPE("StudentTextEditor::replaceLines");
+	const int size = m_lines.size();
+	if (row < 0)
+		row = 0;
+	if (row > size)
+		row = size;
+	if (count < 0)
+		count = 0;
+	if (count > size - row)
+		count = size - row;
+
+	// undo puts back a REPLACE by replacing the new rows with at least one old row, so neither side can
+	// be empty: adding or removing rows takes a neighbouring row along, the one before if there is one
+	bool withBefore = false;
+	bool withAfter = false;
+	if (count == 0 || lines.empty())
+	{
+		if (row > 0)
+		{
+			row--;
+			count++;
+			withBefore = true;
+		}
+		else if (count < size)
+		{
+			count++;
+			withAfter = true;
+		}
+		// otherwise every row goes, and one empty row takes their place
+	}
+	int cursorRow, cursorCol;
+	getPos(cursorRow, cursorCol);
+	setPos(row, 0);
+	if (withBefore)
+		lines.insert(lines.begin(), m_lines[row]);
+	if (withAfter)
+		lines.push_back(m_lines[row + count - 1]);
+	if (lines.empty()) // removing every row leaves an empty one
+		lines.push_back("");
+
+	const int newCount = lines.size();
+	vector<string> oldLines;
+	replaceRows(count, std::move(lines), &oldLines);
+	if (m_addToUndoStack)
+		getUndo()->submitReplace(row, 0, newCount, std::move(oldLines));
+
+	if (cursorRow >= row + count)
+		cursorRow += newCount - count;
+	else if (cursorRow >= row + newCount)
+	{
+		cursorRow = row + newCount - 1;
+		cursorCol = INT_MAX; // the end of the last new row
+	}
+	setPos(cursorRow, cursorCol);
+}
+
+void StudentTextEditor::indexWords()
+{
+	// O(M) where M is the number of characters in the editor, then O(L) for every row that changes
+	if (m_indexWords)
+		return;
+	TRACE_SCOPE("StudentTextEditor::indexWords");
+	m_wordIndex.clear();
+	m_wordIndex.replace(0, 0, m_lines.begin(), m_lines.size());
+	m_indexWords = true;
+}
+
+long StudentTextEditor::findWord(const std::string& word, std::vector<int>& rows) const
+{
+	// O(R log N) where R is the number of rows the word is on and N is the number of rows
+	return m_wordIndex.find(word, rows);
+}
+
+void StudentTextEditor::compressLines(int keepFrom, int keepTo)
+{
+	// O(log N) for every block unpacked since the last call, plus O(K) to compress the K characters of
+	// the blocks that go cold
+	TRACE_SCOPE("StudentTextEditor::compressLines");
+	m_lines.pack(keepFrom, keepTo);
+}
+
+void StudentTextEditor::reportMemory(MemoryReport& report) const
+{
+	// O(M) where M is the number of characters in the editor
+	// Lines a snapshot shares with the text are counted as the text's
+	size_t characters = 0;
+	for (const string& line : m_lines)
+		characters += line.size();
+	report.addCount("text", "lines", m_lines.size());
+	report.addCount("text", "characters", characters);
+	report.addBytes("text", "line nodes", m_lines.nodeBytes());
+	report.addBytes("text", "line buffers", m_lines.lineBytes());
+	if (m_lines.packedLines() > 0)
+	{
+		report.addCount("text", "packed lines", m_lines.packedLines());
+		report.addBytes("text", "packed blocks", m_lines.packedBytes());
+	}
+	if (m_indexWords)
+		m_wordIndex.reportMemory(report);
+}
@@ -2,7 +2,8 @@
 #define STUDENTTEXTEDITOR_H_
 
 #include "TextEditor.h"
-#include <list> // for std::list
+#include "WordIndex.h"
+#include "LineStore.h"
 
 class Undo;
 
@@ -13,24 +14,81 @@ public:
 	StudentTextEditor(Undo* undo);
 	~StudentTextEditor();
 	bool load(std::string file);
+	void beginLoad();
+	void appendLines(const std::vector<std::string>& lines);
 	bool save(std::string file);
 	void reset();
 	void move(Dir dir);
 	void del();
 	void backspace();
 	void insert(char ch);
+	void insertText(const std::string& text);
 	void enter();
 	void getPos(int& row, int& col) const;
+	void setPos(int row, int col);
 	int getLines(int startRow, int numRows, std::vector<std::string>& lines) const;
+	LineStore::Snapshot snapshot() const;
 	void undo();
+	void beginGroup();
+	void endGroup();
+	bool takeDamage(int& first, int& oldCount, int& newCount);
+	void findAll(const TextSearch& search, std::vector<Match>& matches) const;
+	void refineMatches(const TextSearch& search, std::vector<Match>& matches) const;
+	int replaceAll(const Regex& regex, const std::string& replacement);
+	void replaceLines(int row, int count, std::vector<std::string> lines);
+	void indexWords();
+	long findWord(const std::string& word, std::vector<int>& rows) const;
+	void compressLines(int keepFrom, int keepTo);
+	void reportMemory(MemoryReport& report) const;
 
 private:
 	int m_cursorRow;
 	int m_cursorCol;
-	std::list<std::string> m_lines;
-	std::list<std::string>::iterator m_cursorIt;
+	LineStore m_lines;
+
+	const std::string& cursorLine() const { return m_lines[m_cursorRow]; }
+
+	// Undoes the last entry on the undo stack, returns false if there wasn't one
+	bool undoEntry();
 
 	bool m_addToUndoStack; // stores whether or to submit(action) whenever insert(), backspace(), del(), or enter() is called
+	bool m_replaceEmptyRow; // whether the next appendLines() replaces the empty row beginLoad() left
+
+	// Replaces count rows starting at the cursor's row with lines, leaving the cursor at the start of the first new row
+	// The replaced rows are moved onto removed unless it's null
+	void replaceRows(int count, std::vector<std::string> lines, std::vector<std::string>* removed = nullptr);
+
+	// The rows changed since takeDamage() was last called, as one span:
+	// rows [m_damageFirst, m_damageOldEnd) of the old text are rows [m_damageFirst, m_damageNewEnd) now
+	bool m_damaged;
+	int m_damageFirst;
+	int m_damageOldEnd;
+	int m_damageNewEnd;
+
+	bool m_indexWords; // whether m_wordIndex is kept up to date
+	WordIndex m_wordIndex;
+
+	// Records that rows [row, row+removed) were replaced by inserted rows, merging it into the damaged
+	// span and updating the word index
+	void damage(int row, int removed, int inserted)
+	{
+		if (m_indexWords)
+			m_wordIndex.replace(row, removed, m_lines.at(row), inserted);
+		if (!m_damaged)
+		{
+			m_damaged = true;
+			m_damageFirst = row;
+			m_damageOldEnd = row + removed;
+			m_damageNewEnd = row + inserted;
+			return;
+		}
+		// rows before the span and after it are untouched, so growing the span over them maps one to one
+		int end = (row + removed > m_damageNewEnd) ? row + removed : m_damageNewEnd;
+		m_damageOldEnd += end - m_damageNewEnd;
+		m_damageNewEnd = end + inserted - removed;
+		if (row < m_damageFirst)
+			m_damageFirst = row;
+	}
 };
 
 #endif // STUDENTTEXTEDITOR_H_
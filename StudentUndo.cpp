@@ -1,4 +1,6 @@
 #include "StudentUndo.h"
+#include "MemoryReport.h"
+#include <utility> // for std::move
 
 Undo* createUndo()
 {
@@ -10,14 +12,14 @@ void StudentUndo::submit(const Action action, int row, int col, char ch)
 	// Used by text editor to push stuff onto the stack
 	// must be O(1) in average case, going up to O(length of current edited line) sometimes
 
-	// if undo stack is empty, just add normally
-	if (m_undoStack.empty())
+	// if undo stack is empty, or a group has just begun and mustn't batch with what came before it, just add normally
+	if (m_undoStack.empty() || (m_grouping && m_groupEntries == 0))
 	{
 		addToStack(action, row, col, ch);
 	}
 	else // if the undto stack is not empty, check cases
 	{
-		UndoData top = m_undoStack.top(); // stores what's on the top of the stack
+		const UndoData& top = m_undoStack.back(); // refers to what's on the top of the stack, copying it would copy its text
 
 		if (action != top.m_action) // if the action of the top of the stack is not the same as the new action being pushed in, push something new
 		{
@@ -33,9 +35,9 @@ void StudentUndo::submit(const Action action, int row, int col, char ch)
 			else if (action == INSERT)
 			{
 				// if the action is batchable, batch it
-				if (top.m_row == row && (top.m_col + m_undoStack.top().m_count) == col)
+				if (top.m_row == row && (top.m_col + m_undoStack.back().m_count) == col)
 				{
-					m_undoStack.top().m_count++; // increase the number of characters to delete
+					m_undoStack.back().m_count++; // increase the number of characters to delete
 				}
 				else // since batching does not occur here, add normally
 				{
@@ -48,12 +50,12 @@ void StudentUndo::submit(const Action action, int row, int col, char ch)
 				// if batching by del() works, add ch to the end of the batch text
 				if (top.m_row == row && ((col == top.m_col)))
 				{
-					m_undoStack.top().m_text += std::string(1, ch);
+					m_undoStack.back().m_text += std::string(1, ch);
 				}
 				else if (top.m_row == row && (col == (top.m_col - 1))) // if batching by backspace() works, add character to the beginning of the batch text
 				{
-					m_undoStack.top().m_text = std::string(1, ch) + m_undoStack.top().m_text;
-					m_undoStack.top().m_col = col; // shift the starting position by one when backspace is called
+					m_undoStack.back().m_text = std::string(1, ch) + m_undoStack.back().m_text;
+					m_undoStack.back().m_col = col; // shift the starting position by one when backspace is called
 				}
 				else // since batching does not occur here, add normally
 				{
@@ -64,7 +66,34 @@ void StudentUndo::submit(const Action action, int row, int col, char ch)
 	}
 }
 
+void StudentUndo::submitReplace(int row, int col, int count, std::vector<std::string> oldLines)
+{
+	// O(1), the old lines are moved in, replacements never batch with anything
+
+	UndoData und;
+	und.m_action = REPLACE;
+	und.m_row = row;
+	und.m_col = col;
+	und.m_count = count;
+	und.m_lines = std::move(oldLines);
+	push(std::move(und));
+}
+
 StudentUndo::Action StudentUndo::get(int& row, int& col, int& count, std::string& text)
+{
+	// the lines a REPLACE puts back come joined into text
+	std::vector<std::string> lines;
+	const Action action = get(row, col, count, text, lines);
+	for (size_t i = 0; i < lines.size(); i++)
+	{
+		if (i > 0)
+			text += '\n';
+		text += lines[i];
+	}
+	return action;
+}
+
+StudentUndo::Action StudentUndo::get(int& row, int& col, int& count, std::string& text, std::vector<std::string>& lines)
 {
 	// return the opposite of what's in the row
 	// return the start row/col of the operation, not it's end coordinates
@@ -75,13 +104,15 @@ StudentUndo::Action StudentUndo::get(int& row, int& col, int& count, std::string
 	}
 
 	// get the data and pop it
-	StudentUndo::UndoData und = m_undoStack.top();
-	m_undoStack.pop();
+	StudentUndo::UndoData und = std::move(m_undoStack.back());
+	m_undoStack.pop_back();
+	m_lastJoined = und.m_joined;
 
 	// Set the referenes to the appropriate values
 	row = und.m_row;
 	count = und.m_count;
 	text = und.m_text;
+	lines = std::move(und.m_lines);
 
 	// return the opposite operation
 	switch (und.m_action)
@@ -102,6 +133,10 @@ StudentUndo::Action StudentUndo::get(int& row, int& col, int& count, std::string
 			col = und.m_col;
 			return JOIN;
 			break;
+		case REPLACE: // undoing a replacement is a replacement back
+			col = und.m_col;
+			return REPLACE;
+			break;
 		default:
 			return ERROR;
 			break;
@@ -109,11 +144,47 @@ StudentUndo::Action StudentUndo::get(int& row, int& col, int& count, std::string
 	return ERROR;
 }
 
+void StudentUndo::beginGroup()
+{
+	// O(1), the entries pushed until endGroup() are joined to the first of them
+	m_grouping = true;
+	m_groupEntries = 0;
+}
+
+void StudentUndo::endGroup()
+{
+	m_grouping = false;
+}
+
+bool StudentUndo::grouped() const
+{
+	return m_lastJoined && !m_undoStack.empty();
+}
+
 void StudentUndo::clear()
 {
 	// Clear what's ever in the stack
 	// Must be O(N) where N is the number of elements in the stack
 
-	while (!m_undoStack.empty())
-		m_undoStack.pop();
-}
\ No newline at end of file
+	m_undoStack.clear();
+	m_lastJoined = false;
+}
+
+void StudentUndo::reportMemory(MemoryReport& report) const
+{
+	// O(N) where N is the number of elements in the stack
+
+	size_t text = 0;
+	for (const UndoData& und : m_undoStack)
+	{
+		text += MemoryReport::heapBytes(und.m_text) + MemoryReport::heapBytes(und.m_lines);
+		for (const std::string& line : und.m_lines)
+			text += MemoryReport::heapBytes(line);
+	}
+	// the deque keeps its entries in blocks of about 512 bytes
+	const size_t perBlock = sizeof(UndoData) < 512 ? 512 / sizeof(UndoData) : 1;
+	const size_t blocks = m_undoStack.size() / perBlock + 1;
+	report.addCount("undo", "entries", m_undoStack.size());
+	report.addBytes("undo", "entry blocks", blocks * perBlock * sizeof(UndoData) + blocks * sizeof(void*));
+	report.addBytes("undo", "saved text", text);
+}
@@ -2,15 +2,22 @@
 #define STUDENTUNDO_H_
 
 #include "Undo.h"
-#include <stack> // for std::stack
+#include <deque> // for std::deque
 #include <string> // for std::string
+#include <vector> // for std::vector
 
 class StudentUndo : public Undo {
 public:
 
 	void submit(Action action, int row, int col, char ch = 0);
+	void submitReplace(int row, int col, int count, std::vector<std::string> oldLines);
 	Action get(int& row, int& col, int& count, std::string& text);
+	Action get(int& row, int& col, int& count, std::string& text, std::vector<std::string>& lines);
+	void beginGroup();
+	void endGroup();
+	bool grouped() const;
 	void clear();
+	void reportMemory(MemoryReport& report) const;
 
 private:
 	struct UndoData
@@ -18,12 +25,27 @@ private:
 		Action m_action;
 		int m_row;
 		int m_col;
-		std::string m_text; // will be empty if m_action is INSERT, JOIN, or SPLIT
+		std::string m_text; // will be empty if m_action is INSERT, JOIN, SPLIT, or REPLACE
 							// if m_action is DELETE, will store what text to restore
+		std::vector<std::string> m_lines; // if m_action is REPLACE, will store the lines to restore
 		int m_count; // will be 1 if m_action is DELETE, JOIN, SPLIT
 					 // if m_action is INSERT, will store how many characters to delete
+					 // if m_action is REPLACE, will store how many lines to delete
+		bool m_joined = false; // undone along with the entry under it, as one step
 	};
-	std::stack<UndoData> m_undoStack; // undoStack, holds UndoData struct
+	std::deque<UndoData> m_undoStack; // undoStack, holds UndoData struct, the top of the stack at the back
+	bool m_grouping = false; // between beginGroup() and endGroup()
+	int m_groupEntries = 0; // entries pushed since beginGroup()
+	bool m_lastJoined = false; // whether what get() handed back last was joined to the entry under it
+
+	// Pushes und, joining it to the entry under it if it isn't the first of a group
+	void push(UndoData&& und)
+	{
+		und.m_joined = m_grouping && m_groupEntries > 0;
+		if (m_grouping)
+			m_groupEntries++;
+		m_undoStack.push_back(std::move(und));
+	}
 
 	// Whenever batching does not occur, call this function to add stuff to the stack
 	void addToStack(const Action action, int row, int col, char ch)
@@ -49,7 +71,7 @@ private:
 		default:
 			break;
 		}
-		m_undoStack.push(und);
+		push(std::move(und));
 	}
 };
 
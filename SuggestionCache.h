@@ -0,0 +1,103 @@
+#ifndef SUGGESTIONCACHE_H_
+#define SUGGESTIONCACHE_H_
+
+#include "MemoryReport.h"
+
+#include <string>
+#include <vector>
+#include <list>
+#include <unordered_map>
+#include <mutex>
+#include <algorithm>
+
+// A small least-recently-used cache of spell check results
+// Entries are keyed by the normalized word and remember the dictionary generation they were computed
+// with, so publishing a new dictionary makes every old entry a miss
+class SuggestionCache {
+public:
+	SuggestionCache(size_t capacity)
+		: m_capacity(capacity)
+	{
+	}
+
+	// Looks up word, returns true and fills in correct and suggestions if there's an entry from generation
+	// that was computed with at least maxSuggestions suggestions allowed (or didn't need that many)
+	bool get(const std::string& word, int generation, int maxSuggestions, bool& correct, std::vector<std::string>& suggestions)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_index.find(word);
+		if (it == m_index.end() || !it->second->usable(generation, maxSuggestions))
+			return false;
+		m_entries.splice(m_entries.begin(), m_entries, it->second); // now the most recently used
+		correct = it->second->correct;
+		suggestions.assign(it->second->suggestions.begin(),
+			it->second->suggestions.begin() + std::min<size_t>(maxSuggestions, it->second->suggestions.size()));
+		return true;
+	}
+
+	// Remembers the result of spell checking word
+	void put(const std::string& word, int generation, int maxSuggestions, bool correct, const std::vector<std::string>& suggestions)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		auto it = m_index.find(word);
+		if (it != m_index.end())
+		{
+			m_entries.erase(it->second);
+			m_index.erase(it);
+		}
+		else if (m_entries.size() == m_capacity) // full, forget the least recently used entry
+		{
+			m_index.erase(m_entries.back().word);
+			m_entries.pop_back();
+		}
+		m_entries.push_front(Entry{ word, generation, maxSuggestions, correct, suggestions });
+		m_index[word] = m_entries.begin();
+	}
+
+	void clear()
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_entries.clear();
+		m_index.clear();
+	}
+
+	size_t size() const { std::lock_guard<std::mutex> lock(m_mutex); return m_entries.size(); }
+
+	// Adds the entries and their index to report, under "caches"
+	void reportMemory(MemoryReport& report) const
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		size_t bytes = MemoryReport::listNodeBytes<Entry>(m_entries.size()) + MemoryReport::hashMapBytes(m_index);
+		for (const Entry& entry : m_entries)
+		{
+			bytes += 2 * MemoryReport::heapBytes(entry.word) + MemoryReport::heapBytes(entry.suggestions); // the index has its own copy of the word
+			for (const std::string& suggestion : entry.suggestions)
+				bytes += MemoryReport::heapBytes(suggestion);
+		}
+		report.addCount("caches", "suggestion cache entries", m_entries.size());
+		report.addBytes("caches", "suggestion cache", bytes);
+	}
+
+private:
+	struct Entry
+	{
+		std::string word;
+		int generation;
+		int maxSuggestions; // the limit the suggestions were computed with
+		bool correct;
+		std::vector<std::string> suggestions;
+
+		bool usable(int gen, int max) const
+		{
+			// a shorter list than the limit it was computed with is complete, so it works for any limit
+			return generation == gen && (max <= maxSuggestions || suggestions.size() < maxSuggestions);
+		}
+	};
+
+	size_t m_capacity;
+	std::list<Entry> m_entries; // most recently used first
+	std::unordered_map<std::string, std::list<Entry>::iterator> m_index;
+	mutable std::mutex m_mutex;
+};
+
+#endif // SUGGESTIONCACHE_H_
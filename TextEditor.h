@@ -1,30 +1,89 @@
 #ifndef TEXTEDITOR_H_
 #define TEXTEDITOR_H_
 
+#include "LineStore.h"
 #include <string>
 #include <vector>
 
 class Undo;
+class MemoryReport;
+class TextSearch;
+class Regex;
 
 class TextEditor {
 public:
 	enum Dir { UP, DOWN, LEFT, RIGHT, HOME, END };
 
+	// Where a search found its query.
+	struct Match {
+		int row;
+		int col;
+	};
+
 	TextEditor(Undo* undo)
 		: undo_(undo) { }
 	virtual ~TextEditor() { }
 	virtual bool load(std::string file) = 0;
+	// For loading a file a piece at a time (e.g., while the rest of it is read on another thread):
+	// beginLoad() empties the editor like reset() does, and every appendLines() after it adds rows after
+	// the last one, without moving the cursor or adding to the undo history. The first lines appended
+	// take the place of the empty row beginLoad() leaves. The rows can be edited in between.
+	virtual void beginLoad() = 0;
+	virtual void appendLines(const std::vector<std::string>& lines) = 0;
 	virtual bool save(std::string file) = 0;
 	virtual void reset() = 0;
 
 	virtual void insert(char ch) = 0;
+	virtual void insertText(const std::string& text) = 0;
 	virtual void enter() = 0;
 	virtual void del() = 0;
 	virtual void backspace() = 0;
 	virtual void move(Dir dir) = 0;
 	virtual void getPos(int& row, int& col) const = 0;
+	// Moves the cursor to row and col, kept within the text.
+	virtual void setPos(int row, int col) = 0;
 	virtual int getLines(int startRow, int numRows, std::vector<std::string>& lines) const = 0;
+	// The text as it is now, in O(1). It never changes however the text is edited after, and can be read
+	// on any thread while the editor goes on editing.
+	virtual LineStore::Snapshot snapshot() const = 0;
+	// Undoes the last step, which is every edit made between a beginGroup() and endGroup() if it was one.
 	virtual void undo() = 0;
+	virtual void beginGroup() = 0;
+	virtual void endGroup() = 0;
+
+	// Reports which rows changed since the last call: rows [first, first+oldCount) of the text as it was
+	// became rows [first, first+newCount) of the text now, everything outside of that is untouched.
+	// Returns false if nothing changed.
+	virtual bool takeDamage(int& first, int& oldCount, int& newCount) = 0;
+
+	// Puts every match of search in the text onto matches, in order.
+	virtual void findAll(const TextSearch& search, std::vector<Match>& matches) const = 0;
+	// Keeps only the matches that search still finds at the same spots, for a search that refines
+	// (TextSearch::refines()) the one the matches were found with.
+	virtual void refineMatches(const TextSearch& search, std::vector<Match>& matches) const = 0;
+	// Replaces every match of regex with replacement (see Regex::Matcher::replace) as one edit with one
+	// undo step, leaving the cursor where it was. Returns how many matches were replaced.
+	virtual int replaceAll(const Regex& regex, const std::string& replacement) = 0;
+	// Replaces rows [row, row+count) with lines as one edit with one undo step (e.g., to bring in what
+	// changed in the file on disk). The cursor stays on the text it was on: it moves with the rows after
+	// the replaced ones, and stays as far into the replaced rows as the new ones go if it was on one.
+	// Lines passed as an rvalue are moved into the text rather than copied.
+	virtual void replaceLines(int row, int count, std::vector<std::string> lines) = 0;
+
+	// Starts keeping an index of the rows every word is on, updated as rows change, so findWord() takes
+	// time in the number of rows it finds rather than the size of the text. Builds it in one pass.
+	virtual void indexWords() = 0;
+	// Puts the rows word is on (as a whole word, in any case) onto rows, in order, and returns how many
+	// times it appears. Needs indexWords() to have been called.
+	virtual long findWord(const std::string& word, std::vector<int>& rows) const = 0;
+
+	// Keeps the rows outside [keepFrom, keepTo) compressed, for texts too big to keep in memory as they
+	// are. Rows read after are unpacked a block at a time into a few recently used blocks, and rows
+	// edited stay unpacked until the next call.
+	virtual void compressLines(int keepFrom, int keepTo) = 0;
+
+	// Adds what the text takes up to report, under "text".
+	virtual void reportMemory(MemoryReport& report) const = 0;
 
 protected:
 	Undo* getUndo() { return undo_; }
@@ -5,19 +5,66 @@
 #include <curses.h>		// https://www.linuxjournal.com/content/getting-started-ncurses
 #else
 #include "curses.h"
-#endif 
+#endif
 
 #include <string>
+#include <mutex>
+#ifndef _MSC_VER
+#include <poll.h>
+#include <unistd.h>
+#endif
 
+const int CTRL_A = 'A' - 'A' + 1;
+const int CTRL_B = 'B' - 'A' + 1;
 const int CTRL_D = 'D' - 'A' + 1;
+const int CTRL_E = 'E' - 'A' + 1;
+const int CTRL_F = 'F' - 'A' + 1;
+const int CTRL_G = 'G' - 'A' + 1;
+const int CTRL_K = 'K' - 'A' + 1;
+const int CTRL_O = 'O' - 'A' + 1;
+const int CTRL_R = 'R' - 'A' + 1;
 const int CTRL_S = 'S' - 'A' + 1;
+const int CTRL_T = 'T' - 'A' + 1;
+const int CTRL_U = 'U' - 'A' + 1;
+const int CTRL_W = 'W' - 'A' + 1;
 const int CTRL_L = 'L' - 'A' + 1;
+const int CTRL_N = 'N' - 'A' + 1;
 const int CTRL_X = 'X' - 'A' + 1;
+const int CTRL_Y = 'Y' - 'A' + 1;
 const int CTRL_Z = 'Z' - 'A' + 1;
 
 class TextIO {
 public:
-	TextIO(int fgcolor, int bgcolor, int hilite) {
+	enum COLOR {
+		WHITE = 1,
+		RED = 2
+	};
+
+	// A screen cell: a printable character and its color, see cell().
+	typedef chtype Cell;
+
+	// Where screen output goes and keys come from. Everything TextIO does goes through the current
+	// backend, which is the terminal (through curses) unless another one is installed, e.g. a
+	// FrameBuffer that keeps the screen in memory.
+	class Backend {
+	public:
+		virtual ~Backend() { }
+		virtual void clear() = 0;
+		virtual void move(int row, int col) = 0;
+		// Prints the first n characters of s at the cursor, or all of it if n is negative.
+		virtual void print(const char* s, int n, COLOR fcolor) = 0;
+		virtual void print(const Cell* cells, int n) = 0;
+		virtual void scrollRows(int top, int bottom, int n) = 0;
+		virtual void refresh() = 0;
+		// Returns the next key as the backend sees it, ERR if there's none in time.
+		virtual int getKey() = 0;
+		virtual void setInputTimeout(int milliseconds) = 0;
+		virtual bool waitForInput(int milliseconds) = 0;
+		virtual void getString(std::string& str) = 0;
+	};
+
+	// Sets up the terminal for the editor.
+	TextIO(int fgcolor, int bgcolor, int hilite) : previous_(nullptr), terminal_(true) {
 		initscr();
 		start_color();
 		cbreak();
@@ -26,39 +73,75 @@ public:
 		init_pair(COLOR::WHITE, fgcolor, bgcolor);
 		init_pair(COLOR::RED, hilite, bgcolor);
 		keypad(stdscr, TRUE);
+		idlok(stdscr, TRUE);	// let curses use the terminal's line insert/delete when scrolling
 		refresh();
+		putp(kBracketedPasteOn);	// have the terminal mark the start and end of pasted text
+	}
+
+	// Sends everything to backend instead of the terminal for as long as this object lives.
+	explicit TextIO(Backend& backend) : previous_(current()), terminal_(false) {
+		current() = &backend;
 	}
 
 	~TextIO() {
+		if (!terminal_) {
+			current() = previous_;
+			return;
+		}
+		putp(kBracketedPasteOff);
 		echo();
 		endwin();
 	}
 
 	static void clear() {
-		::clear();
+		current()->clear();
 	}
 
-	enum COLOR {
-		WHITE = 1,
-		RED = 2
-	};
-
 	static void print(char ch, COLOR fcolor = COLOR::WHITE) {
-		attron(COLOR_PAIR(fcolor));
-		addch(ch);
+		current()->print(&ch, 1, fcolor);
 	}
 
 	static void print(const std::string& s, COLOR fcolor = COLOR::WHITE) {
-		attron(COLOR_PAIR(fcolor));
-		addstr(s.c_str());
+		current()->print(s.c_str(), -1, fcolor);
+	}
+
+	// Prints the first n characters of s in one color with a single curses call.
+	static void print(const char* s, int n, COLOR fcolor = COLOR::WHITE) {
+		current()->print(s, n, fcolor);
+	}
+
+	// Makes a screen cell out of a printable character and its color, for print(const Cell*, int).
+	static Cell cell(char ch, COLOR fcolor = COLOR::WHITE) {
+		return static_cast<unsigned char>(ch) | COLOR_PAIR(fcolor);
+	}
+
+	// The character and color of a screen cell.
+	static char cellChar(Cell c) {
+		return static_cast<char>(c & A_CHARTEXT);
+	}
+	static COLOR cellColor(Cell c) {
+		return static_cast<COLOR>(PAIR_NUMBER(c & A_COLOR));
+	}
+
+	// Copies n prebuilt cells onto the screen starting at the cursor with a single curses call. The
+	// cursor doesn't move, and characters aren't interpreted, so cells must be printable characters.
+	static void print(const Cell* cells, int n) {
+		current()->print(cells, n);
+	}
+
+	// Scrolls rows top through bottom of the screen up by n rows (down if n is negative) using a
+	// scrolling region, so the rows that stay on the screen don't have to be sent again. The rows
+	// that scroll in are blank.
+	static void scrollRows(int top, int bottom, int n) {
+		current()->scrollRows(top, bottom, n);
 	}
 
 	static void refresh() {
-		::refresh();
+		current()->refresh();
 	}
 
 	static void move(int row, int col) {
-		::move(row, col);
+		current()->move(row, col);
 	}
 
 	/*
@@ -80,7 +163,7 @@ public:
 
 	static int getChar() {
 		int ch = 0;
-		ch = getch();
+		ch = current()->getKey();
 #ifdef _MBCS
 		const int kEnter = '\r';
 		const int kBackspace = '\b';
@@ -95,17 +178,104 @@ public:
 		return ch;
 	}
 
+	// Makes getChar() give up and return ERR after waiting milliseconds for a key
+	// A negative value makes getChar() wait for a key forever
+	static void setInputTimeout(int milliseconds) {
+		current()->setInputTimeout(milliseconds);
+	}
+
+	// Waits up to milliseconds for the terminal to have input for getChar().
+	// Returns true if there is input (or it can't tell), false if the time ran out.
+	static bool waitForInput(int milliseconds) {
+		return current()->waitForInput(milliseconds);
+	}
+
+	// Curses isn't thread safe, so when more than one thread uses the screen, each holds this lock
+	// around its curses calls.
+	static std::mutex& mutex() {
+		static std::mutex screen_mutex;
+		return screen_mutex;
+	}
+
 	static void getString(std::string& str) {
-		const int kMaxFilenameLength = 1024;
-		char temp[kMaxFilenameLength] = "";
-		echo();
-		getnstr(temp, kMaxFilenameLength);
-		noecho();
-		str = temp;
+		current()->getString(str);
 	}
 
+	// What the terminal sends before and after pasted text once bracketed paste is on.
+	static constexpr const char* kPasteStart = "\033[200~";
+	static constexpr const char* kPasteEnd = "\033[201~";
+
 private:
+	// The terminal, through curses.
+	class Curses : public Backend {
+	public:
+		void clear() override {
+			::clear();
+		}
+
+		void move(int row, int col) override {
+			::move(row, col);
+		}
+
+		void print(const char* s, int n, COLOR fcolor) override {
+			attron(COLOR_PAIR(fcolor));
+			addnstr(s, n);
+		}
+
+		void print(const Cell* cells, int n) override {
+			addchnstr(cells, n);
+		}
+
+		void scrollRows(int top, int bottom, int n) override {
+			scrollok(stdscr, TRUE);
+			setscrreg(top, bottom);
+			scrl(n);
+			scrollok(stdscr, FALSE);
+		}
+
+		void refresh() override {
+			::refresh();
+		}
+
+		int getKey() override {
+			return getch();
+		}
+
+		void setInputTimeout(int milliseconds) override {
+			timeout(milliseconds);
+		}
+
+		bool waitForInput(int milliseconds) override {
+#ifndef _MSC_VER
+			pollfd input = { STDIN_FILENO, POLLIN, 0 };
+			return poll(&input, 1, milliseconds) != 0;
+#else
+			return true;
+#endif
+		}
+
+		void getString(std::string& str) override {
+			const int kMaxFilenameLength = 1024;
+			char temp[kMaxFilenameLength] = "";
+			echo();
+			getnstr(temp, kMaxFilenameLength);
+			noecho();
+			str = temp;
+		}
+	};
+
+	// The backend in use, the terminal unless another one was installed.
+	static Backend*& current() {
+		static Curses terminal;
+		static Backend* backend = &terminal;
+		return backend;
+	}
+
 	static const int kDefaultPair = 1;
+	static constexpr const char* kBracketedPasteOn = "\033[?2004h";
+	static constexpr const char* kBracketedPasteOff = "\033[?2004l";
+	Backend* previous_;	// the backend to go back to when this object goes away
+	bool terminal_;	// true if this object set up the terminal
 };
 
 #endif // TEXTIO_H_
@@ -0,0 +1,128 @@
+#include "TextSearch.h"
+#include "SpellCheck.h"
+#include <string>
+#include <cstring> // for memcmp
+#include <cctype> // for tolower
+using namespace std;
+
+namespace
+{
+	const size_t BLOCK = 16; // bytes compared at once
+
+	char fold(char ch)
+	{
+		return static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+	}
+}
+
+TextSearch::TextSearch(const std::string& query, int options)
+	: m_query(query), m_folded(query), m_options(options)
+{
+	if (m_options & IGNORE_CASE)
+	{
+		for (char& ch : m_folded)
+			ch = fold(ch);
+	}
+}
+
+bool TextSearch::matchesAt(const char* text, size_t length, size_t pos) const
+{
+	const size_t size = m_folded.size();
+	if (size == 0 || pos + size > length)
+		return false;
+	if (m_options & IGNORE_CASE)
+	{
+		for (size_t i = 0; i < size; i++)
+		{
+			if (fold(text[pos + i]) != m_folded[i])
+				return false;
+		}
+	}
+	else if (memcmp(text + pos, m_folded.data(), size) != 0)
+		return false;
+	if (m_options & WHOLE_WORD)
+	{
+		if (pos > 0 && SpellCheck::isWordChar(text[pos - 1]) && SpellCheck::isWordChar(text[pos]))
+			return false;
+		if (pos + size < length && SpellCheck::isWordChar(text[pos + size]) && SpellCheck::isWordChar(text[pos + size - 1]))
+			return false;
+	}
+	return true;
+}
+
+size_t TextSearch::findScalar(const char* text, size_t length, size_t from, size_t end) const
+{
+	const char first = m_folded[0];
+	const bool ignoreCase = (m_options & IGNORE_CASE) != 0;
+	for (size_t pos = from; pos < end; pos++)
+	{
+		const char ch = ignoreCase ? fold(text[pos]) : text[pos];
+		if (ch == first && matchesAt(text, length, pos))
+			return pos;
+	}
+	return string::npos;
+}
+
+#ifdef __SSE2__
+// Finds the first match that starts in the block of BLOCK positions at pos, skipping the first skip of them
+size_t TextSearch::findInBlock(const char* text, size_t length, size_t pos, unsigned skip, const __m128i* filter) const
+{
+	const __m128i starts = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos));
+	const __m128i ends = _mm_loadu_si128(reinterpret_cast<const __m128i*>(text + pos + m_folded.size() - 1));
+	const __m128i startHits = _mm_or_si128(_mm_cmpeq_epi8(starts, filter[0]), _mm_cmpeq_epi8(starts, filter[1]));
+	const __m128i endHits = _mm_or_si128(_mm_cmpeq_epi8(ends, filter[2]), _mm_cmpeq_epi8(ends, filter[3]));
+	unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_and_si128(startHits, endHits)));
+	mask &= ~0u << skip;
+	while (mask != 0)
+	{
+		const size_t candidate = pos + __builtin_ctz(mask);
+		if (matchesAt(text, length, candidate))
+			return candidate;
+		mask &= mask - 1;
+	}
+	return string::npos;
+}
+#endif
+
+bool TextSearch::refines(const TextSearch& previous) const
+{
+	return !previous.m_query.empty() && m_options == previous.m_options && !(m_options & WHOLE_WORD) &&
+		m_query.compare(0, previous.m_query.size(), previous.m_query) == 0;
+}
+
+size_t TextSearch::find(const char* text, size_t length, size_t from) const
+{
+	// O(N) in the length of the text, plus the length of the query for every spot the filter lets through
+	const size_t size = m_folded.size();
+	if (size == 0 || size > length || from > length - size)
+		return string::npos;
+	const size_t last = length - size + 1; // one past the last position a match can start at
+#ifdef __SSE2__
+	if (last >= BLOCK)
+	{
+		// the first and last bytes of the query, in both cases if letters match either case
+		const bool ignoreCase = (m_options & IGNORE_CASE) != 0;
+		const char first = m_folded[0];
+		const char end = m_folded[size - 1];
+		const __m128i filter[4] = {
+			_mm_set1_epi8(first),
+			_mm_set1_epi8(ignoreCase ? static_cast<char>(toupper(static_cast<unsigned char>(first))) : first),
+			_mm_set1_epi8(end),
+			_mm_set1_epi8(ignoreCase ? static_cast<char>(toupper(static_cast<unsigned char>(end))) : end)
+		};
+		size_t pos = from;
+		for (; pos + BLOCK <= last; pos += BLOCK)
+		{
+			const size_t found = findInBlock(text, length, pos, 0, filter);
+			if (found != string::npos)
+				return found;
+		}
+		// the positions left over are covered by one more block that ends where the text does,
+		// overlapping the ones already checked
+		if (pos < last)
+			return findInBlock(text, length, last - BLOCK, static_cast<unsigned>(pos - (last - BLOCK)), filter);
+		return string::npos;
+	}
+#endif
+	return findScalar(text, length, from, last);
+}
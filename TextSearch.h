@@ -0,0 +1,51 @@
+#ifndef TEXTSEARCH_H_
+#define TEXTSEARCH_H_
+
+#include <string>
+#include <cstddef>
+#ifdef __SSE2__
+#include <emmintrin.h> // for the SSE2 intrinsics
+#endif
+
+// A query compiled for finding it in lines of text
+// Lines are scanned 16 positions at a time with SSE2 where it's available: a position can only start a
+// match if its byte equals the query's first byte and the byte where the match would end equals the
+// query's last byte, so both are compared for a whole block at once and only the positions where both
+// agree get the rest of the query compared
+class TextSearch {
+public:
+	enum Options
+	{
+		IGNORE_CASE = 1, // letters match either case
+		WHOLE_WORD = 2 // a match can't have word characters right before or after it
+	};
+
+	TextSearch(const std::string& query, int options);
+
+	const std::string& query() const { return m_query; }
+	int options() const { return m_options; }
+
+	// Returns the position of the first match in text[from, length), or std::string::npos if there's none
+	// Matches may overlap, so the next match after one at pos is found from pos + 1
+	size_t find(const char* text, size_t length, size_t from) const;
+
+	// Checks if there's a match at text[pos]
+	bool matchesAt(const char* text, size_t length, size_t pos) const;
+
+	// Checks if every match of this search is at a match of previous, so previous's matches can be
+	// refined rather than the text searched again: the options are the same and the query goes on from
+	// previous's. Not so for whole words, since the start of a word isn't a whole word where it's longer
+	bool refines(const TextSearch& previous) const;
+
+private:
+	std::string m_query;
+	std::string m_folded; // the query in lower case if letters match either case, else the query
+	int m_options;
+
+	size_t findScalar(const char* text, size_t length, size_t from, size_t end) const;
+#ifdef __SSE2__
+	size_t findInBlock(const char* text, size_t length, size_t pos, unsigned skip, const __m128i* filter) const;
+#endif
+};
+
+#endif // TEXTSEARCH_H_
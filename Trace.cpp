@@ -0,0 +1,168 @@
+#include "Trace.h"
+#include <atomic>
+#include <string>
+#include <vector>
+#include <mutex> // for std::mutex
+#include <chrono> // for std::chrono::steady_clock
+#include <fstream> // for file streams
+#include <cstdlib> // for getenv
+#include <cstdio> // for snprintf
+using namespace std;
+
+std::atomic<bool> Trace::s_enabled(false);
+
+namespace
+{
+	const size_t EVENTS_PER_THREAD = 8192; // a power of two, older events get overwritten
+
+	// One slot of a ring buffer, written like a seqlock: seq is odd while the owner writes the slot and
+	// 2 * (index + 1) once event number index is in it, so a reader can tell when it read a torn event
+	struct Event
+	{
+		atomic<uint64_t> seq;
+		atomic<const char*> name;
+		atomic<uint64_t> start;
+		atomic<uint64_t> duration;
+	};
+
+	struct ThreadBuffer
+	{
+		Event events[EVENTS_PER_THREAD];
+		atomic<uint64_t> written; // number of events ever written
+		int tid;
+		string name; // guarded by s_registryMutex
+		bool inUse; // guarded by s_registryMutex, false once the thread ended
+	};
+
+	// Every ring buffer ever handed out, buffers of threads that ended get handed to new threads
+	mutex s_registryMutex;
+	vector<ThreadBuffer*> s_buffers;
+
+	const chrono::steady_clock::time_point s_epoch = chrono::steady_clock::now();
+
+	string readOutputFile()
+	{
+		const char* file = getenv("WURD_TRACE");
+		if (file == nullptr || *file == '\0')
+			return "";
+		Trace::enable(true);
+		return file;
+	}
+
+	const string s_outputFile = readOutputFile();
+
+	// Hands the calling thread its ring buffer, and gives it back when the thread ends
+	class ThreadBufferHolder
+	{
+	public:
+		ThreadBufferHolder()
+		{
+			lock_guard<mutex> lock(s_registryMutex);
+			for (ThreadBuffer* buffer : s_buffers)
+			{
+				if (!buffer->inUse)
+				{
+					m_buffer = buffer;
+					m_buffer->written.store(0, memory_order_relaxed);
+					m_buffer->name.clear();
+					m_buffer->inUse = true;
+					return;
+				}
+			}
+			m_buffer = new ThreadBuffer();
+			m_buffer->written.store(0, memory_order_relaxed);
+			m_buffer->tid = static_cast<int>(s_buffers.size()) + 1;
+			m_buffer->inUse = true;
+			s_buffers.push_back(m_buffer);
+		}
+		~ThreadBufferHolder()
+		{
+			lock_guard<mutex> lock(s_registryMutex);
+			m_buffer->inUse = false;
+		}
+		ThreadBuffer* get() const { return m_buffer; }
+	private:
+		ThreadBuffer* m_buffer;
+	};
+
+	ThreadBuffer* threadBuffer()
+	{
+		thread_local ThreadBufferHolder holder;
+		return holder.get();
+	}
+}
+
+const std::string& Trace::outputFile()
+{
+	return s_outputFile;
+}
+
+uint64_t Trace::now()
+{
+	return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - s_epoch).count();
+}
+
+void Trace::nameThread(const char* name)
+{
+	ThreadBuffer* buffer = threadBuffer();
+	lock_guard<mutex> lock(s_registryMutex);
+	buffer->name = name;
+}
+
+void Trace::record(const char* name, uint64_t start, uint64_t end)
+{
+	// O(1), only the owning thread writes to its buffer
+	ThreadBuffer* buffer = threadBuffer();
+	const uint64_t index = buffer->written.load(memory_order_relaxed);
+	Event& event = buffer->events[index & (EVENTS_PER_THREAD - 1)];
+	event.seq.store(2 * index + 1, memory_order_relaxed);
+	atomic_thread_fence(memory_order_release);
+	event.name.store(name, memory_order_relaxed);
+	event.start.store(start, memory_order_relaxed);
+	event.duration.store(end - start, memory_order_relaxed);
+	event.seq.store(2 * index + 2, memory_order_release);
+	buffer->written.store(index + 1, memory_order_release);
+}
+
+bool Trace::dump(const std::string& file)
+{
+	ofstream outfile(file);
+	if (!outfile)
+		return false;
+
+	lock_guard<mutex> lock(s_registryMutex); // keeps buffers from being handed to new threads meanwhile
+	outfile << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [" << endl;
+	bool first = true;
+	char line[256];
+	for (ThreadBuffer* buffer : s_buffers)
+	{
+		if (!buffer->name.empty())
+		{
+			snprintf(line, sizeof(line), "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %d, \"args\": {\"name\": \"%s\"}}",
+				buffer->tid, buffer->name.c_str());
+			outfile << (first ? "" : ",\n") << line;
+			first = false;
+		}
+		const uint64_t written = buffer->written.load(memory_order_acquire);
+		const uint64_t oldest = written > EVENTS_PER_THREAD ? written - EVENTS_PER_THREAD : 0;
+		for (uint64_t index = oldest; index < written; index++)
+		{
+			const Event& event = buffer->events[index & (EVENTS_PER_THREAD - 1)];
+			const uint64_t seq = event.seq.load(memory_order_acquire);
+			if (seq != 2 * index + 2) // overwritten since
+				continue;
+			const char* name = event.name.load(memory_order_relaxed);
+			const uint64_t start = event.start.load(memory_order_relaxed);
+			const uint64_t duration = event.duration.load(memory_order_relaxed);
+			atomic_thread_fence(memory_order_acquire);
+			if (event.seq.load(memory_order_relaxed) != seq) // torn while we read it
+				continue;
+			snprintf(line, sizeof(line), "{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %d, \"ts\": %.3f, \"dur\": %.3f}",
+				name, buffer->tid, start / 1000.0, duration / 1000.0);
+			outfile << (first ? "" : ",\n") << line;
+			first = false;
+		}
+	}
+	outfile << "\n]}" << endl;
+	return static_cast<bool>(outfile);
+}
@@ -2,6 +2,9 @@
 #define UNDO_H_
 
 #include <string>
+#include <vector>
+
+class MemoryReport;
 
 class Undo {
 public:
@@ -10,15 +13,28 @@ public:
 		INSERT = 1,
 		SPLIT = 2,
 		DELETE = 3,
-		JOIN = 4	// deleting last character on line to join with below line; backspacing backward on first character on the line to join with above line	
+		JOIN = 4,	// deleting last character on line to join with below line; backspacing backward on first character on the line to join with above line	
+		REPLACE = 5	// replacing whole lines at once, e.g. pasting text
 	};
 
 	Undo() { }
 	virtual ~Undo() { }
 
 	virtual void submit(const Action action, int row, int col, char ch = 0) = 0;
+	// Records that count lines starting at row replaced oldLines, and that the cursor was at row, col before.
+	// get() hands it back as REPLACE with the same row, col and count, and the old lines in lines (or in text,
+	// separated by '\n', without lines).
+	virtual void submitReplace(int row, int col, int count, std::vector<std::string> oldLines) = 0;
 	virtual Action get(int& row, int& col, int& count, std::string& text) = 0;
+	virtual Action get(int& row, int& col, int& count, std::string& text, std::vector<std::string>& lines) = 0;
+	// Entries submitted between beginGroup() and endGroup() are one step: get() still hands them back one at
+	// a time, and grouped() is true while the one it handed back last has more of its step under it.
+	virtual void beginGroup() = 0;
+	virtual void endGroup() = 0;
+	virtual bool grouped() const = 0;
 	virtual void clear() = 0;
+	// Adds what the undo history takes up to report, under "undo".
+	virtual void reportMemory(MemoryReport& report) const = 0;
 };
 
 Undo* createUndo();
@@ -0,0 +1,181 @@
+#include "WordIndex.h"
+#include "MemoryReport.h"
+#include "SpellCheck.h"
+#include <string>
+#include <vector>
+#include <algorithm> // for std::sort
+#include <cctype> // for tolower
+using namespace std;
+
+namespace
+{
+	string lowerCase(const string& word)
+	{
+		string lower = word;
+		for (char& ch : lower)
+			ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+		return lower;
+	}
+}
+
+WordIndex::WordIndex()
+	: m_lines(0x1dea)
+{
+}
+
+void WordIndex::clear()
+{
+	m_lines.clear();
+	m_numbers.clear();
+	m_postings.clear();
+}
+
+void WordIndex::replace(int first, int oldCount, LineStore::const_iterator lines, int count)
+{
+	// the old nodes are reused for the new lines in order, so a line that was only edited keeps the
+	// postings of the words still on it, and the ones left over take their lines off their words' lists
+	vector<int> found; // kept between lines so its buffer is reused
+	vector<Entry> words;
+	vector<Entry> none;
+	m_lines.replaceNodes(first, oldCount, count, [&](int, Node* node)
+	{
+		tokenize(*lines, found, words);
+		++lines;
+		setWords(node, words);
+	}, [&](Node* node) { setWords(node, none); });
+}
+
+long WordIndex::count(const std::string& word) const
+{
+	const Postings* postings = postingsOf(word);
+	return postings != nullptr ? postings->count : 0;
+}
+
+long WordIndex::find(const std::string& word, std::vector<int>& rows) const
+{
+	rows.clear();
+	const Postings* postings = postingsOf(word);
+	if (postings == nullptr)
+		return 0;
+	rows.reserve(postings->lines.size());
+	for (const Node* node : postings->lines)
+		rows.push_back(Lines::indexOf(node));
+	sort(rows.begin(), rows.end());
+	return postings->count;
+}
+
+void WordIndex::reportMemory(MemoryReport& report) const
+{
+	// O(n + W) where W is the number of different words
+	size_t bytes = sizeof(*this) - sizeof(m_lines) + m_lines.bytes();
+	m_lines.forEach([&](const vector<Entry>& words) { bytes += MemoryReport::heapBytes(words); });
+	bytes += MemoryReport::hashMapBytes(m_numbers) + MemoryReport::heapBytes(m_postings);
+	for (const auto& number : m_numbers)
+		bytes += MemoryReport::heapBytes(number.first) + MemoryReport::heapBytes(m_postings[number.second].lines);
+	report.addBytes("text", "word index", bytes);
+	report.addCount("text", "indexed words", m_numbers.size());
+}
+
+std::vector<WordIndex::Entry>::iterator WordIndex::entryOf(Node* node, int word)
+{
+	return lower_bound(node->item.begin(), node->item.end(), word,
+		[](const Entry& entry, int number) { return entry.word < number; });
+}
+
+const WordIndex::Postings* WordIndex::postingsOf(const std::string& word) const
+{
+	auto found = m_numbers.find(lowerCase(word));
+	return found != m_numbers.end() ? &m_postings[found->second] : nullptr;
+}
+
+void WordIndex::tokenize(const std::string& line, std::vector<int>& found, std::vector<Entry>& words)
+{
+	// O(L + W log W) where L is the length of the line and W is the number of words on it
+	found.clear();
+	string word;
+	for (size_t i = 0; i < line.size(); )
+	{
+		if (!SpellCheck::isWordChar(line[i]))
+		{
+			i++;
+			continue;
+		}
+		size_t end = i;
+		while (end < line.size() && SpellCheck::isWordChar(line[end]))
+			end++;
+		word.assign(line, i, end - i);
+		for (char& ch : word)
+			ch = static_cast<char>(tolower(static_cast<unsigned char>(ch)));
+		auto number = m_numbers.find(word);
+		if (number == m_numbers.end())
+		{
+			number = m_numbers.emplace(word, static_cast<int>(m_postings.size())).first;
+			m_postings.push_back(Postings{ vector<Node*>(), 0 });
+		}
+		found.push_back(number->second);
+		i = end;
+	}
+	sort(found.begin(), found.end());
+	words.clear();
+	for (int number : found)
+	{
+		if (!words.empty() && words.back().word == number)
+			words.back().count++;
+		else
+			words.push_back(Entry{ number, 1, 0 });
+	}
+}
+
+// Gives node the words of its new line, touching only the posting lists of the words that changed
+void WordIndex::setWords(Node* node, std::vector<Entry>& words)
+{
+	if (node->item.empty()) // a new line, every word is new
+	{
+		for (Entry& entry : words)
+			addPosting(node, entry);
+		node->item.assign(words.begin(), words.end()); // a copy that's only as big as it has to be
+		return;
+	}
+	vector<Entry> merged;
+	merged.reserve(words.size());
+	size_t o = 0;
+	size_t n = 0;
+	while (o < node->item.size() || n < words.size())
+	{
+		if (n == words.size() || (o < node->item.size() && node->item[o].word < words[n].word))
+			removePosting(node, node->item[o++]);
+		else if (o == node->item.size() || words[n].word < node->item[o].word)
+		{
+			addPosting(node, words[n]);
+			merged.push_back(words[n++]);
+		}
+		else // on the line before and after, only the count can change
+		{
+			Entry& entry = node->item[o++];
+			m_postings[entry.word].count += words[n++].count - entry.count;
+			entry.count = words[n - 1].count;
+			merged.push_back(entry);
+		}
+	}
+	node->item = std::move(merged);
+}
+
+void WordIndex::addPosting(Node* node, Entry& entry)
+{
+	Postings& postings = m_postings[entry.word];
+	entry.slot = static_cast<int>(postings.lines.size());
+	postings.lines.push_back(node);
+	postings.count += entry.count;
+}
+
+void WordIndex::removePosting(Node* node, const Entry& entry)
+{
+	// O(log W) to find the entry of the line that moves into the freed slot
+	Postings& postings = m_postings[entry.word];
+	Node* moved = postings.lines.back();
+	postings.lines[entry.slot] = moved;
+	postings.lines.pop_back();
+	postings.count -= entry.count;
+	if (moved != node)
+		entryOf(moved, entry.word)->slot = entry.slot;
+}
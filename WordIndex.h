@@ -0,0 +1,85 @@
+#ifndef WORDINDEX_H_
+#define WORDINDEX_H_
+
+#include <string>
+#include <vector>
+#include "LineStore.h"
+#include "ImplicitTreap.h"
+#include <unordered_map>
+#include <cstddef>
+
+class MemoryReport;
+
+// Which lines of a document each word is on, kept up to date as lines change
+// Words are split out the same way the spell checker splits them and compared in lower case. Lines
+// are kept in document order in an ImplicitTreap, whose parent links work out a line's row from its
+// node in O(log n), so lines can be replaced without renumbering the ones after them; every word
+// gets a number the first time it's seen and a posting list of the nodes of the lines it's on, and
+// every node knows where it sits in the posting list of each of its words, so a line comes off a
+// list in O(1)
+class WordIndex {
+public:
+	WordIndex();
+	WordIndex(const WordIndex&) = delete;
+	WordIndex& operator=(const WordIndex&) = delete;
+
+	void clear();
+
+	// Lines [first, first+oldCount) were replaced by the count lines starting at lines
+	// O(log n) plus the length of the new lines; a line that was replaced by one line only touches
+	// the posting lists of the words whose counts changed on it
+	void replace(int first, int oldCount, LineStore::const_iterator lines, int count);
+
+	// How many times word appears in the document, O(1)
+	long count(const std::string& word) const;
+
+	// Puts the rows word is on onto rows, in order, and returns how many times it appears
+	// O(R log n) where R is the number of rows it's on
+	long find(const std::string& word, std::vector<int>& rows) const;
+
+	int lines() const { return m_lines.size(); }
+
+	// Adds what the index takes up to report, under "text"
+	void reportMemory(MemoryReport& report) const;
+
+private:
+	struct Entry
+	{
+		int word; // the word's number
+		int count; // times it appears on the line
+		int slot; // where the line is in the word's posting list
+	};
+
+	// A line's words, sorted by number; nothing is summed up but how many lines there are
+	struct LineSummary
+	{
+		typedef std::vector<Entry> Item;
+		struct Sum {};
+		static Sum sumOf(const Item&) { return Sum(); }
+		static void add(Sum&, const Sum&) {}
+	};
+	typedef ImplicitTreap<LineSummary> Lines;
+	typedef Lines::Node Node;
+
+	struct Postings
+	{
+		std::vector<Node*> lines; // in no particular order
+		long count; // times the word appears in all of them
+	};
+
+	static std::vector<Entry>::iterator entryOf(Node* node, int word);
+	const Postings* postingsOf(const std::string& word) const;
+
+	// Puts the words of line onto words in order, each once with how many times it's there, numbering
+	// words not seen before; found is scratch space
+	void tokenize(const std::string& line, std::vector<int>& found, std::vector<Entry>& words);
+	void setWords(Node* node, std::vector<Entry>& words);
+	void addPosting(Node* node, Entry& entry);
+	void removePosting(Node* node, const Entry& entry);
+
+	Lines m_lines;
+	std::unordered_map<std::string, int> m_numbers; // every word seen so far, in lower case
+	std::vector<Postings> m_postings; // by number, empty for words no longer in the document
+};
+
+#endif // WORDINDEX_H_
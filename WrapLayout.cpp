@@ -0,0 +1,22 @@
+#include "WrapLayout.h"
+#include "LineStore.h"
+#include <string>
+#include <vector>
+using namespace std;
+
+void WrapLayout::reset(int width, const std::vector<std::string>& lines)
+{
+	m_rows.clear();
+	m_width = width > 0 ? width : 1;
+	replace(0, 0, lines);
+}
+
+void WrapLayout::replace(int first, int oldCount, const std::vector<std::string>& lines)
+{
+	m_rows.replaceFrom(first, oldCount, lines.begin(), lines.size(), [this](const string& line) { return rowsFor(line.size()); });
+}
+
+void WrapLayout::replace(int first, int oldCount, LineStore::const_iterator line, int count)
+{
+	m_rows.replaceFrom(first, oldCount, line, count, [this](const string& line) { return rowsFor(line.size()); });
+}
@@ -0,0 +1,112 @@
+#ifndef WRAPLAYOUT_H_
+#define WRAPLAYOUT_H_
+
+#include "ImplicitTreap.h"
+#include "LineStore.h"
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <utility> // for std::swap
+
+// Where each line of a document goes on the screen when long lines wrap onto the rows below them
+// Lines are kept in document order in an ImplicitTreap that knows, for every subtree, how many lines
+// and how many screen rows are under it; those sums are the prefix-sum index that takes a line to its
+// first screen row and a screen row back to its line in O(log n), and that lets lines be replaced,
+// added or removed in O(log n) each without touching the rows of any other line
+class WrapLayout {
+public:
+	WrapLayout() : m_rows(0x5eed), m_width(1) {}
+
+	// Lay out a whole document for a window width columns wide, O(n)
+	void reset(int width, const std::vector<std::string>& lines);
+
+	// Lines [first, first+oldCount) were replaced by lines; only the new lines are laid out
+	void replace(int first, int oldCount, const std::vector<std::string>& lines);
+	// The same for the count lines starting at line, which are read where they are rather than copied
+	void replace(int first, int oldCount, LineStore::const_iterator line, int count);
+
+	// The lines from first on were put in a new order, the ith being the one that was order[i]th, so
+	// their rows move with them, O(log n + count)
+	void reorder(int first, const std::vector<size_t>& order) { m_rows.reorder(first, order); }
+
+	// How many screen rows a line of length characters takes; the cursor can sit after the last
+	// character, so a line that exactly fills its rows gets one more
+	int rowsFor(size_t length) const { return static_cast<int>(length / m_width) + 1; }
+
+	// Trade layouts with other, O(1)
+	void swap(WrapLayout& other)
+	{
+		m_rows.swap(other.m_rows);
+		std::swap(m_width, other.m_width);
+	}
+
+	int width() const { return m_width; }
+	int lines() const { return m_rows.size(); }
+	long rows() const { return m_rows.total(); }
+
+	// The screen row (counted from the top of the document) that a line starts on
+	long rowOf(int line) const
+	{
+		long row = 0;
+		for (const Node* node = m_rows.root(); node != nullptr; )
+		{
+			const int left = Rows::sizeOf(node->left);
+			if (line < left)
+				node = node->left;
+			else if (line == left)
+				return row + Rows::sumOf(node->left);
+			else
+			{
+				row += Rows::sumOf(node->left) + node->item;
+				line -= left + 1;
+				node = node->right;
+			}
+		}
+		return row;
+	}
+
+	// The line a screen row belongs to, and which of that line's rows it is; rows past the end belong
+	// to the last line
+	int lineAt(long row, int& within) const
+	{
+		int line = 0;
+		within = 0;
+		for (const Node* node = m_rows.root(); node != nullptr; )
+		{
+			const long left = Rows::sumOf(node->left);
+			if (row < left)
+				node = node->left;
+			else if (row < left + node->item || node->right == nullptr)
+			{
+				within = static_cast<int>(row - left < node->item ? row - left : node->item - 1);
+				return line + Rows::sizeOf(node->left);
+			}
+			else
+			{
+				row -= left + node->item;
+				line += Rows::sizeOf(node->left) + 1;
+				node = node->right;
+			}
+		}
+		return line;
+	}
+
+	size_t bytes() const { return sizeof(*this) - sizeof(m_rows) + m_rows.bytes(); }
+
+private:
+	// A line's screen rows, summed over subtrees
+	struct RowSummary
+	{
+		typedef int Item;
+		typedef long Sum;
+		static long sumOf(int rows) { return rows; }
+		static void add(long& sum, long more) { sum += more; }
+	};
+	typedef ImplicitTreap<RowSummary> Rows;
+	typedef Rows::Node Node;
+
+	Rows m_rows;
+	int m_width;
+};
+
+#endif // WRAPLAYOUT_H_
@@ -0,0 +1,107 @@
+// dictbench: compares a flat dictionary with its stem+affix compressed version
+//
+// Usage: dictbench <flat list> <.dic file> <text file>
+// Reports load time, trie size and lookup cost of both dictionaries, for every word of the text
+// file and for every word of the flat list (which makes the affixed dictionary strip affixes),
+// and checks that both dictionaries agree on every one of those words.
+
+#include "Dictionary.h"
+#include "SpellCheck.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+using namespace std;
+
+static double secondsSince(chrono::steady_clock::time_point start)
+{
+	return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+static void readWords(const string& file, bool wholeLines, vector<string>& words)
+{
+	ifstream infile(file);
+	string line;
+	while (getline(infile, line))
+	{
+		if (wholeLines)
+		{
+			if (!line.empty())
+				words.push_back(line);
+			continue;
+		}
+		string word;
+		for (char c : line)
+		{
+			if (SpellCheck::isWordChar(c))
+				word += c;
+			else if (!word.empty())
+			{
+				words.push_back(word);
+				word.clear();
+			}
+		}
+		if (!word.empty())
+			words.push_back(word);
+	}
+}
+
+// Looks every word up a few times, returns nanoseconds per lookup
+static double timeLookups(const Dictionary& dict, const vector<string>& words, size_t& hits)
+{
+	const int kRounds = 3;
+	hits = 0;
+	auto start = chrono::steady_clock::now();
+	for (int round = 0; round < kRounds; round++)
+	{
+		for (const string& word : words)
+			hits += dict.search(word);
+	}
+	hits /= kRounds;
+	return secondsSince(start) * 1e9 / (static_cast<double>(words.size()) * kRounds);
+}
+
+static void report(const char* name, const string& file, const vector<string>& text, const vector<string>& list, Dictionary& dict)
+{
+	auto start = chrono::steady_clock::now();
+	if (!dict.build(file))
+	{
+		cerr << "Cannot load " << file << endl;
+		exit(1);
+	}
+	double loadSeconds = secondsSince(start);
+	size_t textHits, listHits;
+	double textNs = timeLookups(dict, text, textHits);
+	double listNs = timeLookups(dict, list, listHits);
+	cout << name << ": load " << loadSeconds * 1000 << " ms, " << dict.nodeCount() << " trie nodes, "
+		<< dict.nodeCount() * Dictionary::nodeSize() / (1024.0 * 1024.0) << " MiB, "
+		<< textNs << " ns/lookup on text (" << textHits << " hits), "
+		<< listNs << " ns/lookup on word list (" << listHits << " hits)" << endl;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 4)
+	{
+		cerr << "Usage: " << argv[0] << " <flat list> <.dic file> <text file>" << endl;
+		return 1;
+	}
+	vector<string> text, list;
+	readWords(argv[3], false, text);
+	readWords(argv[1], true, list);
+
+	Dictionary flat, affixed;
+	report("flat   ", argv[1], text, list, flat);
+	report("affixed", argv[2], text, list, affixed);
+	cout << "memory saved: " << 100.0 * (1.0 - static_cast<double>(affixed.nodeCount()) / flat.nodeCount()) << "%" << endl;
+
+	size_t disagreements = 0;
+	for (const vector<string>* words : { &text, &list })
+	{
+		for (const string& word : *words)
+			disagreements += flat.search(word) != affixed.search(word);
+	}
+	cout << "disagreements: " << disagreements << endl;
+	return disagreements == 0 ? 0 : 1;
+}
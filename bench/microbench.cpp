@@ -0,0 +1,659 @@
+// microbench: times the editor's hot paths and prints the results as JSON
+//
+// Usage: microbench <dictionary> <short text file> <long text file>
+// The benchmarks, by the first part of their names:
+//	editor/     StudentTextEditor load, insert, enter, backspace, del and getLines, on generated documents
+//	            of several sizes and line lengths and on both text files
+//	find/       an incremental find in the long text: its first key, the keys after it, whole scans
+//	replace/    replacing every match of a regular expression in the long text, and undoing it
+//	index/      the long text's word index: building it and looking words up (editing with it on is
+//	            editor/*/long/indexed)
+//	reload/     reloading the long text after scattered changes: diffing and replacing lines
+//	snapshot/   taking a snapshot of the long text, and the first edit after one
+//	packed/     the long text with its lines compressed: packing it, reading and typing on rows spread
+//	            over it
+//	stats/      the long text's statistics: counting all of it, and recounting a line a key changed
+//	transform/  sorting, deduplicating, filtering and reindenting the long text's lines
+//	undo/       StudentUndo submit and get
+//	spellcheck/ StudentSpellCheck load, dictionary search, spellCheck of correct and misspelled words,
+//	            spellCheckLine, and spellCheckRange on one row of a very long line
+// Every benchmark is run several times and the fastest run counts, to keep the numbers steady. The
+// output always lists the same benchmarks in the same order, with one benchmark per line, so two runs
+// can be diffed.
+
+#include "TextEditor.h"
+#include "Undo.h"
+#include "SpellCheck.h"
+#include "Dictionary.h"
+#include "TextSearch.h"
+#include "Regex.h"
+#include "LineDiff.h"
+#include "DocStats.h"
+#include "LineTransform.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <set>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <cctype>
+#include <cstdio>
+using namespace std;
+
+struct Result
+{
+	string name;
+	long iterations;
+	double nsPerOp;
+};
+
+static vector<Result> results;
+
+// Runs body rounds times, each time timing only what body does between start() and stop(), and
+// records the fastest round per operation
+class Timer
+{
+public:
+	void start() { m_start = chrono::steady_clock::now(); }
+	void stop() { m_ns += chrono::duration<double, nano>(chrono::steady_clock::now() - m_start).count(); }
+	double ns() const { return m_ns; }
+	void reset() { m_ns = 0; }
+private:
+	chrono::steady_clock::time_point m_start;
+	double m_ns = 0;
+};
+
+static void measure(const string& name, int rounds, long opsPerRound, const function<void(Timer&)>& body)
+{
+	double best = -1;
+	for (int r = 0; r < rounds; r++)
+	{
+		Timer timer;
+		body(timer);
+		if (best < 0 || timer.ns() < best)
+			best = timer.ns();
+	}
+	results.push_back({ name, opsPerRound, best / opsPerRound });
+	cerr << name << ": " << best / opsPerRound << " ns/op" << endl;
+}
+
+static bool readLines(const string& file, vector<string>& lines)
+{
+	ifstream infile(file);
+	if (!infile)
+		return false;
+	string line;
+	while (getline(infile, line))
+	{
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.pop_back();
+		lines.push_back(line);
+	}
+	return true;
+}
+
+static void splitWords(const string& line, vector<string>& words)
+{
+	string word;
+	for (char c : line + " ")
+	{
+		if (SpellCheck::isWordChar(c))
+			word += c;
+		else if (!word.empty())
+		{
+			words.push_back(word);
+			word.clear();
+		}
+	}
+}
+
+// Puts the cursor on the middle row of the document, in the middle of the line
+static void goToMiddle(TextEditor* te)
+{
+	const int middle = te->snapshot().size() / 2;
+	vector<string> line;
+	te->getLines(middle, 1, line);
+	te->setPos(middle, line.empty() ? 0 : static_cast<int>(line[0].size() / 2));
+}
+
+// Finds query the way an incremental find does as it's typed a key at a time, refining the matches
+// when the search allows it, and checks it ends up with the matches findAll() does. Whole words are
+// the case that can't be refined: "the" is a whole word in "then the" where "then" isn't
+static bool checkIncrementalFind(const string& text, const string& query, int options)
+{
+	Undo* undo = createUndo();
+	TextEditor* te = createTextEditor(undo);
+	te->insertText(text);
+	vector<TextEditor::Match> matches;
+	TextSearch found("", options);
+	for (size_t i = 1; i <= query.size(); i++)
+	{
+		const TextSearch search(query.substr(0, i), options);
+		if (search.refines(found))
+			te->refineMatches(search, matches);
+		else
+			te->findAll(search, matches);
+		found = search;
+	}
+	vector<TextEditor::Match> all;
+	te->findAll(found, all);
+	delete te;
+	delete undo;
+	const bool same = matches.size() == all.size() && equal(matches.begin(), matches.end(), all.begin(),
+		[](const TextEditor::Match& a, const TextEditor::Match& b) { return a.row == b.row && a.col == b.col; });
+	if (!same)
+		cerr << "Typing \"" << query << "\" found " << matches.size() << " matches, findAll " << all.size() << endl;
+	return same;
+}
+
+// The editing benchmarks for one document, made by setUp
+static void benchEditor(const string& label, const function<void(TextEditor*)>& setUp)
+{
+	const int kRounds = 200;
+	const int kBatch = 64; // edits per round, small enough that the line barely changes length
+	Undo* undo = createUndo();
+	TextEditor* te = createTextEditor(undo);
+	setUp(te);
+	goToMiddle(te);
+
+	measure("editor/insert/" + label, kRounds, kBatch, [&](Timer& t)
+	{
+		t.start();
+		for (int i = 0; i < kBatch; i++)
+			te->insert('x');
+		t.stop();
+		for (int i = 0; i < kBatch; i++)
+			te->backspace();
+	});
+	measure("editor/backspace/" + label, kRounds, kBatch, [&](Timer& t)
+	{
+		for (int i = 0; i < kBatch; i++)
+			te->insert('x');
+		t.start();
+		for (int i = 0; i < kBatch; i++)
+			te->backspace();
+		t.stop();
+	});
+	measure("editor/del/" + label, kRounds, kBatch, [&](Timer& t)
+	{
+		for (int i = 0; i < kBatch; i++)
+			te->insert('x');
+		for (int i = 0; i < kBatch; i++)
+			te->move(TextEditor::Dir::LEFT);
+		t.start();
+		for (int i = 0; i < kBatch; i++)
+			te->del();
+		t.stop();
+	});
+	measure("editor/enter/" + label, kRounds, kBatch, [&](Timer& t)
+	{
+		t.start();
+		for (int i = 0; i < kBatch; i++)
+			te->enter();
+		t.stop();
+		for (int i = 0; i < kBatch; i++)
+			te->backspace();
+	});
+	measure("editor/getLines60/" + label, kRounds, kBatch, [&](Timer& t)
+	{
+		int row, col;
+		te->getPos(row, col);
+		vector<string> lines;
+		t.start();
+		for (int i = 0; i < kBatch; i++)
+			te->getLines(max(0, row - 30), 60, lines);
+		t.stop();
+	});
+	delete te;
+	delete undo;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 4)
+	{
+		cerr << "Usage: " << argv[0] << " <dictionary> <short text file> <long text file>" << endl;
+		return 1;
+	}
+	const string dictionaryFile = argv[1];
+	const string texts[] = { argv[2], argv[3] };
+	const string textNames[] = { "short", "long" };
+	vector<string> textLines[2];
+	for (int i = 0; i < 2; i++)
+	{
+		if (!readLines(texts[i], textLines[i]))
+		{
+			cerr << "Cannot open " << texts[i] << endl;
+			return 1;
+		}
+	}
+
+	// Text editor, on generated documents and on the text files
+	const int kSizes[] = { 1000, 20000 };
+	const int kLengths[] = { 16, 80, 1000 };
+	for (int lines : kSizes)
+	{
+		for (int length : kLengths)
+		{
+			benchEditor("lines=" + to_string(lines) + "/length=" + to_string(length), [=](TextEditor* te)
+			{
+				string line;
+				for (int i = 0; i < length; i++)
+					line += (i % 6 == 5) ? ' ' : static_cast<char>('a' + i % 26);
+				string text;
+				for (int i = 0; i < lines; i++)
+					text += line + (i + 1 < lines ? "\n" : "");
+				te->insertText(text);
+			});
+		}
+	}
+	for (int i = 0; i < 2; i++)
+	{
+		Undo* undo = createUndo();
+		TextEditor* te = createTextEditor(undo);
+		measure("editor/load/" + textNames[i], 5, 1, [&](Timer& t)
+		{
+			t.start();
+			te->load(texts[i]);
+			t.stop();
+		});
+		delete te;
+		delete undo;
+		benchEditor(textNames[i], [&](TextEditor* te) { te->load(texts[i]); });
+	}
+
+	// Finding, in the long text: the first key of an incremental find searches everything, the keys
+	// after it only check the matches there already were
+	if (!checkIncrementalFind("then the", "then", TextSearch::WHOLE_WORD) ||
+		!checkIncrementalFind("then the", "then", 0))
+		return 1;
+	{
+		Undo* undo = createUndo();
+		TextEditor* te = createTextEditor(undo);
+		te->load(texts[1]);
+		vector<TextEditor::Match> matches;
+		const string query = "Natasha";
+		measure("find/findAll/first-key", 5, 1, [&](Timer& t)
+		{
+			t.start();
+			te->findAll(TextSearch(query.substr(0, 1), 0), matches);
+			t.stop();
+		});
+		measure("find/refineMatches/next-keys", 5, query.size() - 1, [&](Timer& t)
+		{
+			te->findAll(TextSearch(query.substr(0, 1), 0), matches);
+			t.start();
+			for (size_t i = 2; i <= query.size(); i++)
+				te->refineMatches(TextSearch(query.substr(0, i), 0), matches);
+			t.stop();
+		});
+		measure("find/findAll/whole-word-any-case", 5, 1, [&](Timer& t)
+		{
+			t.start();
+			te->findAll(TextSearch("prince", TextSearch::IGNORE_CASE | TextSearch::WHOLE_WORD), matches);
+			t.stop();
+		});
+		measure("find/findAll/no-matches", 5, 1, [&](Timer& t)
+		{
+			t.start();
+			te->findAll(TextSearch("qzxj", 0), matches);
+			t.stop();
+		});
+		delete te;
+		delete undo;
+	}
+
+	// Replacing every match of a regular expression in the long text, and undoing all of it
+	{
+		Undo* undo = createUndo();
+		TextEditor* te = createTextEditor(undo);
+		Regex regex;
+		string error;
+		regex.compile("(Natasha|Pierre)('s)?", error);
+		measure("replace/replaceAll/names", 5, 1, [&](Timer& t)
+		{
+			te->load(texts[1]);
+			t.start();
+			te->replaceAll(regex, "<$0>");
+			t.stop();
+		});
+		measure("replace/undo/names", 5, 1, [&](Timer& t)
+		{
+			te->load(texts[1]);
+			te->replaceAll(regex, "<$0>");
+			t.start();
+			te->undo();
+			t.stop();
+		});
+		regex.compile("\\d+", error);
+		measure("replace/replaceAll/numbers", 5, 1, [&](Timer& t)
+		{
+			te->load(texts[1]);
+			t.start();
+			te->replaceAll(regex, "#");
+			t.stop();
+		});
+		delete te;
+		delete undo;
+	}
+
+	// The word index of the long text: building it, looking words up in it, and what keeping it up to
+	// date adds to every edit
+	{
+		Undo* undo = createUndo();
+		measure("index/indexWords/long", 5, 1, [&](Timer& t)
+		{
+			TextEditor* te = createTextEditor(undo);
+			te->load(texts[1]);
+			t.start();
+			te->indexWords();
+			t.stop();
+			delete te;
+		});
+		TextEditor* te = createTextEditor(undo);
+		te->load(texts[1]);
+		te->indexWords();
+		vector<int> rows;
+		measure("index/findWord/common", 5, 1, [&](Timer& t)
+		{
+			t.start();
+			te->findWord("the", rows);
+			t.stop();
+		});
+		measure("index/findWord/rare", 5, 1, [&](Timer& t)
+		{
+			t.start();
+			te->findWord("Natasha", rows);
+			t.stop();
+		});
+		delete te;
+		delete undo;
+		benchEditor("long/indexed", [&](TextEditor* te) { te->load(texts[1]); te->indexWords(); });
+	}
+
+	// Reloading the long text after another program changed it: diffing it against the text, and
+	// replacing the runs of lines that differ
+	{
+		vector<string> changed = textLines[1];
+		for (size_t row = 100; row < changed.size(); row += changed.size() / 20)
+		{
+			changed[row] += " (changed)";
+			changed.insert(changed.begin() + row + 1, "an added line");
+		}
+		vector<DiffHunk> hunks;
+		measure("reload/diffLines/scattered", 5, 1, [&](Timer& t)
+		{
+			t.start();
+			diffLines(textLines[1], changed, hunks);
+			t.stop();
+		});
+		Undo* undo = createUndo();
+		TextEditor* te = createTextEditor(undo);
+		measure("reload/replaceLines/scattered", 5, hunks.size(), [&](Timer& t)
+		{
+			te->load(texts[1]);
+			t.start();
+			for (size_t i = hunks.size(); i-- > 0; )
+			{
+				const DiffHunk& hunk = hunks[i];
+				te->replaceLines(hunk.oldStart, hunk.oldCount,
+					vector<string>(changed.begin() + hunk.newStart, changed.begin() + hunk.newStart + hunk.newCount));
+			}
+			t.stop();
+		});
+		delete te;
+		delete undo;
+	}
+
+	// Snapshots of the long text, as a background save takes them: taking one, and the first edit after
+	// it, which copies the nodes it shares on the way down to the line
+	{
+		const long kSnapshotOps = 1000;
+		Undo* undo = createUndo();
+		TextEditor* te = createTextEditor(undo);
+		te->load(texts[1]);
+		goToMiddle(te);
+		vector<LineStore::Snapshot> snapshots(kSnapshotOps);
+		measure("snapshot/take/long", 5, kSnapshotOps, [&](Timer& t)
+		{
+			t.start();
+			for (long i = 0; i < kSnapshotOps; i++)
+				snapshots[i] = te->snapshot();
+			t.stop();
+		});
+		measure("snapshot/insertAfter/long", 5, kSnapshotOps, [&](Timer& t)
+		{
+			t.start();
+			for (long i = 0; i < kSnapshotOps; i++)
+			{
+				snapshots[i] = te->snapshot();
+				te->insert('x');
+			}
+			t.stop();
+		});
+		snapshots.clear();
+		delete te;
+		delete undo;
+	}
+
+	// The long text with its cold lines compressed: packing all of it, reading a window's worth of rows
+	// from rows spread over it (each from a block that has to be unpacked), and typing on such rows
+	{
+		const int kJumps = 200;
+		Undo* undo = createUndo();
+		TextEditor* te = createTextEditor(undo);
+		te->load(texts[1]);
+		const int size = textLines[1].size();
+		measure("packed/compressLines/long", 5, 1, [&](Timer& t)
+		{
+			te->load(texts[1]);
+			t.start();
+			te->compressLines(0, 0);
+			t.stop();
+		});
+		measure("packed/getLines60/long", 5, kJumps, [&](Timer& t)
+		{
+			vector<string> lines;
+			t.start();
+			for (int i = 0; i < kJumps; i++)
+				te->getLines(static_cast<long>(size) * i / kJumps, 60, lines);
+			t.stop();
+		});
+		measure("packed/insert/long", 5, kJumps, [&](Timer& t)
+		{
+			te->compressLines(0, 0);
+			t.start();
+			for (int i = 0; i < kJumps; i++)
+			{
+				te->setPos(static_cast<long>(size) * i / kJumps, 0);
+				te->insert('x');
+			}
+			t.stop();
+		});
+		delete te;
+		delete undo;
+	}
+
+	// The statistics of the long text: counting every line, as a load does, and recounting a line spread
+	// over it, as a key does
+	{
+		const int kKeys = 10000;
+		const int size = textLines[1].size();
+		DocStats stats;
+		measure("stats/reset/long", 5, 1, [&](Timer& t)
+		{
+			t.start();
+			stats.reset(textLines[1]);
+			t.stop();
+		});
+		measure("stats/replaceLine/long", 5, kKeys, [&](Timer& t)
+		{
+			vector<string> line(1);
+			t.start();
+			for (int i = 0; i < kKeys; i++)
+			{
+				const int row = static_cast<long>(size) * i / kKeys;
+				line[0] = textLines[1][row] + "x";
+				stats.replace(row, 1, line);
+				stats.setMisspellings(row, 1);
+			}
+			t.stop();
+		});
+	}
+
+	// The line transforms of every line of the long text, on as many threads as there are
+	{
+		Regex regex;
+		string error;
+		regex.compile("Prince|Natasha", error);
+		vector<string> lines;
+		const pair<const char*, function<void()>> transforms[] = {
+			{ "transform/sort/long", [&] { sortLines(lines); } },
+			{ "transform/unique/long", [&] { uniqueLines(lines); } },
+			{ "transform/filter/long", [&] { filterLines(lines, regex, true); } },
+			{ "transform/reindent/long", [&] { reindentLines(lines, 2); } },
+		};
+		for (const auto& transform : transforms)
+		{
+			measure(transform.first, 5, 1, [&](Timer& t)
+			{
+				lines = textLines[1];
+				t.start();
+				transform.second();
+				t.stop();
+			});
+		}
+	}
+
+	// Undo
+	const long kUndoOps = 200000;
+	Undo* undo = createUndo();
+	measure("undo/submit/batched", 5, kUndoOps, [&](Timer& t)
+	{
+		undo->clear();
+		t.start();
+		for (long i = 0; i < kUndoOps; i++)
+			undo->submit(Undo::Action::INSERT, 0, i + 1, 'x'); // typing along a line merges into one entry
+		t.stop();
+	});
+	measure("undo/submit/separate", 5, kUndoOps, [&](Timer& t)
+	{
+		undo->clear();
+		t.start();
+		for (long i = 0; i < kUndoOps; i++)
+			undo->submit(Undo::Action::SPLIT, i, 0); // every enter is its own entry
+		t.stop();
+	});
+	measure("undo/get", 5, kUndoOps, [&](Timer& t)
+	{
+		undo->clear();
+		for (long i = 0; i < kUndoOps; i++)
+			undo->submit(Undo::Action::SPLIT, i, 0);
+		int row, col, count;
+		string text;
+		t.start();
+		for (long i = 0; i < kUndoOps; i++)
+			undo->get(row, col, count, text);
+		t.stop();
+	});
+	delete undo;
+
+	// Spell checking
+	vector<string> words;
+	for (const string& line : textLines[1])
+		splitWords(line, words);
+	Dictionary dictionary;
+	if (!dictionary.build(dictionaryFile))
+	{
+		cerr << "Cannot load " << dictionaryFile << endl;
+		return 1;
+	}
+	// Distinct correct words, and distinct misspellings made by swapping two letters of them
+	vector<string> correct, misspelled;
+	set<string> seen;
+	for (const string& word : words)
+	{
+		if (!seen.insert(word).second || !dictionary.search(word))
+			continue;
+		if (correct.size() < 4000)
+			correct.push_back(word);
+		string typo = word;
+		if (typo.size() >= 5 && misspelled.size() < 500)
+		{
+			swap(typo[1], typo[3]);
+			if (!dictionary.search(typo) && seen.insert(typo).second)
+				misspelled.push_back(typo);
+		}
+	}
+
+	SpellCheck* sc = createSpellCheck();
+	measure("spellcheck/load", 3, 1, [&](Timer& t)
+	{
+		t.start();
+		sc->load(dictionaryFile);
+		t.stop();
+	});
+	measure("spellcheck/search", 5, words.size(), [&](Timer& t)
+	{
+		long found = 0;
+		t.start();
+		for (const string& word : words)
+			found += dictionary.search(word);
+		t.stop();
+		if (found < 0)
+			cerr << found;
+	});
+	vector<string> suggestions;
+	measure("spellcheck/spellCheck/correct", 5, correct.size(), [&](Timer& t)
+	{
+		t.start();
+		for (const string& word : correct)
+			sc->spellCheck(word, 10, suggestions);
+		t.stop();
+	});
+	measure("spellcheck/spellCheck/misspelled", 1, misspelled.size(), [&](Timer& t)
+	{
+		// Only one round: the suggestion cache would answer the next ones
+		t.start();
+		for (const string& word : misspelled)
+			sc->spellCheck(word, 10, suggestions);
+		t.stop();
+	});
+	vector<SpellCheck::Position> problems;
+	measure("spellcheck/spellCheckLine", 5, textLines[1].size(), [&](Timer& t)
+	{
+		t.start();
+		for (const string& line : textLines[1])
+			sc->spellCheckLine(line, problems);
+		t.stop();
+	});
+	// One screen row in the middle of the whole book run together as a single line
+	string longLine;
+	for (const string& line : textLines[1])
+		longLine += line + ' ';
+	measure("spellcheck/spellCheckRange/row", 5, 1000, [&](Timer& t)
+	{
+		const int middle = longLine.size() / 2;
+		t.start();
+		for (int i = 0; i < 1000; i++)
+			sc->spellCheckRange(longLine, middle + i, middle + i + 80, problems);
+		t.stop();
+	});
+	delete sc;
+
+	cout << "{" << endl;
+	cout << "  \"benchmarks\": [" << endl;
+	for (size_t i = 0; i < results.size(); i++)
+	{
+		char ns[32];
+		snprintf(ns, sizeof(ns), "%.1f", results[i].nsPerOp);
+		cout << "    {\"name\": \"" << results[i].name << "\", \"iterations\": " << results[i].iterations
+			<< ", \"ns_per_op\": " << ns << "}" << (i + 1 < results.size() ? "," : "") << endl;
+	}
+	cout << "  ]" << endl;
+	cout << "}" << endl;
+	return 0;
+}
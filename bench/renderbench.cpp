@@ -0,0 +1,166 @@
+// renderbench: measures what it costs curses to redraw a full editor window
+//
+// Usage: renderbench <text file> <dictionary> [rows] [cols]
+// Draws alternating pages of the text file (so every frame really changes) into a terminal that
+// writes to /dev/null, hilighting misspelled words the way the editor does. Compares printing one
+// character at a time (how the editor used to draw), printing runs of same colored characters, and
+// copying prebuilt rows of cells. Reports the cost of drawing into curses' window per frame, the
+// cost including the refresh that sends the frame to the terminal, and the curses output calls.
+
+#include "TextIO.h"
+#include "SpellCheck.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+using namespace std;
+
+struct Row
+{
+	string text;
+	string bad; // '*' where a misspelled word is, ' ' elsewhere
+};
+
+enum Method { PER_CHARACTER, RUNS, CELLS };
+
+// Draws one frame, returns the number of curses output calls it made
+static long drawFrame(const vector<Row>& frame, Method method)
+{
+	long calls = 0;
+	vector<TextIO::Cell> cells;
+	for (int row = 0; row < frame.size(); row++)
+	{
+		const Row& r = frame[row];
+		TextIO::move(row, 0);
+		if (method == PER_CHARACTER)
+		{
+			for (int i = 0; i < r.text.size(); i++, calls++)
+				TextIO::print(r.text[i], r.bad[i] == '*' ? TextIO::COLOR::RED : TextIO::COLOR::WHITE);
+		}
+		else if (method == RUNS)
+		{
+			for (int i = 0; i < r.text.size(); calls++)
+			{
+				const bool bad = r.bad[i] == '*';
+				int end = i + 1;
+				while (end < r.text.size() && (r.bad[end] == '*') == bad)
+					++end;
+				TextIO::print(r.text.data() + i, end - i, bad ? TextIO::COLOR::RED : TextIO::COLOR::WHITE);
+				i = end;
+			}
+		}
+		else
+		{
+			cells.resize(r.text.size());
+			for (int i = 0; i < r.text.size(); i++)
+				cells[i] = TextIO::cell(r.text[i], r.bad[i] == '*' ? TextIO::COLOR::RED : TextIO::COLOR::WHITE);
+			TextIO::print(cells.data(), cells.size());
+			calls++;
+		}
+	}
+	return calls;
+}
+
+// Draws count frames, measuring microseconds per frame with and without sending it to the terminal
+static void timeFrames(const vector<vector<Row>>& frames, Method method, int count, double& drawUs, double& totalUs, long& callsPerFrame)
+{
+	long calls = 0;
+	double drawing = 0;
+	auto start = chrono::steady_clock::now();
+	for (int i = 0; i < count; i++)
+	{
+		auto frameStart = chrono::steady_clock::now();
+		calls += drawFrame(frames[i % frames.size()], method);
+		drawing += chrono::duration<double, micro>(chrono::steady_clock::now() - frameStart).count();
+		TextIO::refresh();
+	}
+	callsPerFrame = calls / count;
+	drawUs = drawing / count;
+	totalUs = chrono::duration<double, micro>(chrono::steady_clock::now() - start).count() / count;
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc < 3)
+	{
+		cerr << "Usage: " << argv[0] << " <text file> <dictionary> [rows] [cols]" << endl;
+		return 1;
+	}
+	const int rows = argc > 3 ? atoi(argv[3]) : 60;
+	const int cols = argc > 4 ? atoi(argv[4]) : 80;
+	const int kFrames = 2000;
+
+	SpellCheck* sc = createSpellCheck();
+	if (!sc->load(argv[2]))
+	{
+		cerr << "Cannot load " << argv[2] << endl;
+		return 1;
+	}
+	ifstream infile(argv[1]);
+	vector<vector<Row>> frames;
+	vector<Row> page;
+	string line;
+	while (getline(infile, line) && frames.size() < 16)
+	{
+		if (!line.empty() && line[line.size() - 1] == '\r') // the editor strips these when it loads a file
+			line.pop_back();
+		Row r;
+		r.text = line.substr(0, cols);
+		r.text.resize(cols, ' ');
+		r.bad.assign(cols, ' ');
+		vector<SpellCheck::Position> problems;
+		sc->spellCheckLine(r.text, problems);
+		for (const auto& p : problems)
+		{
+			for (int i = p.start; i <= p.end; i++)
+				r.bad[i] = '*';
+		}
+		page.push_back(r);
+		if (page.size() == rows)
+		{
+			frames.push_back(page);
+			page.clear();
+		}
+	}
+	delete sc;
+	if (frames.size() < 2)
+	{
+		cerr << argv[1] << " needs at least " << 2 * rows << " lines" << endl;
+		return 1;
+	}
+
+	// A real terminal as far as curses knows, whose output goes nowhere
+	FILE* devnull = fopen("/dev/null", "w");
+	setenv("TERM", "xterm", 0);
+	SCREEN* screen = newterm(nullptr, devnull, stdin);
+	if (screen == nullptr)
+	{
+		cerr << "Cannot set up a terminal" << endl;
+		return 1;
+	}
+	resizeterm(rows + 1, cols);
+	start_color();
+	init_pair(TextIO::COLOR::WHITE, COLOR_WHITE, COLOR_BLACK);
+	init_pair(TextIO::COLOR::RED, COLOR_RED, COLOR_BLACK);
+
+	const char* names[] = { "per character", "runs", "cells" };
+	double drawUs[3], totalUs[3];
+	long calls[3];
+	for (int method = PER_CHARACTER; method <= CELLS; method++)
+		timeFrames(frames, static_cast<Method>(method), kFrames, drawUs[method], totalUs[method], calls[method]);
+	endwin();
+	delscreen(screen);
+	fclose(devnull);
+
+	cout << rows << "x" << cols << " window, " << kFrames << " frames" << endl;
+	for (int method = PER_CHARACTER; method <= CELLS; method++)
+	{
+		cout << names[method] << ": " << drawUs[method] << " us/frame drawing, " << totalUs[method]
+			<< " us/frame with refresh, " << calls[method] << " output calls/frame" << endl;
+	}
+	cout << "drawing speedup of cells over per character: " << drawUs[PER_CHARACTER] / drawUs[CELLS] << "x" << endl;
+	return 0;
+}
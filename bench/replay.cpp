@@ -0,0 +1,202 @@
+// replay: measures how long the editor takes to handle each key of recorded typing sessions
+//
+// Usage: replay <text file> <dictionary> <script>... [--rows R] [--cols C] [--copies N]
+// Every script is played into a fresh editor that has the text file (N times over with --copies, for
+// a file too big to spell check before the first key) and the dictionary loaded, right after loading,
+// through the whole GUI (EditorGui, FrameRenderer and TextIO) drawing into an in-memory FrameBuffer
+// instead of a terminal. Reports the 50th and 99th percentile and the worst latency per key of
+// each stage: editing, taking snapshots of the window, and spell checking and drawing them.
+//
+// A script is plain text that gets typed as it is, except for lines starting with # (comments),
+// line breaks (ignored) and keys in angle brackets, optionally repeated: <Enter>, <PageDown>*100,
+// <C-z>*50. The keys are Up, Down, Left, Right, Home, End, PageUp, PageDown, Delete, Backspace,
+// Enter, Tab, Lt (a literal <) and C-a to C-z.
+
+#include "EditorGui.h"
+#include "FrameBuffer.h"
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstdio>
+#include <iterator>
+#include <unistd.h> // for close, unlink
+using namespace std;
+
+// Turns a key name from a script into the key curses would report, -1 if there's no such key
+static int keyNamed(const string& name)
+{
+	if (name.size() == 3 && name[0] == 'C' && name[1] == '-' && name[2] >= 'a' && name[2] <= 'z')
+		return name[2] - 'a' + 1;
+	const struct { const char* name; int key; } keys[] = {
+		{ "Up", KEY_UP }, { "Down", KEY_DOWN }, { "Left", KEY_LEFT }, { "Right", KEY_RIGHT },
+		{ "Home", KEY_HOME }, { "End", KEY_END }, { "PageUp", KEY_PPAGE }, { "PageDown", KEY_NPAGE },
+		{ "Delete", KEY_DC }, { "Backspace", 127 }, { "Enter", '\n' }, { "Tab", '\t' }, { "Lt", '<' },
+	};
+	for (const auto& k : keys)
+	{
+		if (name == k.name)
+			return k.key;
+	}
+	return -1;
+}
+
+// Reads the keys of a script, returns false if it can't be read or has a key that doesn't exist
+static bool readScript(const string& file, vector<int>& keys)
+{
+	ifstream infile(file);
+	if (!infile)
+	{
+		cerr << "Cannot open " << file << endl;
+		return false;
+	}
+	string line;
+	while (getline(infile, line))
+	{
+		if (!line.empty() && line[line.size() - 1] == '\r')
+			line.pop_back();
+		if (!line.empty() && line[0] == '#')
+			continue;
+		for (size_t i = 0; i < line.size(); )
+		{
+			if (line[i] != '<')
+			{
+				keys.push_back(static_cast<unsigned char>(line[i++]));
+				continue;
+			}
+			size_t close = line.find('>', i);
+			int key = close == string::npos ? -1 : keyNamed(line.substr(i + 1, close - i - 1));
+			if (key == -1)
+			{
+				cerr << file << ": unknown key in " << line.substr(i) << endl;
+				return false;
+			}
+			i = close + 1;
+			int repeat = 1;
+			if (i < line.size() && line[i] == '*')
+			{
+				size_t end = i + 1;
+				while (end < line.size() && isdigit(static_cast<unsigned char>(line[end])))
+					end++;
+				repeat = atoi(line.substr(i + 1, end - i - 1).c_str());
+				i = end;
+			}
+			keys.insert(keys.end(), repeat, key);
+		}
+	}
+	return true;
+}
+
+// Nearest rank percentile of a sorted list
+static double percentile(const vector<double>& sorted, double p)
+{
+	if (sorted.empty())
+		return 0;
+	size_t rank = static_cast<size_t>(p / 100 * (sorted.size() - 1) + 0.5);
+	return sorted[rank];
+}
+
+// Writes copies of file one after the other to a new temporary file, returns its name or "" if it can't
+static string copyFile(const string& file, int copies)
+{
+	ifstream in(file, ios::binary);
+	char name[] = "/tmp/replay-XXXXXX";
+	const int fd = mkstemp(name);
+	if (!in || fd < 0)
+		return "";
+	close(fd);
+	const string text((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+	ofstream out(name, ios::binary);
+	for (int i = 0; i < copies; i++)
+		out << text;
+	return out ? name : "";
+}
+
+static void report(const string& stage, vector<double>& times)
+{
+	sort(times.begin(), times.end());
+	printf("  %-8s p50 %9.1f us   p99 %9.1f us   max %9.1f us\n", stage.c_str(),
+		percentile(times, 50), percentile(times, 99), times.empty() ? 0.0 : times.back());
+}
+
+int main(int argc, char* argv[])
+{
+	int rows = 60, cols = 80, copies = 1;
+	vector<string> args;
+	for (int i = 1; i < argc; i++)
+	{
+		string arg = argv[i];
+		if (arg == "--rows" && i + 1 < argc)
+			rows = atoi(argv[++i]);
+		else if (arg == "--cols" && i + 1 < argc)
+			cols = atoi(argv[++i]);
+		else if (arg == "--copies" && i + 1 < argc)
+			copies = atoi(argv[++i]);
+		else
+			args.push_back(arg);
+	}
+	if (args.size() < 3)
+	{
+		cerr << "Usage: " << argv[0] << " <text file> <dictionary> <script>... [--rows R] [--cols C] [--copies N]" << endl;
+		return 1;
+	}
+	string text = args[0];
+	if (copies > 1)
+	{
+		text = copyFile(args[0], copies);
+		if (text.empty())
+		{
+			cerr << "Cannot copy " << args[0] << endl;
+			return 1;
+		}
+	}
+
+	cout << rows << "x" << cols << " window, " << args[0];
+	if (copies > 1)
+		cout << " x" << copies;
+	cout << endl;
+	for (size_t s = 2; s < args.size(); s++)
+	{
+		vector<int> keys;
+		if (!readScript(args[s], keys))
+			return 1;
+
+		FrameBuffer screen(rows + 1, cols);
+		TextIO io(screen);
+		EditorGui editor(rows + 1, cols);
+		if (!editor.loadDictionary(args[1]))
+		{
+			cerr << "Cannot load " << args[1] << endl;
+			return 1;
+		}
+		editor.loadFileToEdit(text);
+
+		for (int key : keys)
+			screen.type(key);
+		vector<double> edit, frame, render, total;
+		auto start = chrono::steady_clock::now();
+		for (int key = TextIO::getChar(); key != ERR; key = TextIO::getChar())
+		{
+			EditorGui::StageTimes times;
+			if (!editor.step(key, &times))
+				break;
+			edit.push_back(times.edit);
+			frame.push_back(times.frame);
+			render.push_back(times.render);
+			total.push_back(times.edit + times.frame + times.render);
+		}
+		double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+		cout << args[s] << ": " << total.size() << " keys in " << seconds * 1000 << " ms" << endl;
+		report("edit", edit);
+		report("frame", frame);
+		report("render", render);
+		report("total", total);
+	}
+	if (text != args[0])
+		unlink(text.c_str());
+	return 0;
+}
@@ -1,9 +1,12 @@
 #include "EditorGui.h"
 #include "TextIO.h"
+#include "FrameBuffer.h"
+#include "MemoryReport.h"
 #include <iostream>
 #include <string>
 
-// Do not change anything in this file other than these initializer values
+// The settings to change are these initializer values; main() below only reads the command line
+// (--compress, --stats, the file to edit) and hands it to the editor
 const char* DICTIONARYPATH = "dictionary.txt";
 const int FOREGROUND_COLOR = COLOR_WHITE;
 const int BACKGROUND_COLOR = COLOR_BLACK;
@@ -11,9 +14,33 @@ const int HIGHLIGHT_COLOR  = COLOR_RED;
 // Choices are COLOR_x, where x is WHITE, BLACK, RED, GREEN, YELLOW, BLUE, MAGENTA, CYAN
 
 int main(int argc, char* argv[]) {
+	// wurd --compress ...: keep the lines far from the cursor compressed, for files too big to edit otherwise.
+	const bool compress = argc >= 2 && std::string(argv[1]) == "--compress";
+	if (compress) {
+		argv++;
+		argc--;
+	}
+
+	// wurd --stats [file]: load the dictionary (and the file) without a terminal and print where the memory goes.
+	if (argc >= 2 && std::string(argv[1]) == "--stats") {
+		FrameBuffer screen(25, 80);
+		TextIO headless(screen);
+		EditorGui editor(screen.rows(), screen.cols());
+		if (!editor.loadDictionary(DICTIONARYPATH))
+			std::cerr << "Error: Can not load dictionary " << DICTIONARYPATH << std::endl;
+		if (argc == 3)
+			editor.loadFileToEdit(argv[2]);
+		editor.compressLines(compress);
+		MemoryReport report;
+		editor.reportMemory(report);
+		report.print(std::cout);
+		return 0;
+	}
+
 	TextIO ti(FOREGROUND_COLOR, BACKGROUND_COLOR, HIGHLIGHT_COLOR);
 
 	EditorGui editor(LINES, COLS);
+	editor.compressLines(compress);
 
 	if (editor.loadDictionary(DICTIONARYPATH))
 		editor.writeStatus("Loaded dictionary successfully!");
@@ -21,7 +48,7 @@ int main(int argc, char* argv[]) {
 		editor.writeStatus(std::string("Error: Can not load dictionary ") + DICTIONARYPATH);
 
 	if (argc == 2) {
-		editor.loadFileToEdit(argv[1]);
+		editor.loadFileToEdit(argv[1], true);
 	}
 	editor.run();
 }
@@ -0,0 +1,156 @@
+// dicconv: converts a flat word list (one word per line, like dictionary.txt) into a
+// stem+affix dictionary that Wurd's spell checker can load.
+//
+// Usage: dicconv <word list> <output base name>
+// Writes <output base name>.dic and <output base name>.aff
+//
+// A word gets an affix flag only if every form the flag generates from it is in the list,
+// and a word is left out of the .dic file only if one of those stems generates it, so the
+// converted dictionary accepts exactly the same words as the list it came from.
+
+#include "Affix.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
+using namespace std;
+
+// English inflection rules. Prefixes aren't cross products so a prefix and a suffix are never
+// combined into a word the list didn't have.
+const char* const kRules =
+	"SFX S Y 4\n"
+	"SFX S y ies [^aeiou]y\n"
+	"SFX S 0 s [aeiou]y\n"
+	"SFX S 0 es [sxzh]\n"
+	"SFX S 0 s [^sxzhy]\n"
+	"SFX D Y 4\n"
+	"SFX D 0 d e\n"
+	"SFX D y ied [^aeiou]y\n"
+	"SFX D 0 ed [aeiou]y\n"
+	"SFX D 0 ed [^ey]\n"
+	"SFX G Y 2\n"
+	"SFX G e ing e\n"
+	"SFX G 0 ing [^e]\n"
+	"SFX R Y 4\n"
+	"SFX R 0 r e\n"
+	"SFX R y ier [^aeiou]y\n"
+	"SFX R 0 er [aeiou]y\n"
+	"SFX R 0 er [^ey]\n"
+	"SFX T Y 4\n"
+	"SFX T 0 st e\n"
+	"SFX T y iest [^aeiou]y\n"
+	"SFX T 0 est [aeiou]y\n"
+	"SFX T 0 est [^ey]\n"
+	"SFX Y Y 1\n"
+	"SFX Y 0 ly .\n"
+	"SFX N Y 3\n"
+	"SFX N y iness [^aeiou]y\n"
+	"SFX N 0 ness [aeiou]y\n"
+	"SFX N 0 ness [^y]\n"
+	"SFX M Y 1\n"
+	"SFX M 0 's .\n"
+	"PFX U N 1\n"
+	"PFX U 0 un .\n"
+	"PFX A N 1\n"
+	"PFX A 0 re .\n";
+
+const char kFlags[] = "SDGRTYNMUA";
+
+int main(int argc, char* argv[])
+{
+	if (argc != 3)
+	{
+		cerr << "Usage: " << argv[0] << " <word list> <output base name>" << endl;
+		return 1;
+	}
+
+	ifstream infile(argv[1]);
+	if (!infile)
+	{
+		cerr << "Cannot open " << argv[1] << endl;
+		return 1;
+	}
+	vector<string> words;
+	unordered_set<string> known;
+	string s;
+	while (getline(infile, s))
+	{
+		if (!s.empty() && s[s.size() - 1] == '\r')
+			s.pop_back();
+		if (s.empty() || !known.insert(s).second)
+			continue;
+		words.push_back(s);
+	}
+
+	AffixRules rules;
+	istringstream ruleText(kRules);
+	if (!rules.parse(ruleText))
+	{
+		cerr << "Built in affix rules are malformed" << endl;
+		return 1;
+	}
+
+	// Find the flags of every word, and every word that some stem's flags generate
+	unordered_map<string, string> flagsOf;
+	unordered_set<string> generated;
+	vector<string> forms;
+	for (const string& word : words)
+	{
+		string flags;
+		for (const char* flag = kFlags; *flag != '\0'; flag++)
+		{
+			forms.clear();
+			rules.generate(word, *flag, forms);
+			if (forms.empty())
+				continue;
+			bool allKnown = true;
+			for (const string& form : forms)
+			{
+				if (form == word || known.count(form) == 0)
+				{
+					allKnown = false;
+					break;
+				}
+			}
+			if (!allKnown)
+				continue;
+			flags += *flag;
+			generated.insert(forms.begin(), forms.end());
+		}
+		if (!flags.empty())
+			flagsOf[word] = flags;
+	}
+
+	// A word has to be written out if nothing generates it or if it's a stem itself
+	vector<string> entries;
+	for (const string& word : words)
+	{
+		auto it = flagsOf.find(word);
+		if (it != flagsOf.end())
+			entries.push_back(word + "/" + it->second);
+		else if (generated.count(word) == 0)
+			entries.push_back(word);
+	}
+	sort(entries.begin(), entries.end());
+
+	string base = argv[2];
+	ofstream dic(base + ".dic");
+	ofstream aff(base + ".aff");
+	if (!dic || !aff)
+	{
+		cerr << "Cannot write " << base << ".dic/.aff" << endl;
+		return 1;
+	}
+	aff << "# Generated by dicconv from " << argv[1] << "\n" << kRules;
+	dic << entries.size() << "\n";
+	for (const string& entry : entries)
+		dic << entry << "\n";
+
+	cout << words.size() << " words -> " << entries.size() << " entries ("
+		<< flagsOf.size() << " stems with affix flags)" << endl;
+	return 0;
+}